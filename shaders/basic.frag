@@ -6,10 +6,11 @@ layout(location = 2) in vec4 Cs;
 
 layout(location = 0) out vec4 outColor;
 
-// MeshLab defaults (from xray.gdp)
-const float edgefalloff = 1.0;
-const float intensity   = 0.5;
-const float ambient     = 0.01;
+// X-ray preset (Config::XRAY_PRESETS); the defaults are MeshLab's, from
+// xray.gdp. constant_id 0 is taken by basic.vert.
+layout(constant_id = 1) const float edgefalloff = 1.0;
+layout(constant_id = 2) const float intensity   = 0.5;
+layout(constant_id = 3) const float ambient     = 0.01;
 
 
 void main() {
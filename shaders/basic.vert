@@ -1,5 +1,10 @@
 #version 450
 
+// float layout: R32G32B32 position + normal.
+// compact layout: R16G16B16A16_SNORM position (dequantized by the model
+// matrix) + R16G16_SNORM octahedral normal in inNormal.xy.
+layout(constant_id = 0) const bool COMPACT_VERTICES = false;
+
 layout(location = 0) in vec3 inPos;
 layout(location = 1) in vec3 inNormal;
 
@@ -11,19 +16,30 @@ layout(location = 0) out vec3 N;
 layout(location = 1) out vec3 I;
 layout(location = 2) out vec4 Cs;
 
-// Push constants: we push both MVP and MV
-layout(push_constant) uniform PushConsts {
+// Per-frame transforms (VulkanApp::FrameTransforms): both MVP and MV
+layout(set = 0, binding = 0) uniform FrameTransforms {
     mat4 mvp;  // = Projection * View * Model
     mat4 mv;   // = View * Model
 } pc;
 
+vec3 octDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) {
+        vec2 s = vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+        n.xy = (1.0 - abs(n.yx)) * s;
+    }
+    return normalize(n);
+}
+
 void main() {
+    vec3 normal = COMPACT_VERTICES ? octDecode(inNormal.xy) : inNormal;
+
     // eye-space position
     vec4 P = pc.mv * vec4(inPos, 1.0);
     I = P.xyz - vec3(0.0);
 
     // eye-space normal (like gl_NormalMatrix * gl_Normal)
-    N = mat3(pc.mv) * inNormal;
+    N = mat3(pc.mv) * normal;
 
     // MeshLab uses gl_Color; we don't have per-vertex colors,
     // so take constant white (you can tint this later in C++).
@@ -0,0 +1,133 @@
+#include "CompactVertex.h"
+#include "Parallel.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// ----------------------------------------
+// SNORM16
+// ----------------------------------------
+
+static int16_t toSnorm16(float v)
+{
+    v = std::min(std::max(v, -1.0f), 1.0f);
+    return static_cast<int16_t>(std::lround(v * 32767.0f));
+}
+
+static float fromSnorm16(int16_t v)
+{
+    // matches the Vulkan SNORM conversion
+    return std::max(static_cast<float>(v) / 32767.0f, -1.0f);
+}
+
+// ----------------------------------------
+// octahedral normals
+// ----------------------------------------
+
+static float signNotZero(float v) { return v >= 0.0f ? 1.0f : -1.0f; }
+
+static glm::vec2 octWrap(const glm::vec2& v)
+{
+    return glm::vec2((1.0f - std::abs(v.y)) * signNotZero(v.x),
+                     (1.0f - std::abs(v.x)) * signNotZero(v.y));
+}
+
+glm::vec3 octDecode(int16_t x, int16_t y)
+{
+    glm::vec2 e(fromSnorm16(x), fromSnorm16(y));
+    glm::vec3 n(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+    if (n.z < 0.0f) {
+        glm::vec2 w = octWrap(glm::vec2(n.x, n.y));
+        n.x = w.x;
+        n.y = w.y;
+    }
+    return glm::normalize(n);
+}
+
+// Projects onto the octahedron, then keeps whichever of the four
+// neighbouring grid points decodes closest to n.
+void octEncode(const glm::vec3& n, int16_t out[2])
+{
+    const float l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    glm::vec2 p = (l1 > 0.0f) ? glm::vec2(n.x, n.y) / l1 : glm::vec2(0.0f);
+    if (n.z < 0.0f) p = octWrap(p);
+
+    const float fx = std::floor(p.x * 32767.0f), fy = std::floor(p.y * 32767.0f);
+    float best = -2.0f;
+    for (int i = 0; i < 4; ++i) {
+        const float cx = std::min(std::max(fx + float(i & 1), -32767.0f), 32767.0f);
+        const float cy = std::min(std::max(fy + float(i >> 1), -32767.0f), 32767.0f);
+        const int16_t c[2] = { static_cast<int16_t>(cx), static_cast<int16_t>(cy) };
+        const float d = glm::dot(octDecode(c[0], c[1]), n);
+        if (d > best) {
+            best   = d;
+            out[0] = c[0];
+            out[1] = c[1];
+        }
+    }
+}
+
+// ----------------------------------------
+// encoding
+// ----------------------------------------
+
+VertexQuantization makeVertexQuantization(const MeshBounds& bounds)
+{
+    VertexQuantization q;
+    const glm::vec3 extent = bounds.max - bounds.min;
+    q.center = 0.5f * (bounds.min + bounds.max);
+    q.scale  = 0.5f * std::max(extent.x, std::max(extent.y, extent.z));
+    if (!(q.scale > 0.0f)) q.scale = 1.0f;
+    return q;
+}
+
+glm::mat4 dequantizationMatrix(const VertexQuantization& q)
+{
+    return glm::translate(glm::mat4(1.0f), q.center) *
+           glm::scale(glm::mat4(1.0f), glm::vec3(q.scale));
+}
+
+QuantizationError encodeCompactVertices(const Vertex* src, size_t count,
+                                        const VertexQuantization& q, CompactVertex* dst)
+{
+    constexpr size_t MIN_RANGE = 1u << 16;
+    const float invScale = 1.0f / q.scale;
+
+    std::vector<QuantizationError> partial(parallelRangeCount(count, MIN_RANGE));
+    parallelRanges(count, MIN_RANGE, [&](size_t begin, size_t end, size_t r) {
+        float maxPos2   = 0.0f;
+        float minNormal = 1.0f;
+        for (size_t i = begin; i < end; ++i) {
+            const Vertex& v = src[i];
+            CompactVertex c;
+
+            const glm::vec3 local = (v.pos - q.center) * invScale;
+            c.pos[0] = toSnorm16(local.x);
+            c.pos[1] = toSnorm16(local.y);
+            c.pos[2] = toSnorm16(local.z);
+            c.pos[3] = 0;
+            octEncode(v.normal, c.normal);
+            dst[i] = c;
+
+            const glm::vec3 decoded = glm::vec3(fromSnorm16(c.pos[0]), fromSnorm16(c.pos[1]),
+                                                fromSnorm16(c.pos[2])) * q.scale + q.center;
+            const glm::vec3 d = decoded - v.pos;
+            maxPos2   = std::max(maxPos2, glm::dot(d, d));
+            minNormal = std::min(minNormal, glm::dot(octDecode(c.normal[0], c.normal[1]), v.normal));
+        }
+        partial[r].maxPositionError = std::sqrt(maxPos2);
+        partial[r].maxNormalDegrees =
+            glm::degrees(std::acos(std::min(std::max(minNormal, -1.0f), 1.0f)));
+    });
+
+    QuantizationError total;
+    for (const QuantizationError& e : partial) {
+        total.maxPositionError = std::max(total.maxPositionError, e.maxPositionError);
+        total.maxNormalDegrees = std::max(total.maxNormalDegrees, e.maxNormalDegrees);
+    }
+    return total;
+}
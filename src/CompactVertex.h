@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+#include "MeshLoader.h"
+#include "MeshUtils.h"
+
+// 12-byte alternative to VulkanVertex (24 bytes) for vertex-fetch bound
+// meshes: positions as 16-bit SNORM inside the mesh's bounding box,
+// normals octahedral-encoded into two 16-bit SNORM values. The shader
+// decodes the normal (COMPACT_VERTICES specialization constant); the
+// position scale / offset is folded into the model matrix.
+struct CompactVertex {
+    int16_t pos[4];      // xyz in [-1, 1] of the quantization box, w unused
+    int16_t normal[2];   // octahedral
+
+    static VkVertexInputBindingDescription getBindingDescription() {
+        VkVertexInputBindingDescription binding{};
+        binding.binding   = 0;
+        binding.stride    = sizeof(CompactVertex);
+        binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+        return binding;
+    }
+
+    static std::array<VkVertexInputAttributeDescription, 2> getAttributeDescriptions() {
+        std::array<VkVertexInputAttributeDescription, 2> attrs{};
+
+        attrs[0].binding  = 0;
+        attrs[0].location = 0;
+        attrs[0].format   = VK_FORMAT_R16G16B16A16_SNORM;
+        attrs[0].offset   = offsetof(CompactVertex, pos);
+
+        attrs[1].binding  = 0;
+        attrs[1].location = 1;
+        attrs[1].format   = VK_FORMAT_R16G16_SNORM;
+        attrs[1].offset   = offsetof(CompactVertex, normal);
+
+        return attrs;
+    }
+};
+
+static_assert(sizeof(CompactVertex) == 12, "CompactVertex is expected to be 12 bytes");
+
+// Maps the cube around the bounding box onto [-1, 1]^3 with one uniform
+// scale, so normals stay valid under the dequantization matrix.
+struct VertexQuantization {
+    glm::vec3 center{ 0.0f };
+    float     scale = 1.0f;     // half of the longest box side
+};
+
+struct QuantizationError {
+    float maxPositionError = 0.0f;   // same units as the source positions
+    float maxNormalDegrees = 0.0f;
+};
+
+VertexQuantization makeVertexQuantization(const MeshBounds& bounds);
+
+// decoded position = dequantizationMatrix * snorm position
+glm::mat4 dequantizationMatrix(const VertexQuantization& q);
+
+// Octahedral normal as two SNORM16 values; octEncode picks the grid point
+// that decodes closest to n. Also used by the compressed mesh codec.
+void      octEncode(const glm::vec3& n, int16_t out[2]);
+glm::vec3 octDecode(int16_t x, int16_t y);
+
+// Encodes count vertices into dst in parallel (dst may be mapped staging
+// memory) and measures the round-trip error.
+QuantizationError encodeCompactVertices(const Vertex* src, size_t count,
+                                        const VertexQuantization& q, CompactVertex* dst);
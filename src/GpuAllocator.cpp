@@ -0,0 +1,295 @@
+#include "GpuAllocator.h"
+
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+static VkDeviceSize alignUp(VkDeviceSize v, VkDeviceSize alignment)
+{
+    return alignment > 1 ? (v + alignment - 1) / alignment * alignment : v;
+}
+
+// ----------------------------------------
+// setup
+// ----------------------------------------
+
+void GpuAllocator::init(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize)
+{
+    m_device    = device;
+    m_blockSize = blockSize;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &m_memoryProperties);
+
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(physicalDevice, &props);
+    m_maxMemoryObjects = props.limits.maxMemoryAllocationCount;
+}
+
+void GpuAllocator::destroy()
+{
+    if (m_device == VK_NULL_HANDLE) return;
+
+    size_t leaked = 0;
+    for (uint32_t i = 0; i < m_blocks.size(); ++i) {
+        if (!m_blocks[i]) continue;
+        leaked += m_blocks[i]->live;
+        releaseBlock(i);
+    }
+    if (leaked) std::cerr << "Warning: " << leaked << " GPU allocations were never freed\n";
+
+    m_blocks.clear();
+    m_device = VK_NULL_HANDLE;
+}
+
+uint32_t GpuAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const
+{
+    for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1u << i)) &&
+            (m_memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("Failed to find suitable memory type");
+}
+
+bool GpuAllocator::hasRoom(uint32_t typeFilter, VkMemoryPropertyFlags properties, VkDeviceSize size) const
+{
+    for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; i++) {
+        if (!(typeFilter & (1u << i)) ||
+            (m_memoryProperties.memoryTypes[i].propertyFlags & properties) != properties) continue;
+
+        // same type allocate() would pick; count every block on its heap
+        const uint32_t heap = m_memoryProperties.memoryTypes[i].heapIndex;
+        VkDeviceSize reserved = 0;
+        for (const auto& b : m_blocks)
+            if (b && m_memoryProperties.memoryTypes[b->memoryType].heapIndex == heap) reserved += b->size;
+
+        const double budget = double(m_memoryProperties.memoryHeaps[heap].size) * HEAP_BUDGET;
+        return double(reserved + size) <= budget;
+    }
+    return false;
+}
+
+// ----------------------------------------
+// blocks
+// ----------------------------------------
+
+uint32_t GpuAllocator::createBlock(uint32_t memoryType, VkDeviceSize size,
+                                   AllocationStrategy strategy, bool dedicated)
+{
+    if (m_maxMemoryObjects && m_memoryObjects >= m_maxMemoryObjects)
+        throw std::runtime_error("GPU allocator: maxMemoryAllocationCount (" +
+                                 std::to_string(m_maxMemoryObjects) + ") reached");
+
+    VkMemoryAllocateInfo alloc{};
+    alloc.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    alloc.allocationSize  = size;
+    alloc.memoryTypeIndex = memoryType;
+
+    auto block = std::make_unique<Block>();
+    if (vkAllocateMemory(m_device, &alloc, nullptr, &block->memory) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate buffer memory");
+    }
+    m_memoryObjects++;
+    m_allocateCalls++;
+
+    block->size       = size;
+    block->memoryType = memoryType;
+    block->strategy   = strategy;
+    block->dedicated  = dedicated;
+    if (strategy == AllocationStrategy::FreeList && !dedicated)
+        block->freeRanges.emplace(0, size);
+
+    if (m_memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        void* data = nullptr;
+        if (vkMapMemory(m_device, block->memory, 0, VK_WHOLE_SIZE, 0, &data) != VK_SUCCESS) {
+            vkFreeMemory(m_device, block->memory, nullptr);
+            m_memoryObjects--;
+            throw std::runtime_error("Failed to map buffer memory");
+        }
+        block->mapped = static_cast<uint8_t*>(data);
+    }
+
+    auto slot = std::find(m_blocks.begin(), m_blocks.end(), nullptr);
+    if (slot == m_blocks.end()) slot = m_blocks.insert(slot, nullptr);
+    *slot = std::move(block);
+    return static_cast<uint32_t>(slot - m_blocks.begin());
+}
+
+void GpuAllocator::releaseBlock(uint32_t index)
+{
+    Block& block = *m_blocks[index];
+    if (block.mapped) vkUnmapMemory(m_device, block.memory);
+    vkFreeMemory(m_device, block.memory, nullptr);
+    m_memoryObjects--;
+    m_blocks[index].reset();
+}
+
+bool GpuAllocator::allocateFrom(Block& block, VkDeviceSize size, VkDeviceSize alignment,
+                                VkDeviceSize& offset)
+{
+    if (block.strategy == AllocationStrategy::Linear) {
+        const VkDeviceSize start = alignUp(block.head, alignment);
+        if (start + size > block.size) return false;
+        block.head = start + size;
+        offset     = start;
+        return true;
+    }
+
+    // best fit: the smallest free range that still holds the aligned request
+    auto best = block.freeRanges.end();
+    for (auto it = block.freeRanges.begin(); it != block.freeRanges.end(); ++it) {
+        const VkDeviceSize start = alignUp(it->first, alignment);
+        if (start + size > it->first + it->second) continue;
+        if (best == block.freeRanges.end() || it->second < best->second) best = it;
+    }
+    if (best == block.freeRanges.end()) return false;
+
+    const VkDeviceSize rangeStart = best->first;
+    const VkDeviceSize rangeEnd   = best->first + best->second;
+    const VkDeviceSize start      = alignUp(rangeStart, alignment);
+    block.freeRanges.erase(best);
+    if (start > rangeStart)      block.freeRanges.emplace(rangeStart, start - rangeStart);
+    if (start + size < rangeEnd) block.freeRanges.emplace(start + size, rangeEnd - start - size);
+    offset = start;
+    return true;
+}
+
+// ----------------------------------------
+// allocate / free
+// ----------------------------------------
+
+GpuAllocation GpuAllocator::allocate(const VkMemoryRequirements& requirements,
+                                     VkMemoryPropertyFlags properties,
+                                     AllocationStrategy strategy)
+{
+    const uint32_t memoryType = findMemoryType(requirements.memoryTypeBits, properties);
+    const uint32_t heap       = m_memoryProperties.memoryTypes[memoryType].heapIndex;
+    const VkDeviceSize blockSize =
+        std::min(m_blockSize, m_memoryProperties.memoryHeaps[heap].size / 8);
+
+    GpuAllocation a;
+    a.size = requirements.size;
+
+    uint32_t     index  = 0;
+    VkDeviceSize offset = 0;
+    bool         placed = false;
+
+    if (requirements.size > blockSize / 2) {
+        index  = createBlock(memoryType, requirements.size, strategy, true);
+        placed = true;
+    } else {
+        for (uint32_t i = 0; i < m_blocks.size() && !placed; ++i) {
+            Block* b = m_blocks[i].get();
+            if (!b || b->dedicated || b->memoryType != memoryType || b->strategy != strategy) continue;
+            if (allocateFrom(*b, requirements.size, requirements.alignment, offset)) {
+                index  = i;
+                placed = true;
+            }
+        }
+        if (!placed) {
+            index = createBlock(memoryType, blockSize, strategy, false);
+            if (!allocateFrom(*m_blocks[index], requirements.size, requirements.alignment, offset))
+                throw std::runtime_error("GPU allocator: request does not fit an empty block");
+        }
+    }
+
+    Block& block = *m_blocks[index];
+    block.live++;
+    block.used += requirements.size;
+
+    a.memory = block.memory;
+    a.offset = offset;
+    a.mapped = block.mapped ? block.mapped + offset : nullptr;
+    a.block  = index;
+    return a;
+}
+
+void GpuAllocator::free(GpuAllocation& allocation)
+{
+    if (allocation.memory == VK_NULL_HANDLE) return;
+
+    const uint32_t index = allocation.block;
+    Block& block = *m_blocks[index];
+    block.live--;
+    block.used -= allocation.size;
+
+    if (block.dedicated) {
+        releaseBlock(index);
+        allocation = GpuAllocation{};
+        return;
+    }
+
+    if (block.strategy == AllocationStrategy::Linear) {
+        if (block.live == 0) block.head = 0;
+    } else {
+        // insert the range, then merge it with the free neighbours
+        auto it = block.freeRanges.emplace(allocation.offset, allocation.size).first;
+        auto next = std::next(it);
+        if (next != block.freeRanges.end() && it->first + it->second == next->first) {
+            it->second += next->second;
+            block.freeRanges.erase(next);
+        }
+        if (it != block.freeRanges.begin()) {
+            auto prev = std::prev(it);
+            if (prev->first + prev->second == it->first) {
+                prev->second += it->second;
+                block.freeRanges.erase(it);
+            }
+        }
+    }
+
+    // keep one empty block per pool for the next request, release the rest
+    if (block.live == 0) {
+        for (uint32_t i = 0; i < m_blocks.size(); ++i) {
+            const Block* other = m_blocks[i].get();
+            if (i != index && other && !other->dedicated && other->live == 0 &&
+                other->memoryType == block.memoryType && other->strategy == block.strategy) {
+                releaseBlock(index);
+                break;
+            }
+        }
+    }
+    allocation = GpuAllocation{};
+}
+
+// ----------------------------------------
+// stats
+// ----------------------------------------
+
+GpuMemoryStats GpuAllocator::stats() const
+{
+    GpuMemoryStats s;
+    s.memoryObjects = m_memoryObjects;
+    s.allocateCalls = m_allocateCalls;
+
+    VkDeviceSize freeBytes = 0;
+    for (const auto& b : m_blocks) {
+        if (!b) continue;
+        s.dedicated   += b->dedicated ? 1 : 0;
+        s.allocations += b->live;
+        s.reserved    += b->size;
+        s.used        += b->used;
+        for (const auto& range : b->freeRanges) {
+            freeBytes     += range.second;
+            s.largestFree  = std::max(s.largestFree, range.second);
+        }
+    }
+    if (freeBytes > 0)
+        s.fragmentation = 1.0 - double(s.largestFree) / double(freeBytes);
+    return s;
+}
+
+void GpuAllocator::report(const char* stage) const
+{
+    const GpuMemoryStats s = stats();
+    const double mb = 1024.0 * 1024.0;
+    std::cout << "GPU memory (" << stage << "): " << s.allocations << " allocations in "
+              << s.memoryObjects << " memory objects (" << s.dedicated << " dedicated, "
+              << s.allocateCalls << " vkAllocateMemory calls";
+    if (m_maxMemoryObjects) std::cout << ", limit " << m_maxMemoryObjects;
+    std::cout << "), " << s.used / mb << " of " << s.reserved / mb << " MB used, fragmentation "
+              << s.fragmentation * 100.0 << "%\n";
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+// Sub-allocates buffer memory from a few large VkDeviceMemory blocks, one
+// pool of blocks per memory type and strategy, instead of one
+// vkAllocateMemory per buffer (which is slow and capped by
+// maxMemoryAllocationCount).
+//
+//  - FreeList: long-lived buffers (vertex, index, indirect). Best-fit over
+//    the free ranges of a block; freed ranges merge with their neighbours.
+//  - Linear:   short-lived staging. A bump pointer that rewinds once every
+//    allocation in the block has been freed.
+//
+// Requests larger than half a block get a dedicated allocation. Host-visible
+// blocks are mapped once for their whole lifetime; GpuAllocation::mapped
+// points at the allocation inside that mapping, so callers must not call
+// vkMapMemory on it. Not thread-safe: used from the render thread only.
+
+enum class AllocationStrategy {
+    FreeList,
+    Linear
+};
+
+struct GpuAllocation {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize   offset = 0;
+    VkDeviceSize   size   = 0;
+    void*          mapped = nullptr;   // null unless host-visible
+    uint32_t       block  = 0;         // owner, internal to GpuAllocator
+};
+
+struct GpuMemoryStats {
+    size_t       memoryObjects = 0;    // live vkAllocateMemory results
+    size_t       dedicated     = 0;    // of which single-resource
+    size_t       allocations   = 0;    // live sub-allocations
+    size_t       allocateCalls = 0;    // vkAllocateMemory calls so far
+    VkDeviceSize reserved      = 0;    // bytes in memory objects
+    VkDeviceSize used          = 0;    // bytes handed out
+    VkDeviceSize largestFree   = 0;    // largest free range in any free-list block
+    double       fragmentation = 0.0;  // 1 - largest free range / free bytes, free-list blocks
+};
+
+class GpuAllocator {
+public:
+    GpuAllocator() = default;
+    ~GpuAllocator() { destroy(); }
+
+    GpuAllocator(const GpuAllocator&)            = delete;
+    GpuAllocator& operator=(const GpuAllocator&) = delete;
+
+    // blockSize is capped to 1/8 of each heap.
+    void init(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize);
+    void destroy();
+
+    // First memory type in typeFilter with all of properties; throws if none.
+    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+
+    // Whether allocate() with these properties would find a memory type and
+    // its heap would stay within HEAP_BUDGET of its size after size more
+    // bytes. Small heaps (a 256 MB BAR window) fill up quickly, so callers
+    // use this before preferring such memory.
+    bool hasRoom(uint32_t typeFilter, VkMemoryPropertyFlags properties, VkDeviceSize size) const;
+
+    GpuAllocation allocate(const VkMemoryRequirements& requirements,
+                           VkMemoryPropertyFlags properties,
+                           AllocationStrategy strategy);
+    void          free(GpuAllocation& allocation);
+
+    GpuMemoryStats stats() const;
+
+    // Prints "GPU memory (<stage>): ..." from stats().
+    void report(const char* stage) const;
+
+private:
+    static constexpr double HEAP_BUDGET = 0.75;   // leave the rest to the driver and other apps
+
+    struct Block {
+        VkDeviceMemory     memory     = VK_NULL_HANDLE;
+        VkDeviceSize       size       = 0;
+        uint8_t*           mapped     = nullptr;
+        uint32_t           memoryType = 0;
+        AllocationStrategy strategy   = AllocationStrategy::FreeList;
+        bool               dedicated  = false;
+        size_t             live       = 0;      // allocations in the block
+        VkDeviceSize       used       = 0;
+        VkDeviceSize       head       = 0;      // Linear: next free byte
+        std::map<VkDeviceSize, VkDeviceSize> freeRanges;   // FreeList: offset -> size
+    };
+
+    uint32_t createBlock(uint32_t memoryType, VkDeviceSize size,
+                         AllocationStrategy strategy, bool dedicated);
+    void     releaseBlock(uint32_t index);
+    bool     allocateFrom(Block& block, VkDeviceSize size, VkDeviceSize alignment,
+                          VkDeviceSize& offset);
+
+    VkDevice                         m_device = VK_NULL_HANDLE;
+    VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+    VkDeviceSize                     m_blockSize          = 0;
+    uint32_t                         m_maxMemoryObjects   = 0;
+    size_t                           m_memoryObjects      = 0;
+    size_t                           m_allocateCalls      = 0;
+    std::vector<std::unique_ptr<Block>> m_blocks;   // null slots are reused
+};
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+
+// 64-bit hashing shared by the mesh cache key and the weld tables.
+
+// MurmurHash3 finalizer: every input bit affects every output bit.
+inline uint64_t mix64(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// Order-dependent: combineHash(a, b) != combineHash(b, a).
+inline uint64_t combineHash(uint64_t seed, uint64_t value)
+{
+    return mix64(seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2)));
+}
@@ -0,0 +1,189 @@
+#include "IndexChunks.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+// Triangles per independent slice; chunks never cross a slice boundary,
+// which costs a partly filled chunk per slice but lets slices run in parallel.
+static constexpr size_t SLICE_TRIANGLES = 1u << 19;
+
+static constexpr uint32_t EMPTY_SLOT = std::numeric_limits<uint32_t>::max();
+
+namespace {
+
+struct Slice {
+    uint32_t firstTriangle = 0;
+    uint32_t triangleCount = 0;
+};
+
+struct SliceOutput {
+    std::vector<Vertex>   vertices;
+    std::vector<uint32_t> indices;    // local to their chunk
+    std::vector<SubMesh>  chunks;     // offsets relative to this slice
+};
+
+// Global vertex -> chunk-local index. Open addressing over a table twice
+// the chunk limit; cleared per chunk, so it stays cache resident.
+class LocalIndexMap {
+public:
+    LocalIndexMap() : m_keys(TABLE_SIZE), m_values(TABLE_SIZE) { clear(); }
+
+    void clear() { std::fill(m_keys.begin(), m_keys.end(), EMPTY_SLOT); }
+
+    // Returns the slot for global; *found tells whether it is already mapped.
+    size_t find(uint32_t global, bool& found) const {
+        size_t slot = (global * 0x9E3779B1u) >> (32 - TABLE_BITS);
+        for (;;) {
+            if (m_keys[slot] == global) { found = true;  return slot; }
+            if (m_keys[slot] == EMPTY_SLOT) { found = false; return slot; }
+            slot = (slot + 1) & (TABLE_SIZE - 1);
+        }
+    }
+    uint32_t value(size_t slot) const { return m_values[slot]; }
+    void insert(size_t slot, uint32_t global, uint32_t local) {
+        m_keys[slot]   = global;
+        m_values[slot] = local;
+    }
+
+private:
+    static constexpr unsigned TABLE_BITS = 17;
+    static constexpr size_t   TABLE_SIZE = size_t(1) << TABLE_BITS;
+
+    std::vector<uint32_t> m_keys;
+    std::vector<uint32_t> m_values;
+};
+
+} // namespace
+
+// Greedy: a chunk takes triangles until the next one would push it past
+// MAX_CHUNK_VERTICES distinct vertices.
+static void splitSlice(const MeshData& mesh, const Slice& slice, SliceOutput& out)
+{
+    LocalIndexMap map;
+    SubMesh chunk{};
+
+    auto closeChunk = [&]() {
+        chunk.indexCount  = static_cast<uint32_t>(out.indices.size()) - chunk.firstIndex;
+        chunk.vertexCount = static_cast<uint32_t>(out.vertices.size()) - chunk.firstVertex;
+        chunk.baseVertex  = chunk.firstVertex;
+        if (chunk.indexCount > 0) out.chunks.push_back(chunk);
+        chunk.firstIndex  = static_cast<uint32_t>(out.indices.size());
+        chunk.firstVertex = static_cast<uint32_t>(out.vertices.size());
+        map.clear();
+    };
+
+    const uint32_t* idx = mesh.indices.data();
+    for (uint32_t t = slice.firstTriangle; t < slice.firstTriangle + slice.triangleCount; ++t) {
+        const uint32_t* tri = idx + size_t(t) * 3;
+        if (tri[0] >= mesh.vertices.size() || tri[1] >= mesh.vertices.size() ||
+            tri[2] >= mesh.vertices.size())
+            throw std::runtime_error("Mesh index out of range");
+
+        // distinct vertices this triangle would add to the chunk
+        uint32_t fresh = 0;
+        for (int k = 0; k < 3; ++k) {
+            bool found;
+            map.find(tri[k], found);
+            bool repeat = (k > 0 && tri[k] == tri[0]) || (k > 1 && tri[k] == tri[1]);
+            if (!found && !repeat) ++fresh;
+        }
+
+        const uint32_t used = static_cast<uint32_t>(out.vertices.size()) - chunk.firstVertex;
+        if (used + fresh > MAX_CHUNK_VERTICES) closeChunk();
+
+        for (int k = 0; k < 3; ++k) {
+            bool   found;
+            size_t slot = map.find(tri[k], found);
+            uint32_t local;
+            if (found) {
+                local = map.value(slot);
+            } else {
+                local = static_cast<uint32_t>(out.vertices.size()) - chunk.firstVertex;
+                map.insert(slot, tri[k], local);
+                out.vertices.push_back(mesh.vertices[tri[k]]);
+            }
+            out.indices.push_back(local);
+        }
+    }
+    closeChunk();
+}
+
+IndexChunkStats splitIntoIndexChunks(MeshData& mesh)
+{
+    auto t0 = std::chrono::steady_clock::now();
+
+    IndexChunkStats stats;
+    stats.verticesBefore = mesh.vertices.size();
+    stats.verticesAfter  = mesh.vertices.size();
+    stats.chunks         = mesh.submeshes.size();
+    if (mesh.vertices.size() <= MAX_CHUNK_VERTICES) return stats;   // already 16-bit
+
+    for (const SubMesh& s : mesh.submeshes)
+        if (s.baseVertex != 0)
+            throw std::runtime_error("Mesh is already split into index chunks");
+
+    // slices follow submesh boundaries, so chunks never mix parts
+    std::vector<Slice> slices;
+    for (const SubMesh& s : mesh.submeshes) {
+        const uint32_t first = s.firstIndex / 3;
+        const uint32_t count = s.indexCount / 3;
+        for (uint32_t t = 0; t < count; t += static_cast<uint32_t>(SLICE_TRIANGLES)) {
+            Slice slice;
+            slice.firstTriangle = first + t;
+            slice.triangleCount = std::min<uint32_t>(static_cast<uint32_t>(SLICE_TRIANGLES), count - t);
+            slices.push_back(slice);
+        }
+    }
+
+    std::vector<SliceOutput> outputs(slices.size());
+    parallelTasks(slices.size(), [&](size_t s) { splitSlice(mesh, slices[s], outputs[s]); });
+
+    // concatenate; offsets move from slice-relative to global
+    std::vector<size_t> vertexStart(slices.size() + 1, 0);
+    std::vector<size_t> indexStart(slices.size() + 1, 0);
+    std::vector<size_t> chunkStart(slices.size() + 1, 0);
+    for (size_t s = 0; s < slices.size(); ++s) {
+        vertexStart[s + 1] = vertexStart[s] + outputs[s].vertices.size();
+        indexStart[s + 1]  = indexStart[s]  + outputs[s].indices.size();
+        chunkStart[s + 1]  = chunkStart[s]  + outputs[s].chunks.size();
+    }
+    if (vertexStart.back() > std::numeric_limits<uint32_t>::max())
+        throw std::runtime_error("Index chunks need more than 2^32 vertices");
+
+    MeshData result;
+    result.hasNormals = mesh.hasNormals;
+    mesh.vertices.clear();
+    mesh.vertices.shrink_to_fit();
+    mesh.indices.clear();
+    mesh.indices.shrink_to_fit();
+
+    result.vertices.resize(vertexStart.back());
+    result.indices.resize(indexStart.back());
+    result.submeshes.resize(chunkStart.back());
+
+    parallelTasks(slices.size(), [&](size_t s) {
+        SliceOutput& o = outputs[s];
+        std::copy(o.vertices.begin(), o.vertices.end(), result.vertices.begin() + vertexStart[s]);
+        std::copy(o.indices.begin(),  o.indices.end(),  result.indices.begin()  + indexStart[s]);
+        for (size_t c = 0; c < o.chunks.size(); ++c) {
+            SubMesh chunk = o.chunks[c];
+            chunk.firstIndex  += static_cast<uint32_t>(indexStart[s]);
+            chunk.firstVertex += static_cast<uint32_t>(vertexStart[s]);
+            chunk.baseVertex   = chunk.firstVertex;
+            result.submeshes[chunkStart[s] + c] = chunk;
+        }
+        o = SliceOutput{};
+    });
+
+    mesh = std::move(result);
+
+    stats.chunks        = mesh.submeshes.size();
+    stats.verticesAfter = mesh.vertices.size();
+    stats.milliseconds  = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - t0).count();
+    return stats;
+}
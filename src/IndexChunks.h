@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "MeshLoader.h"
+
+// Splits meshes with more than 64k vertices into chunks that each
+// reference at most 65536 vertices, so every index fits in 16 bits.
+//
+// Triangles keep their order and are cut into runs; each run gets its own
+// contiguous copy of the vertices it uses (vertices shared by two chunks
+// are duplicated) and indices become local to it. Every chunk is a SubMesh
+// with baseVertex set, which becomes the draw's vertexOffset. Run after all
+// stages that expect global indices (weld, normals, PLY export).
+
+struct IndexChunkStats {
+    size_t chunks         = 0;
+    size_t verticesBefore = 0;
+    size_t verticesAfter  = 0;   // larger by the duplicated boundary vertices
+    double milliseconds   = 0.0;
+};
+
+static constexpr uint32_t MAX_CHUNK_VERTICES = 1u << 16;
+
+IndexChunkStats splitIntoIndexChunks(MeshData& mesh);
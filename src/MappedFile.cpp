@@ -0,0 +1,112 @@
+#include "MappedFile.h"
+
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Failed to open file for mapping: " + path);
+    }
+    m_file = file;
+
+    LARGE_INTEGER size{};
+    if (!GetFileSizeEx(file, &size)) {
+        close();
+        throw std::runtime_error("Failed to query file size: " + path);
+    }
+    m_size   = static_cast<size_t>(size.QuadPart);
+    m_opened = true;
+    if (m_size == 0) return;
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        close();
+        throw std::runtime_error("Failed to create file mapping: " + path);
+    }
+    m_mapping = mapping;
+
+    m_data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!m_data) {
+        close();
+        throw std::runtime_error("Failed to map file: " + path);
+    }
+#else
+    m_fd = ::open(path.c_str(), O_RDONLY);
+    if (m_fd < 0) {
+        throw std::runtime_error("Failed to open file for mapping: " + path);
+    }
+
+    struct stat st{};
+    if (fstat(m_fd, &st) != 0) {
+        close();
+        throw std::runtime_error("Failed to query file size: " + path);
+    }
+    m_size   = static_cast<size_t>(st.st_size);
+    m_opened = true;
+    if (m_size == 0) return;
+
+    void* ptr = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+    if (ptr == MAP_FAILED) {
+        close();
+        throw std::runtime_error("Failed to map file: " + path);
+    }
+    madvise(ptr, m_size, MADV_SEQUENTIAL);
+    m_data = static_cast<const uint8_t*>(ptr);
+#endif
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        m_data   = std::exchange(other.m_data, nullptr);
+        m_size   = std::exchange(other.m_size, 0);
+        m_opened = std::exchange(other.m_opened, false);
+#ifdef _WIN32
+        m_file    = std::exchange(other.m_file, nullptr);
+        m_mapping = std::exchange(other.m_mapping, nullptr);
+#else
+        m_fd      = std::exchange(other.m_fd, -1);
+#endif
+    }
+    return *this;
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+    if (m_data)    UnmapViewOfFile(m_data);
+    if (m_mapping) CloseHandle(static_cast<HANDLE>(m_mapping));
+    if (m_file)    CloseHandle(static_cast<HANDLE>(m_file));
+    m_file    = nullptr;
+    m_mapping = nullptr;
+#else
+    if (m_data)    munmap(const_cast<uint8_t*>(m_data), m_size);
+    if (m_fd >= 0) ::close(m_fd);
+    m_fd = -1;
+#endif
+    m_data   = nullptr;
+    m_size   = 0;
+    m_opened = false;
+}
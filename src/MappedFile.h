@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read-only memory mapping of a whole file.
+// The mapping stays valid for the lifetime of the object.
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&)            = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    const uint8_t* data() const { return m_data; }
+    size_t         size() const { return m_size; }
+    bool           isOpen() const { return m_opened; }
+
+private:
+    void close();
+
+    const uint8_t* m_data   = nullptr;
+    size_t         m_size   = 0;
+    bool           m_opened = false;
+
+#ifdef _WIN32
+    void* m_file    = nullptr;
+    void* m_mapping = nullptr;
+#else
+    int   m_fd      = -1;
+#endif
+};
@@ -0,0 +1,62 @@
+#include "MemoryUsage.h"
+
+#include <iostream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__linux__)
+#include <cstdio>
+#include <cstring>
+#else
+#include <sys/resource.h>
+#endif
+
+MemoryUsage queryMemoryUsage()
+{
+    MemoryUsage usage;
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters{};
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        usage.currentBytes = counters.WorkingSetSize;
+        usage.peakBytes    = counters.PeakWorkingSetSize;
+    }
+#elif defined(__linux__)
+    // values are in kB
+    if (FILE* f = std::fopen("/proc/self/status", "r")) {
+        char line[256];
+        while (std::fgets(line, sizeof(line), f)) {
+            unsigned long long kb = 0;
+            if (std::strncmp(line, "VmRSS:", 6) == 0 && std::sscanf(line + 6, "%llu", &kb) == 1)
+                usage.currentBytes = static_cast<size_t>(kb) * 1024;
+            else if (std::strncmp(line, "VmHWM:", 6) == 0 && std::sscanf(line + 6, "%llu", &kb) == 1)
+                usage.peakBytes = static_cast<size_t>(kb) * 1024;
+        }
+        std::fclose(f);
+    }
+#else
+    // macOS / BSD: only the peak is available here, in bytes on macOS
+    // and in kB on the BSDs
+    rusage ru{};
+    if (getrusage(RUSAGE_SELF, &ru) == 0) {
+#ifdef __APPLE__
+        usage.peakBytes = static_cast<size_t>(ru.ru_maxrss);
+#else
+        usage.peakBytes = static_cast<size_t>(ru.ru_maxrss) * 1024;
+#endif
+    }
+#endif
+    return usage;
+}
+
+void reportMemoryUsage(const char* stage)
+{
+    const MemoryUsage usage = queryMemoryUsage();
+    const double mb = 1024.0 * 1024.0;
+    std::cout << "Memory (" << stage << "): current "
+              << static_cast<double>(usage.currentBytes) / mb << " MB, peak "
+              << static_cast<double>(usage.peakBytes) / mb << " MB\n";
+}
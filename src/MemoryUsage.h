@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+
+// Resident memory of this process, for tracking where the peak happens
+// while a mesh is imported and uploaded. Zero when the platform does not
+// report a value.
+struct MemoryUsage {
+    size_t currentBytes = 0;   // working set / VmRSS
+    size_t peakBytes    = 0;   // peak working set / VmHWM
+};
+
+MemoryUsage queryMemoryUsage();
+
+// Prints "Memory (<stage>): current X MB, peak Y MB".
+void reportMemoryUsage(const char* stage);
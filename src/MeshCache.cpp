@@ -0,0 +1,302 @@
+#include "MeshCache.h"
+#include "Hash.h"
+#include "MeshLoader.h"
+#include "Parallel.h"
+#include "config.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+// ----------------------------------------
+// file layout
+// ----------------------------------------
+
+static constexpr char     CACHE_MAGIC[8]  = { 'X', 'R', 'M', 'C', 'A', 'C', 'H', 'E' };
+static constexpr uint32_t CACHE_VERSION   = 6;
+static constexpr uint64_t CACHE_ALIGNMENT = 64;
+
+struct CacheHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t vertexStride;
+    uint64_t sourceHash;
+    uint64_t settingsHash;
+    uint64_t vertexCount;
+    uint64_t indexCount;
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    uint64_t submeshCount;
+    uint64_t submeshOffset;
+    uint64_t clusterCount;
+    uint64_t clusterOffset;
+    uint64_t lodCount;
+    uint64_t lodOffset;
+    uint64_t lodRangeCount;
+    uint64_t lodRangeOffset;
+    float    boundsMin[3];
+    float    boundsMax[3];
+    float    center[3];
+    float    radius;
+};
+static_assert(sizeof(CacheHeader) == 168, "CacheHeader layout must not change silently");
+
+static uint64_t alignUp(uint64_t v, uint64_t a)
+{
+    return (v + a - 1) / a * a;
+}
+
+// ----------------------------------------
+// hashing
+// ----------------------------------------
+
+static uint64_t hashBlock(const uint8_t* p, size_t n)
+{
+    uint64_t h = 0x9e3779b97f4a7c15ULL ^ n;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t w;
+        std::memcpy(&w, p + i, 8);
+        h = (h ^ (w * 0x87c37b91114253d5ULL)) * 0x4cf5ad432745937fULL;
+        h = (h << 31) | (h >> 33);
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, p + i, n - i);
+    return mix64(h ^ tail);
+}
+
+static uint64_t hashFileContents(const std::string& path)
+{
+    constexpr size_t BLOCK_BYTES = 8u << 20;
+
+    MappedFile file(path);
+    const size_t blocks = (file.size() + BLOCK_BYTES - 1) / BLOCK_BYTES;
+    std::vector<uint64_t> blockHashes(blocks);
+
+    parallelTasks(blocks, [&](size_t b) {
+        size_t begin = b * BLOCK_BYTES;
+        size_t len   = std::min(BLOCK_BYTES, file.size() - begin);
+        blockHashes[b] = hashBlock(file.data() + begin, len);
+    });
+
+    uint64_t h = file.size();
+    for (uint64_t bh : blockHashes) h = combineHash(h, bh);
+    return h;
+}
+
+// ----------------------------------------
+// key / path
+// ----------------------------------------
+
+MeshCacheKey makeMeshCacheKey(const std::string& sourcePath)
+{
+    MeshCacheKey key;
+    key.sourceHash = hashFileContents(sourcePath);
+
+    // everything that changes the processed result belongs in here
+    uint64_t h = CACHE_VERSION;
+    h = combineHash(h, meshImportFlags());
+    h = combineHash(h, Config::USE_NATIVE_READERS ? 1 : 0);
+    h = combineHash(h, sizeof(VulkanVertex));
+    h = combineHash(h, Config::WELD_VERTICES ? 1 : 0);
+    uint32_t epsBits;
+    std::memcpy(&epsBits, &Config::WELD_EPSILON, sizeof(epsBits));
+    h = combineHash(h, epsBits);
+    uint32_t creaseBits;
+    std::memcpy(&creaseBits, &Config::NORMAL_CREASE_ANGLE, sizeof(creaseBits));
+    h = combineHash(h, creaseBits);
+    h = combineHash(h, Config::NORMAL_ANGLE_WEIGHTED ? 1 : 0);
+    h = combineHash(h, Config::NORMALIZE_IN_MODEL_MATRIX ? 1 : 0);
+    h = combineHash(h, Config::OPTIMIZE_VERTEX_CACHE ? 1 : 0);
+    h = combineHash(h, Config::SPLIT_INDEX_CHUNKS ? 1 : 0);
+    h = combineHash(h, Config::CLUSTER_CULLING ? 1 : 0);
+    h = combineHash(h, Config::LOD_LEVELS);
+    key.settingsHash = h;
+    return key;
+}
+
+std::string meshCachePath(const std::string& sourcePath)
+{
+    std::filesystem::path src(sourcePath);
+    std::string dir = Config::MESH_CACHE_DIR;
+    if (dir.empty())
+        return sourcePath + ".xrcache";
+    return (std::filesystem::path(dir) / src.filename()).string() + ".xrcache";
+}
+
+// ----------------------------------------
+// read
+// ----------------------------------------
+
+bool MeshCacheFile::open(const std::string& path, const MeshCacheKey& key)
+{
+    close();
+    m_vertices = nullptr;
+    m_indices  = nullptr;
+    m_submeshes = nullptr;
+    m_clusters  = nullptr;
+    m_lods      = nullptr;
+    m_lodRanges = nullptr;
+
+    std::error_code ec;
+    if (!std::filesystem::exists(path, ec)) return false;
+
+    // a cache that cannot be opened or mapped is a miss, not an error
+    MappedFile file;
+    try {
+        file = MappedFile(path);
+    } catch (const std::exception& e) {
+        std::cout << "Mesh cache cannot be read (" << e.what() << "), ignoring\n";
+        return false;
+    }
+    if (file.size() < sizeof(CacheHeader)) return false;
+
+    CacheHeader h;
+    std::memcpy(&h, file.data(), sizeof(h));
+
+    if (std::memcmp(h.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+        h.version != CACHE_VERSION ||
+        h.vertexStride != sizeof(VulkanVertex)) {
+        std::cout << "Mesh cache has an incompatible format, ignoring\n";
+        return false;
+    }
+    if (h.sourceHash != key.sourceHash || h.settingsHash != key.settingsHash) {
+        std::cout << "Mesh cache is stale (source or settings changed)\n";
+        return false;
+    }
+
+    const uint64_t vertexBytes = h.vertexCount * sizeof(VulkanVertex);
+    const uint64_t indexBytes  = h.indexCount * sizeof(uint32_t);
+    const uint64_t subBytes    = h.submeshCount * sizeof(SubMesh);
+    const uint64_t clusterBytes = h.clusterCount * sizeof(MeshCluster);
+    const uint64_t lodBytes     = h.lodCount * sizeof(MeshLod);
+    const uint64_t lodRangeBytes = h.lodRangeCount * sizeof(SubMesh);
+    if (h.vertexOffset % alignof(VulkanVertex) != 0 || h.indexOffset % alignof(uint32_t) != 0 ||
+        h.submeshOffset % alignof(SubMesh) != 0 || h.clusterOffset % alignof(MeshCluster) != 0 ||
+        h.lodOffset % alignof(MeshLod) != 0 || h.lodRangeOffset % alignof(SubMesh) != 0 ||
+        h.vertexOffset + vertexBytes > file.size() || h.indexOffset + indexBytes > file.size() ||
+        h.submeshOffset + subBytes > file.size() || h.clusterOffset + clusterBytes > file.size() ||
+        h.lodOffset + lodBytes > file.size() || h.lodRangeOffset + lodRangeBytes > file.size()) {
+        std::cout << "Mesh cache is truncated, ignoring\n";
+        return false;
+    }
+
+    m_file        = std::move(file);
+    m_vertices    = reinterpret_cast<const VulkanVertex*>(m_file.data() + h.vertexOffset);
+    m_indices     = reinterpret_cast<const uint32_t*>(m_file.data() + h.indexOffset);
+    m_vertexCount = static_cast<size_t>(h.vertexCount);
+    m_indexCount  = static_cast<size_t>(h.indexCount);
+    m_submeshes    = reinterpret_cast<const SubMesh*>(m_file.data() + h.submeshOffset);
+    m_submeshCount = static_cast<size_t>(h.submeshCount);
+    m_clusters     = reinterpret_cast<const MeshCluster*>(m_file.data() + h.clusterOffset);
+    m_clusterCount = static_cast<size_t>(h.clusterCount);
+    m_lods          = reinterpret_cast<const MeshLod*>(m_file.data() + h.lodOffset);
+    m_lodCount      = static_cast<size_t>(h.lodCount);
+    m_lodRanges     = reinterpret_cast<const SubMesh*>(m_file.data() + h.lodRangeOffset);
+    m_lodRangeCount = static_cast<size_t>(h.lodRangeCount);
+
+    m_bounds.min    = glm::vec3(h.boundsMin[0], h.boundsMin[1], h.boundsMin[2]);
+    m_bounds.max    = glm::vec3(h.boundsMax[0], h.boundsMax[1], h.boundsMax[2]);
+    m_bounds.center = glm::vec3(h.center[0], h.center[1], h.center[2]);
+    m_bounds.radius = h.radius;
+    return true;
+}
+
+// ----------------------------------------
+// write
+// ----------------------------------------
+
+void writeMeshCache(const std::string& path,
+                    const MeshCacheKey& key,
+                    const MeshData& mesh,
+                    const MeshBounds& bounds)
+{
+    const std::vector<Vertex>&   vertices  = mesh.vertices;
+    const std::vector<uint32_t>& indices   = mesh.indices;
+    const std::vector<SubMesh>&  submeshes = mesh.submeshes;
+    const std::vector<MeshCluster>& clusters = mesh.clusters;
+    const std::vector<MeshLod>&     lods      = mesh.lods;
+    const std::vector<SubMesh>&     lodRanges = mesh.lodRanges;
+
+    CacheHeader h{};
+    std::memcpy(h.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    h.version      = CACHE_VERSION;
+    h.vertexStride = sizeof(VulkanVertex);
+    h.sourceHash   = key.sourceHash;
+    h.settingsHash = key.settingsHash;
+    h.vertexCount  = vertices.size();
+    h.indexCount   = indices.size();
+    h.vertexOffset = alignUp(sizeof(CacheHeader), CACHE_ALIGNMENT);
+    h.indexOffset  = alignUp(h.vertexOffset + vertices.size() * sizeof(VulkanVertex), CACHE_ALIGNMENT);
+    h.submeshCount  = submeshes.size();
+    h.submeshOffset = alignUp(h.indexOffset + indices.size() * sizeof(uint32_t), CACHE_ALIGNMENT);
+    h.clusterCount  = clusters.size();
+    h.clusterOffset = alignUp(h.submeshOffset + submeshes.size() * sizeof(SubMesh), CACHE_ALIGNMENT);
+    h.lodCount       = lods.size();
+    h.lodOffset      = alignUp(h.clusterOffset + clusters.size() * sizeof(MeshCluster), CACHE_ALIGNMENT);
+    h.lodRangeCount  = lodRanges.size();
+    h.lodRangeOffset = alignUp(h.lodOffset + lods.size() * sizeof(MeshLod), CACHE_ALIGNMENT);
+    for (int i = 0; i < 3; ++i) {
+        h.boundsMin[i] = bounds.min[i];
+        h.boundsMax[i] = bounds.max[i];
+        h.center[i]    = bounds.center[i];
+    }
+    h.radius = bounds.radius;
+
+    // write next to the target and rename, so a crash never leaves a
+    // half-written file that passes the header check
+    const std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream ofs(tmpPath, std::ios::out | std::ios::trunc | std::ios::binary);
+        if (!ofs) {
+            std::cerr << "Warning: cannot write mesh cache " << path << "\n";
+            return;
+        }
+
+        static const char zeros[CACHE_ALIGNMENT] = {};
+        ofs.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        ofs.write(zeros, static_cast<std::streamsize>(h.vertexOffset - sizeof(h)));
+        ofs.write(reinterpret_cast<const char*>(vertices.data()),
+                  static_cast<std::streamsize>(vertices.size() * sizeof(VulkanVertex)));
+        ofs.write(zeros, static_cast<std::streamsize>(
+                      h.indexOffset - h.vertexOffset - vertices.size() * sizeof(VulkanVertex)));
+        ofs.write(reinterpret_cast<const char*>(indices.data()),
+                  static_cast<std::streamsize>(indices.size() * sizeof(uint32_t)));
+        ofs.write(zeros, static_cast<std::streamsize>(
+                      h.submeshOffset - h.indexOffset - indices.size() * sizeof(uint32_t)));
+        ofs.write(reinterpret_cast<const char*>(submeshes.data()),
+                  static_cast<std::streamsize>(submeshes.size() * sizeof(SubMesh)));
+        ofs.write(zeros, static_cast<std::streamsize>(
+                      h.clusterOffset - h.submeshOffset - submeshes.size() * sizeof(SubMesh)));
+        ofs.write(reinterpret_cast<const char*>(clusters.data()),
+                  static_cast<std::streamsize>(clusters.size() * sizeof(MeshCluster)));
+        ofs.write(zeros, static_cast<std::streamsize>(
+                      h.lodOffset - h.clusterOffset - clusters.size() * sizeof(MeshCluster)));
+        ofs.write(reinterpret_cast<const char*>(lods.data()),
+                  static_cast<std::streamsize>(lods.size() * sizeof(MeshLod)));
+        ofs.write(zeros, static_cast<std::streamsize>(
+                      h.lodRangeOffset - h.lodOffset - lods.size() * sizeof(MeshLod)));
+        ofs.write(reinterpret_cast<const char*>(lodRanges.data()),
+                  static_cast<std::streamsize>(lodRanges.size() * sizeof(SubMesh)));
+
+        if (!ofs) {
+            std::cerr << "Warning: failed writing mesh cache " << path << "\n";
+            ofs.close();
+            std::error_code ec;
+            std::filesystem::remove(tmpPath, ec);
+            return;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, path, ec);
+    if (ec) {
+        std::cerr << "Warning: failed to finalize mesh cache " << path << ": " << ec.message() << "\n";
+        std::filesystem::remove(tmpPath, ec);
+        return;
+    }
+    std::cout << "Wrote mesh cache: " << path << "\n";
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+#include "MeshUtils.h"
+#include "VulkanVertex.h"
+
+// On-disk cache of the fully processed mesh (GPU vertex layout, indices,
+// submesh draw ranges, culling clusters, LOD levels and the bounds of the
+// stored positions). A cache file is only used when both the source file
+// contents and the import settings match the key it was written with.
+
+struct MeshCacheKey {
+    uint64_t sourceHash   = 0;   // hash of the source file contents
+    uint64_t settingsHash = 0;   // import flags + pipeline options + format version
+};
+
+MeshCacheKey makeMeshCacheKey(const std::string& sourcePath);
+std::string  meshCachePath(const std::string& sourcePath);
+
+// Read-only view of a cache file. The arrays point straight into the
+// memory mapping, so they can be copied into GPU staging memory directly.
+class MeshCacheFile {
+public:
+    // Maps the cache and validates it against key; false on miss / mismatch.
+    bool open(const std::string& path, const MeshCacheKey& key);
+    void close() { m_file = MappedFile{}; }
+    bool isOpen() const { return m_vertices != nullptr && m_file.isOpen(); }
+
+    const VulkanVertex* vertices()    const { return m_vertices; }
+    const uint32_t*     indices()     const { return m_indices; }
+    const SubMesh*      submeshes()   const { return m_submeshes; }
+    size_t              vertexCount() const { return m_vertexCount; }
+    size_t              indexCount()  const { return m_indexCount; }
+    size_t              submeshCount() const { return m_submeshCount; }
+    const MeshCluster*  clusters()    const { return m_clusters; }
+    size_t              clusterCount() const { return m_clusterCount; }
+    const MeshLod*      lods()        const { return m_lods; }
+    size_t              lodCount()    const { return m_lodCount; }
+    const SubMesh*      lodRanges()   const { return m_lodRanges; }
+    size_t              lodRangeCount() const { return m_lodRangeCount; }
+    const MeshBounds&   bounds()      const { return m_bounds; }
+
+private:
+    MappedFile          m_file;
+    const VulkanVertex* m_vertices    = nullptr;
+    const uint32_t*     m_indices     = nullptr;
+    const SubMesh*      m_submeshes   = nullptr;
+    size_t              m_vertexCount = 0;
+    size_t              m_indexCount  = 0;
+    size_t              m_submeshCount = 0;
+    const MeshCluster*  m_clusters    = nullptr;
+    size_t              m_clusterCount = 0;
+    const MeshLod*      m_lods        = nullptr;
+    size_t              m_lodCount    = 0;
+    const SubMesh*      m_lodRanges   = nullptr;
+    size_t              m_lodRangeCount = 0;
+    MeshBounds          m_bounds{};
+};
+
+void writeMeshCache(const std::string& path,
+                    const MeshCacheKey& key,
+                    const MeshData& mesh,
+                    const MeshBounds& bounds);
@@ -0,0 +1,215 @@
+#include "MeshClusters.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+// triangles per build task; clusters never straddle two slices
+static constexpr uint32_t SLICE_TRIANGLES = 1u << 16;
+
+// a cone wider than this cannot reject anything useful
+static constexpr float MIN_CONE_DOT = 0.1f;
+
+namespace {
+
+struct Slice {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    uint32_t baseVertex;
+};
+
+// Vertices of the cluster being built: open addressing, sized for the
+// 3 * MAX_CLUSTER_TRIANGLES worst case at under half load.
+class VertexSet {
+public:
+    void clear() { std::fill(m_slots.begin(), m_slots.end(), EMPTY); }
+
+    bool contains(uint32_t v) const
+    {
+        for (uint32_t h = hash(v);; h = (h + 1) & MASK) {
+            if (m_slots[h] == v) return true;
+            if (m_slots[h] == EMPTY) return false;
+        }
+    }
+
+    void insert(uint32_t v)
+    {
+        uint32_t h = hash(v);
+        while (m_slots[h] != EMPTY && m_slots[h] != v) h = (h + 1) & MASK;
+        m_slots[h] = v;
+    }
+
+private:
+    static constexpr uint32_t SIZE  = 1024;
+    static constexpr uint32_t MASK  = SIZE - 1;
+    static constexpr uint32_t EMPTY = std::numeric_limits<uint32_t>::max();
+    static_assert(SIZE >= 2 * 3 * MAX_CLUSTER_TRIANGLES, "VertexSet too small");
+
+    static uint32_t hash(uint32_t v) { return (v * 2654435761u) >> 22; }
+
+    std::array<uint32_t, SIZE> m_slots{};
+};
+
+} // namespace
+
+// ----------------------------------------
+// bounds
+// ----------------------------------------
+
+static void computeClusterBounds(MeshCluster& c, const Vertex* verts, const uint32_t* indices)
+{
+    const float inf = std::numeric_limits<float>::max();
+    glm::vec3 lo(inf), hi(-inf);
+    for (uint32_t i = 0; i < c.indexCount; ++i) {
+        const glm::vec3& p = verts[indices[i]].pos;
+        lo = glm::min(lo, p);
+        hi = glm::max(hi, p);
+    }
+    const glm::vec3 center = 0.5f * (lo + hi);
+
+    float r2 = 0.0f;
+    glm::vec3 normalSum(0.0f);
+    std::vector<glm::vec3> normals;
+    normals.reserve(c.indexCount / 3);
+    for (uint32_t i = 0; i < c.indexCount; i += 3) {
+        const glm::vec3 p[3] = { verts[indices[i]].pos, verts[indices[i + 1]].pos,
+                                 verts[indices[i + 2]].pos };
+        for (const glm::vec3& q : p) {
+            const glm::vec3 d = q - center;
+            r2 = std::max(r2, glm::dot(d, d));
+        }
+        const glm::vec3 n   = glm::cross(p[1] - p[0], p[2] - p[0]);
+        const float     len = glm::length(n);
+        if (len > 0.0f) {
+            normals.push_back(n / len);
+            normalSum += normals.back();
+        }
+    }
+
+    for (int k = 0; k < 3; ++k) c.center[k] = center[k];
+    c.radius     = std::sqrt(r2);
+    c.coneCutoff = 1.0f;
+
+    const float sumLen = glm::length(normalSum);
+    if (normals.empty() || sumLen <= 0.0f) return;
+    const glm::vec3 axis = normalSum / sumLen;
+
+    float minDot = 1.0f;
+    for (const glm::vec3& n : normals) minDot = std::min(minDot, glm::dot(n, axis));
+    if (minDot < MIN_CONE_DOT) return;
+
+    for (int k = 0; k < 3; ++k) c.coneAxis[k] = axis[k];
+    c.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+
+// ----------------------------------------
+// build
+// ----------------------------------------
+
+// Greedy cut along the index order: a cluster ends at MAX_CLUSTER_TRIANGLES,
+// or earlier once it has MIN_CLUSTER_TRIANGLES and the next triangle shares
+// no vertex with it (the cache-optimized order jumps there).
+static void buildSliceClusters(const MeshData& mesh, const Slice& s, std::vector<MeshCluster>& out)
+{
+    const Vertex*   verts   = mesh.vertices.data() + s.baseVertex;
+    const uint32_t* indices = mesh.indices.data();
+
+    VertexSet members;
+    members.clear();
+
+    MeshCluster current;
+    current.firstIndex = s.firstIndex;
+    current.baseVertex = s.baseVertex;
+
+    auto finish = [&]() {
+        if (current.indexCount == 0) return;
+        computeClusterBounds(current, verts, indices + current.firstIndex);
+        out.push_back(current);
+        current.firstIndex += current.indexCount;
+        current.indexCount  = 0;
+        members.clear();
+    };
+
+    const uint32_t end = s.firstIndex + s.indexCount;
+    for (uint32_t i = s.firstIndex; i + 2 < end; i += 3) {
+        const uint32_t triangles = current.indexCount / 3;
+        if (triangles >= MAX_CLUSTER_TRIANGLES) {
+            finish();
+        } else if (triangles >= MIN_CLUSTER_TRIANGLES) {
+            bool connected = false;
+            for (int k = 0; k < 3 && !connected; ++k)
+                connected = members.contains(indices[i + k]);
+            if (!connected) finish();
+        }
+        for (int k = 0; k < 3; ++k) members.insert(indices[i + k]);
+        current.indexCount += 3;
+    }
+    finish();
+}
+
+ClusterStats buildClusters(MeshData& mesh)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    ClusterStats stats;
+    mesh.clusters.clear();
+
+    std::vector<Slice> slices;
+    for (const SubMesh& sub : mesh.submeshes) {
+        const uint32_t triangles = sub.indexCount / 3;
+        for (uint32_t t = 0; t < triangles; t += SLICE_TRIANGLES) {
+            const uint32_t n = std::min(SLICE_TRIANGLES, triangles - t);
+            slices.push_back({ sub.firstIndex + 3 * t, 3 * n, sub.baseVertex });
+        }
+    }
+
+    std::vector<std::vector<MeshCluster>> perSlice(slices.size());
+    parallelTasks(slices.size(), [&](size_t i) {
+        perSlice[i].reserve(slices[i].indexCount / (3 * MIN_CLUSTER_TRIANGLES) + 1);
+        buildSliceClusters(mesh, slices[i], perSlice[i]);
+    });
+
+    size_t total = 0;
+    for (const auto& v : perSlice) total += v.size();
+    mesh.clusters.reserve(total);
+    for (auto& v : perSlice) mesh.clusters.insert(mesh.clusters.end(), v.begin(), v.end());
+
+    size_t triangles = 0;
+    for (const MeshCluster& c : mesh.clusters) {
+        triangles += c.indexCount / 3;
+        if (c.coneCutoff < 1.0f) ++stats.withCone;
+    }
+    stats.clusters     = mesh.clusters.size();
+    stats.avgTriangles = stats.clusters ? double(triangles) / stats.clusters : 0.0;
+    stats.milliseconds = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - t0).count();
+    return stats;
+}
+
+// ----------------------------------------
+// culling
+// ----------------------------------------
+
+ClusterFrustum makeClusterFrustum(const glm::mat4& mvp, const glm::mat4& modelView,
+                                  bool cullBackfacing)
+{
+    // Gribb/Hartmann: planes are sums of the matrix rows. The near plane
+    // uses w + z, which also holds (conservatively) for 0..1 depth.
+    auto row = [&](int r) { return glm::vec4(mvp[0][r], mvp[1][r], mvp[2][r], mvp[3][r]); };
+    const glm::vec4 r0 = row(0), r1 = row(1), r2 = row(2), r3 = row(3);
+
+    ClusterFrustum f;
+    const glm::vec4 planes[6] = { r3 + r0, r3 - r0, r3 + r1, r3 - r1, r3 + r2, r3 - r2 };
+    for (int i = 0; i < 6; ++i) {
+        const float len = glm::length(glm::vec3(planes[i].x, planes[i].y, planes[i].z));
+        f.planes[i] = len > 0.0f ? planes[i] / len : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    }
+
+    const glm::vec4 eye = glm::inverse(modelView) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    f.eye            = glm::vec3(eye.x, eye.y, eye.z) / eye.w;
+    f.cullBackfacing = cullBackfacing;
+    return f;
+}
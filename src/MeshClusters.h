@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "MeshLoader.h"
+
+// Cuts every submesh's index range into clusters of neighbouring triangles
+// (MeshData::clusters) so the renderer can skip the ones outside the view
+// frustum or facing away from the camera. Clusters are contiguous slices of
+// the index buffer in its current order, so run after the vertex cache
+// reorder (which keeps neighbours together) and after the index chunk split.
+
+struct ClusterStats {
+    size_t clusters     = 0;
+    double avgTriangles = 0.0;
+    size_t withCone     = 0;   // clusters that can be rejected as back-facing
+    double milliseconds = 0.0;
+};
+
+static constexpr uint32_t MAX_CLUSTER_TRIANGLES = 128;
+static constexpr uint32_t MIN_CLUSTER_TRIANGLES = 64;   // below: never cut early
+
+ClusterStats buildClusters(MeshData& mesh);
+
+// ----------------------------------------
+// per-frame culling
+// ----------------------------------------
+
+// View volume in mesh units: frustum planes taken from the full
+// model-view-projection matrix and the eye position in the same space.
+struct ClusterFrustum {
+    glm::vec4 planes[6];   // xyz unit normal pointing inside, w offset
+    glm::vec3 eye;
+    bool      cullBackfacing = false;
+};
+
+ClusterFrustum makeClusterFrustum(const glm::mat4& mvp, const glm::mat4& modelView,
+                                  bool cullBackfacing);
+
+inline bool isClusterVisible(const MeshCluster& c, const ClusterFrustum& f)
+{
+    const glm::vec3 center(c.center[0], c.center[1], c.center[2]);
+    for (const glm::vec4& p : f.planes)
+        if (glm::dot(glm::vec3(p.x, p.y, p.z), center) + p.w < -c.radius) return false;
+
+    // every face normal is within the cone, and every point within the
+    // sphere: all triangles face away when the eye is far enough behind
+    if (f.cullBackfacing && c.coneCutoff < 1.0f) {
+        const glm::vec3 axis(c.coneAxis[0], c.coneAxis[1], c.coneAxis[2]);
+        const glm::vec3 d = center - f.eye;
+        if (glm::dot(d, axis) >= c.coneCutoff * glm::length(d) + c.radius) return false;
+    }
+    return true;
+}
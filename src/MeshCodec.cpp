@@ -0,0 +1,567 @@
+#include "MeshLoader.h"
+#include "CompactVertex.h"
+#include "MappedFile.h"
+#include "MeshUtils.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// File layout (.xrmesh, little-endian):
+//
+//   CodecHeader
+//   SubMesh[submeshCount]
+//   CodecBlock[vertexBlockCount + indexBlockCount]
+//   block payloads
+//
+// A vertex block holds five streams (quantized x, y, z, octahedral nx, ny),
+// each the zigzag varints of the difference to the previous vertex; the
+// first vertex of a block is a difference to zero. Vertices are written in
+// first-use order (after the vertex cache reorder), so neighbours in the
+// array are neighbours on the surface and the differences stay small.
+//
+// An index block holds one stream. Indices are coded against `next`, the
+// first vertex not referenced yet: a new vertex costs a zero, a recently
+// used one a small back reference. `next` at the start of each block is in
+// the block table, so blocks decode independently.
+//
+// Every stream is stored either raw or packed with an order-0 rANS coder
+// (12-bit probabilities, byte-wise renormalization), whichever is smaller.
+
+namespace {
+
+constexpr char     CODEC_MAGIC[8] = { 'X', 'R', 'M', 'E', 'S', 'H', 'Z', '\0' };
+constexpr uint32_t CODEC_VERSION  = 1;
+
+constexpr size_t VERTEX_BLOCK = 1u << 16;   // vertices per block
+constexpr size_t INDEX_BLOCK  = 3u << 16;   // indices per block
+constexpr size_t VERTEX_STREAMS = 5;
+constexpr size_t MAX_VARINT_BYTES = 10;
+
+constexpr unsigned RANS_PROB_BITS  = 12;
+constexpr uint32_t RANS_PROB_SCALE = 1u << RANS_PROB_BITS;
+constexpr uint32_t RANS_LOW        = 1u << 23;
+
+enum StreamMode : uint8_t {
+    STREAM_RAW  = 0,
+    STREAM_RANS = 1
+};
+
+struct CodecHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t positionBits;
+    uint64_t vertexCount;
+    uint64_t indexCount;
+    uint32_t submeshCount;
+    uint32_t vertexBlockCount;
+    uint32_t indexBlockCount;
+    uint32_t reserved;
+    float    center[3];     // VertexQuantization of the mesh bounds
+    float    scale;
+};
+static_assert(sizeof(CodecHeader) == 64, "CodecHeader layout is part of the file format");
+
+struct CodecBlock {
+    uint64_t offset;   // from the start of the file
+    uint32_t size;
+    uint32_t first;    // first vertex / index
+    uint32_t count;
+    uint32_t base;     // index blocks: `next` at the start of the block
+};
+static_assert(sizeof(CodecBlock) == 24, "CodecBlock layout is part of the file format");
+
+// ----------------------------------------
+// varints
+// ----------------------------------------
+
+inline uint64_t zigzag(int64_t v)    { return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63); }
+inline int64_t  unzigzag(uint64_t v) { return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1); }
+
+void putVarint(std::vector<uint8_t>& out, uint64_t v)
+{
+    while (v >= 0x80) {
+        out.push_back(static_cast<uint8_t>(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(v));
+}
+
+// Bounds-checked reader over one decoded stream.
+struct ByteReader {
+    const uint8_t* p;
+    const uint8_t* end;
+
+    uint64_t varint()
+    {
+        uint64_t v = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+            if (p == end) throw std::runtime_error("Compressed mesh: truncated stream");
+            const uint8_t b = *p++;
+            v |= static_cast<uint64_t>(b & 0x7f) << shift;
+            if (!(b & 0x80)) return v;
+        }
+        throw std::runtime_error("Compressed mesh: bad varint");
+    }
+};
+
+// ----------------------------------------
+// order-0 rANS
+// ----------------------------------------
+
+// Scales symbol counts to frequencies summing to RANS_PROB_SCALE, keeping
+// every used symbol at 1 or more.
+std::array<uint32_t, 256> normalizeFrequencies(const std::array<uint64_t, 256>& counts, uint64_t total)
+{
+    std::array<uint32_t, 256> freq{};
+    int64_t sum = 0;
+    for (int s = 0; s < 256; ++s) {
+        if (!counts[s]) continue;
+        freq[s] = std::max<uint32_t>(1, static_cast<uint32_t>(counts[s] * RANS_PROB_SCALE / total));
+        sum += freq[s];
+    }
+
+    // rounding leaves the sum a little off; take it from (or give it to)
+    // the most frequent symbols, where it costs the least
+    while (sum != RANS_PROB_SCALE) {
+        int best = -1;
+        for (int s = 0; s < 256; ++s)
+            if ((sum < RANS_PROB_SCALE ? freq[s] > 0 : freq[s] > 1) &&
+                (best < 0 || freq[s] > freq[best]))
+                best = s;
+        if (sum < RANS_PROB_SCALE) { ++freq[best]; ++sum; }
+        else                       { --freq[best]; --sum; }
+    }
+    return freq;
+}
+
+// Frequency table (256 varints) followed by the rANS bytes.
+std::vector<uint8_t> ransEncode(const std::vector<uint8_t>& src)
+{
+    std::array<uint64_t, 256> counts{};
+    for (uint8_t b : src) ++counts[b];
+    const std::array<uint32_t, 256> freq = normalizeFrequencies(counts, src.size());
+
+    std::array<uint32_t, 256> start{};
+    for (int s = 1; s < 256; ++s) start[s] = start[s - 1] + freq[s - 1];
+
+    // symbols are encoded back to front so they decode front to back;
+    // a symbol emits at most two bytes
+    std::vector<uint8_t> body(src.size() * 2 + 8);
+    uint8_t* const end = body.data() + body.size();
+    uint8_t*       ptr = end;
+    uint32_t       x   = RANS_LOW;
+
+    for (size_t i = src.size(); i-- > 0;) {
+        const uint8_t  s    = src[i];
+        const uint32_t xMax = ((RANS_LOW >> RANS_PROB_BITS) << 8) * freq[s];
+        while (x >= xMax) {
+            *--ptr = static_cast<uint8_t>(x);
+            x >>= 8;
+        }
+        x = ((x / freq[s]) << RANS_PROB_BITS) + (x % freq[s]) + start[s];
+    }
+    ptr -= 4;
+    for (int k = 0; k < 4; ++k) ptr[k] = static_cast<uint8_t>(x >> (8 * k));
+
+    std::vector<uint8_t> out;
+    out.reserve(256 + static_cast<size_t>(end - ptr));
+    for (int s = 0; s < 256; ++s) putVarint(out, freq[s]);
+    out.insert(out.end(), ptr, end);
+    return out;
+}
+
+void ransDecode(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize)
+{
+    ByteReader in{ src, src + srcSize };
+
+    std::array<uint32_t, 256> freq{}, start{};
+    uint32_t sum = 0;
+    for (int s = 0; s < 256; ++s) {
+        const uint64_t f = in.varint();
+        if (f > RANS_PROB_SCALE) throw std::runtime_error("Compressed mesh: bad frequency table");
+        freq[s]  = static_cast<uint32_t>(f);
+        start[s] = sum;
+        sum     += freq[s];
+    }
+    if (sum != RANS_PROB_SCALE) throw std::runtime_error("Compressed mesh: bad frequency table");
+
+    std::array<uint8_t, RANS_PROB_SCALE> symbolOfSlot;
+    for (int s = 0; s < 256; ++s)
+        std::fill_n(symbolOfSlot.begin() + start[s], freq[s], static_cast<uint8_t>(s));
+
+    const uint8_t* p   = in.p;
+    const uint8_t* end = in.end;
+    if (end - p < 4) throw std::runtime_error("Compressed mesh: truncated stream");
+    uint32_t x = uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+    p += 4;
+
+    for (size_t i = 0; i < dstSize; ++i) {
+        const uint32_t slot = x & (RANS_PROB_SCALE - 1);
+        const uint8_t  s    = symbolOfSlot[slot];
+        dst[i] = s;
+        x = freq[s] * (x >> RANS_PROB_BITS) + slot - start[s];
+        while (x < RANS_LOW) {
+            if (p == end) throw std::runtime_error("Compressed mesh: truncated stream");
+            x = (x << 8) | *p++;
+        }
+    }
+}
+
+// ----------------------------------------
+// streams
+// ----------------------------------------
+
+// mode byte, varint decoded size, varint stored size, stored bytes
+void putStream(std::vector<uint8_t>& out, const std::vector<uint8_t>& raw)
+{
+    std::vector<uint8_t> packed;
+    if (!raw.empty()) packed = ransEncode(raw);
+
+    const bool useRans = !packed.empty() && packed.size() < raw.size();
+    const std::vector<uint8_t>& stored = useRans ? packed : raw;
+
+    out.push_back(useRans ? STREAM_RANS : STREAM_RAW);
+    putVarint(out, raw.size());
+    putVarint(out, stored.size());
+    out.insert(out.end(), stored.begin(), stored.end());
+}
+
+// Returns a reader over the decoded stream; rANS streams are unpacked into
+// scratch, raw ones are read in place. maxSize bounds the decoded size, so
+// a corrupt header cannot ask for a huge allocation.
+ByteReader getStream(ByteReader& in, std::vector<uint8_t>& scratch, size_t maxSize)
+{
+    if (in.p == in.end) throw std::runtime_error("Compressed mesh: truncated block");
+    const uint8_t  mode       = *in.p++;
+    const uint64_t rawSize    = in.varint();
+    const uint64_t storedSize = in.varint();
+    if (storedSize > static_cast<uint64_t>(in.end - in.p))
+        throw std::runtime_error("Compressed mesh: truncated block");
+    if (rawSize > maxSize) throw std::runtime_error("Compressed mesh: bad stream size");
+
+    const uint8_t* stored = in.p;
+    in.p += storedSize;
+
+    if (mode == STREAM_RAW) {
+        if (rawSize != storedSize) throw std::runtime_error("Compressed mesh: bad stream size");
+        return { stored, stored + storedSize };
+    }
+    if (mode != STREAM_RANS) throw std::runtime_error("Compressed mesh: unknown stream mode");
+
+    scratch.resize(static_cast<size_t>(rawSize));
+    ransDecode(stored, static_cast<size_t>(storedSize), scratch.data(), scratch.size());
+    return { scratch.data(), scratch.data() + scratch.size() };
+}
+
+// ----------------------------------------
+// blocks
+// ----------------------------------------
+
+struct PositionCoder {
+    glm::vec3 center;
+    float     scale;
+    uint32_t  maxValue;   // (1 << bits) - 1
+
+    uint32_t quantize(float v, int axis) const
+    {
+        const float local = (v - center[axis]) / scale;   // [-1, 1]
+        const float u     = std::min(std::max(local * 0.5f + 0.5f, 0.0f), 1.0f);
+        return static_cast<uint32_t>(std::lround(u * static_cast<float>(maxValue)));
+    }
+
+    float dequantize(uint32_t q, int axis) const
+    {
+        const float local = static_cast<float>(q) * (2.0f / static_cast<float>(maxValue)) - 1.0f;
+        return center[axis] + local * scale;
+    }
+};
+
+std::vector<uint8_t> encodeVertexBlock(const Vertex* v, size_t count, const PositionCoder& coder)
+{
+    std::array<std::vector<uint8_t>, VERTEX_STREAMS> streams;
+    for (auto& s : streams) s.reserve(count * 2);
+
+    int64_t prev[VERTEX_STREAMS] = {};
+    for (size_t i = 0; i < count; ++i) {
+        int16_t oct[2];
+        octEncode(v[i].normal, oct);
+
+        const int64_t cur[VERTEX_STREAMS] = {
+            coder.quantize(v[i].pos.x, 0), coder.quantize(v[i].pos.y, 1),
+            coder.quantize(v[i].pos.z, 2), oct[0], oct[1]
+        };
+        for (size_t k = 0; k < VERTEX_STREAMS; ++k) {
+            putVarint(streams[k], zigzag(cur[k] - prev[k]));
+            prev[k] = cur[k];
+        }
+    }
+
+    std::vector<uint8_t> out;
+    for (const auto& s : streams) putStream(out, s);
+    return out;
+}
+
+void decodeVertexBlock(ByteReader in, Vertex* v, size_t count, const PositionCoder& coder,
+                       std::array<std::vector<uint8_t>, VERTEX_STREAMS>& scratch)
+{
+    std::array<ByteReader, VERTEX_STREAMS> streams;
+    for (size_t k = 0; k < VERTEX_STREAMS; ++k) streams[k] = getStream(in, scratch[k], count * MAX_VARINT_BYTES);
+
+    int64_t prev[VERTEX_STREAMS] = {};
+    for (size_t i = 0; i < count; ++i) {
+        for (size_t k = 0; k < VERTEX_STREAMS; ++k) prev[k] += unzigzag(streams[k].varint());
+
+        for (int a = 0; a < 3; ++a) {
+            if (prev[a] < 0 || prev[a] > coder.maxValue)
+                throw std::runtime_error("Compressed mesh: position out of range");
+            v[i].pos[a] = coder.dequantize(static_cast<uint32_t>(prev[a]), a);
+        }
+        if (prev[3] < -32768 || prev[3] > 32767 || prev[4] < -32768 || prev[4] > 32767)
+            throw std::runtime_error("Compressed mesh: normal out of range");
+        v[i].normal = octDecode(static_cast<int16_t>(prev[3]), static_cast<int16_t>(prev[4]));
+    }
+}
+
+std::vector<uint8_t> encodeIndexBlock(const uint32_t* idx, size_t count, uint32_t base)
+{
+    std::vector<uint8_t> codes;
+    codes.reserve(count * 2);
+
+    int64_t next = base;
+    for (size_t i = 0; i < count; ++i) {
+        putVarint(codes, zigzag(next - static_cast<int64_t>(idx[i])));
+        next = std::max<int64_t>(next, int64_t(idx[i]) + 1);
+    }
+
+    std::vector<uint8_t> out;
+    putStream(out, codes);
+    return out;
+}
+
+void decodeIndexBlock(ByteReader in, uint32_t* idx, size_t count, uint32_t base,
+                      uint64_t vertexCount, std::vector<uint8_t>& scratch)
+{
+    ByteReader codes = getStream(in, scratch, count * MAX_VARINT_BYTES);
+
+    int64_t next = base;
+    for (size_t i = 0; i < count; ++i) {
+        const int64_t v = next - unzigzag(codes.varint());
+        if (v < 0 || static_cast<uint64_t>(v) >= vertexCount)
+            throw std::runtime_error("Compressed mesh: index out of range");
+        idx[i] = static_cast<uint32_t>(v);
+        next   = std::max(next, v + 1);
+    }
+}
+
+} // namespace
+
+// ----------------------------------------
+// writer
+// ----------------------------------------
+
+MeshCodecStats writeMeshCompressed(const MeshData& mesh, const std::string& path,
+                                   unsigned positionBits)
+{
+    auto t0 = std::chrono::steady_clock::now();
+
+    if (positionBits < 8 || positionBits > 24)
+        throw std::runtime_error("Compressed mesh: position bits must be in [8, 24]");
+    if (mesh.vertices.size() > std::numeric_limits<uint32_t>::max() ||
+        mesh.indices.size()  > std::numeric_limits<uint32_t>::max())
+        throw std::runtime_error("Compressed mesh: too many vertices or indices");
+
+    const size_t vertexCount = mesh.vertices.size();
+    const size_t indexCount  = mesh.indices.size();
+
+    VertexQuantization q{};
+    if (vertexCount) q = makeVertexQuantization(computeBounds(mesh));
+    const PositionCoder coder{ q.center, q.scale, (1u << positionBits) - 1 };
+
+    const size_t vertexBlocks = (vertexCount + VERTEX_BLOCK - 1) / VERTEX_BLOCK;
+    const size_t indexBlocks  = (indexCount + INDEX_BLOCK - 1) / INDEX_BLOCK;
+
+    std::vector<CodecBlock> table(vertexBlocks + indexBlocks);
+    for (size_t b = 0; b < vertexBlocks; ++b) {
+        table[b].first = static_cast<uint32_t>(b * VERTEX_BLOCK);
+        table[b].count = static_cast<uint32_t>(std::min(VERTEX_BLOCK, vertexCount - b * VERTEX_BLOCK));
+    }
+    // `next` only grows, so one serial pass finds it for every block start
+    uint32_t next = 0;
+    for (size_t b = 0; b < indexBlocks; ++b) {
+        CodecBlock& block = table[vertexBlocks + b];
+        block.first = static_cast<uint32_t>(b * INDEX_BLOCK);
+        block.count = static_cast<uint32_t>(std::min(INDEX_BLOCK, indexCount - b * INDEX_BLOCK));
+        block.base  = next;
+        for (size_t i = block.first; i < size_t(block.first) + block.count; ++i)
+            next = std::max(next, mesh.indices[i] + 1);
+    }
+
+    std::vector<std::vector<uint8_t>> payloads(table.size());
+    parallelTasks(table.size(), [&](size_t b) {
+        const CodecBlock& block = table[b];
+        payloads[b] = b < vertexBlocks
+            ? encodeVertexBlock(mesh.vertices.data() + block.first, block.count, coder)
+            : encodeIndexBlock(mesh.indices.data() + block.first, block.count, block.base);
+    });
+
+    CodecHeader h{};
+    std::memcpy(h.magic, CODEC_MAGIC, sizeof(CODEC_MAGIC));
+    h.version          = CODEC_VERSION;
+    h.positionBits     = positionBits;
+    h.vertexCount      = vertexCount;
+    h.indexCount       = indexCount;
+    h.submeshCount     = static_cast<uint32_t>(mesh.submeshes.size());
+    h.vertexBlockCount = static_cast<uint32_t>(vertexBlocks);
+    h.indexBlockCount  = static_cast<uint32_t>(indexBlocks);
+    for (int i = 0; i < 3; ++i) h.center[i] = q.center[i];
+    h.scale = q.scale;
+
+    uint64_t offset = sizeof(CodecHeader) + mesh.submeshes.size() * sizeof(SubMesh) +
+                      table.size() * sizeof(CodecBlock);
+    for (size_t b = 0; b < table.size(); ++b) {
+        if (payloads[b].size() > std::numeric_limits<uint32_t>::max())
+            throw std::runtime_error("Compressed mesh: block too large");
+        table[b].offset = offset;
+        table[b].size   = static_cast<uint32_t>(payloads[b].size());
+        offset += payloads[b].size();
+    }
+
+    // write next to the target and rename, so a failed write never leaves
+    // a truncated file that loads as a mesh
+    const std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream ofs(tmpPath, std::ios::out | std::ios::trunc | std::ios::binary);
+        if (!ofs) {
+            throw std::runtime_error("Failed to open compressed mesh for writing: " + tmpPath);
+        }
+        ofs.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        ofs.write(reinterpret_cast<const char*>(mesh.submeshes.data()),
+                  static_cast<std::streamsize>(mesh.submeshes.size() * sizeof(SubMesh)));
+        ofs.write(reinterpret_cast<const char*>(table.data()),
+                  static_cast<std::streamsize>(table.size() * sizeof(CodecBlock)));
+        for (const auto& p : payloads)
+            ofs.write(reinterpret_cast<const char*>(p.data()), static_cast<std::streamsize>(p.size()));
+        ofs.close();
+        if (!ofs) {
+            std::error_code ec;
+            std::filesystem::remove(tmpPath, ec);
+            throw std::runtime_error("Failed to write compressed mesh: " + path);
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, path, ec);
+    if (ec) {
+        const std::string reason = ec.message();
+        std::filesystem::remove(tmpPath, ec);
+        throw std::runtime_error("Failed to finalize compressed mesh " + path + ": " + reason);
+    }
+
+    MeshCodecStats stats;
+    stats.rawBytes        = vertexCount * sizeof(Vertex) + indexCount * sizeof(uint32_t);
+    stats.compressedBytes = static_cast<size_t>(offset);
+    stats.blocks          = table.size();
+    stats.milliseconds    = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - t0).count();
+    return stats;
+}
+
+// ----------------------------------------
+// reader
+// ----------------------------------------
+
+MeshData readMeshCompressed(const std::string& path, MeshCodecStats* stats)
+{
+    auto t0 = std::chrono::steady_clock::now();
+
+    MappedFile file(path);
+    if (!file.isOpen()) {
+        throw std::runtime_error("Failed to open compressed mesh: " + path);
+    }
+    const uint8_t* base = file.data();
+    const size_t   size = file.size();
+
+    CodecHeader h;
+    if (size < sizeof(h)) throw std::runtime_error("Compressed mesh: file too small");
+    std::memcpy(&h, base, sizeof(h));
+    if (std::memcmp(h.magic, CODEC_MAGIC, sizeof(CODEC_MAGIC)) != 0)
+        throw std::runtime_error("Not a compressed mesh: " + path);
+    if (h.version != CODEC_VERSION)
+        throw std::runtime_error("Unsupported compressed mesh version: " + std::to_string(h.version));
+    if (h.positionBits < 8 || h.positionBits > 24 || !(h.scale > 0.0f))
+        throw std::runtime_error("Compressed mesh: bad quantization");
+    if (h.vertexCount > std::numeric_limits<uint32_t>::max() ||
+        h.indexCount  > std::numeric_limits<uint32_t>::max())
+        throw std::runtime_error("Compressed mesh: bad element counts");
+
+    const size_t blockCount = size_t(h.vertexBlockCount) + h.indexBlockCount;
+    const size_t tableBytes = size_t(h.submeshCount) * sizeof(SubMesh) + blockCount * sizeof(CodecBlock);
+    if (tableBytes > size - sizeof(h)) throw std::runtime_error("Compressed mesh: truncated tables");
+
+    MeshData data;
+    data.submeshes.resize(h.submeshCount);
+    std::memcpy(data.submeshes.data(), base + sizeof(h), h.submeshCount * sizeof(SubMesh));
+    for (const SubMesh& s : data.submeshes)
+        if (uint64_t(s.firstIndex) + s.indexCount > h.indexCount ||
+            uint64_t(s.firstVertex) + s.vertexCount > h.vertexCount)
+            throw std::runtime_error("Compressed mesh: submesh out of range");
+
+    std::vector<CodecBlock> table(blockCount);
+    std::memcpy(table.data(), base + sizeof(h) + h.submeshCount * sizeof(SubMesh),
+                blockCount * sizeof(CodecBlock));
+
+    // blocks must tile both arrays exactly and stay inside the file
+    uint64_t vertexTotal = 0, indexTotal = 0;
+    for (size_t b = 0; b < blockCount; ++b) {
+        const CodecBlock& block = table[b];
+        uint64_t& total = b < h.vertexBlockCount ? vertexTotal : indexTotal;
+        if (block.first != total || block.count == 0 ||
+            block.offset > size || block.size > size - block.offset)
+            throw std::runtime_error("Compressed mesh: bad block table");
+        total += block.count;
+    }
+    if (vertexTotal != h.vertexCount || indexTotal != h.indexCount)
+        throw std::runtime_error("Compressed mesh: bad block table");
+
+    data.vertices.resize(static_cast<size_t>(h.vertexCount));
+    data.indices.resize(static_cast<size_t>(h.indexCount));
+
+    const PositionCoder coder{ glm::vec3(h.center[0], h.center[1], h.center[2]), h.scale,
+                               (1u << h.positionBits) - 1 };
+
+    parallelTasks(blockCount, [&](size_t b) {
+        const CodecBlock& block = table[b];
+        ByteReader in{ base + block.offset, base + block.offset + block.size };
+        if (b < h.vertexBlockCount) {
+            std::array<std::vector<uint8_t>, VERTEX_STREAMS> scratch;
+            decodeVertexBlock(in, data.vertices.data() + block.first, block.count, coder, scratch);
+        } else {
+            std::vector<uint8_t> scratch;
+            decodeIndexBlock(in, data.indices.data() + block.first, block.count, block.base,
+                             h.vertexCount, scratch);
+        }
+    });
+
+    data.hasNormals = true;
+
+    if (stats) {
+        stats->rawBytes        = data.vertices.size() * sizeof(Vertex) + data.indices.size() * sizeof(uint32_t);
+        stats->compressedBytes = size;
+        stats->blocks          = blockCount;
+        stats->milliseconds    = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - t0).count();
+    }
+    return data;
+}
@@ -1,4 +1,10 @@
 #include "MeshLoader.h"
+#include "NativeMeshReader.h"
+#include "MeshWeld.h"
+#include "MeshNormals.h"
+#include "MemoryUsage.h"
+#include "Parallel.h"
+#include "config.h"
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
@@ -9,6 +15,13 @@
 #include <algorithm>
 #include <cctype>
 #include <fstream>
+#include <chrono>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+
+#include <glm/glm.hpp>
 
 // ----------------------------------------
 // helpers
@@ -27,42 +40,114 @@ static std::string toLowerExt(const std::string& path)
 }
 
 // ----------------------------------------
-// main load function
+// Assimp import
 // ----------------------------------------
 
-MeshData loadMesh(
-    const std::string& path,
-    bool writePlyCopy,
-    const std::string& plyOutPath
-) {
-    std::string ext = toLowerExt(path);
-    std::cout << "Loading mesh: " << path << "\n";
-    std::cout << "Extension: " << ext << "\n";
+unsigned int meshImportFlags()
+{
+    // the weld stage does the vertex joining in parallel when enabled, and
+    // missing normals are generated after it (GenNormals would produce
+    // per-face normals and stop vertices from being shared)
+    const unsigned int join = Config::WELD_VERTICES
+        ? 0u : static_cast<unsigned int>(aiProcess_JoinIdenticalVertices);
+
+    return aiProcess_Triangulate | join;
+}
+
+static glm::mat4 toGlm(const aiMatrix4x4& m)
+{
+    // aiMatrix4x4 is row-major (a1..a4 is the first row), glm is column-major
+    glm::mat4 r;
+    r[0][0] = m.a1; r[1][0] = m.a2; r[2][0] = m.a3; r[3][0] = m.a4;
+    r[0][1] = m.b1; r[1][1] = m.b2; r[2][1] = m.b3; r[3][1] = m.b4;
+    r[0][2] = m.c1; r[1][2] = m.c2; r[2][2] = m.c3; r[3][2] = m.c4;
+    r[0][3] = m.d1; r[1][3] = m.d2; r[2][3] = m.d3; r[3][3] = m.d4;
+    return r;
+}
 
+// Appends one instance of mesh, baked into world space, as a new submesh.
+static void appendMesh(const aiMesh* mesh, const glm::mat4& world,
+                       MeshData& data, size_t& skippedFaces)
+{
+    if (data.vertices.size() + mesh->mNumVertices > std::numeric_limits<uint32_t>::max())
+        throw std::runtime_error("Scene is too large for 32-bit indices");
+
+    SubMesh sub;
+    sub.firstVertex = static_cast<uint32_t>(data.vertices.size());
+    sub.vertexCount = mesh->mNumVertices;
+    sub.firstIndex  = static_cast<uint32_t>(data.indices.size());
+
+    const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(world)));
+
+    for (unsigned int i = 0; i < mesh->mNumVertices; ++i) {
+        aiVector3D p = mesh->mVertices[i];
+        aiVector3D n = mesh->HasNormals() ? mesh->mNormals[i] : aiVector3D(0, 0, 1);
+
+        glm::vec4 wp = world * glm::vec4(p.x, p.y, p.z, 1.0f);
+        glm::vec3 wn = normalMatrix * glm::vec3(n.x, n.y, n.z);
+        float     len = glm::length(wn);
+
+        Vertex v;
+        v.pos    = glm::vec3(wp.x, wp.y, wp.z);
+        v.normal = (len > 0.0f) ? wn / len : glm::vec3(0.0f, 0.0f, 1.0f);
+        data.vertices.push_back(v);
+    }
+
+    for (unsigned int f = 0; f < mesh->mNumFaces; ++f) {
+        const aiFace& face = mesh->mFaces[f];
+        if (face.mNumIndices != 3) { ++skippedFaces; continue; }
+        data.indices.push_back(sub.firstVertex + face.mIndices[0]);
+        data.indices.push_back(sub.firstVertex + face.mIndices[1]);
+        data.indices.push_back(sub.firstVertex + face.mIndices[2]);
+    }
+
+    sub.indexCount = static_cast<uint32_t>(data.indices.size() - sub.firstIndex);
+    if (sub.indexCount > 0) {
+        data.submeshes.push_back(sub);
+        data.partNormals.push_back(mesh->HasNormals() ? 1 : 0);
+    }
+}
+
+// Walks the node hierarchy; a mesh referenced by several nodes is emitted
+// once per reference, each with its own accumulated transform.
+static void appendNodeMeshes(const aiScene* scene, const aiNode* node,
+                             const glm::mat4& parent, MeshData& data,
+                             size_t& skippedFaces)
+{
+    if (!node) return;
+    const glm::mat4 world = parent * toGlm(node->mTransformation);
+
+    for (unsigned int i = 0; i < node->mNumMeshes; ++i)
+        appendMesh(scene->mMeshes[node->mMeshes[i]], world, data, skippedFaces);
+
+    for (unsigned int c = 0; c < node->mNumChildren; ++c)
+        appendNodeMeshes(scene, node->mChildren[c], world, data, skippedFaces);
+}
+
+// Sizes of everything appendNodeMeshes() will emit, so the arrays are
+// allocated once instead of growing (and briefly doubling) while filled.
+static void countNodeMeshes(const aiScene* scene, const aiNode* node,
+                            size_t& vertices, size_t& indices)
+{
+    if (!node) return;
+    for (unsigned int i = 0; i < node->mNumMeshes; ++i) {
+        const aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
+        vertices += mesh->mNumVertices;
+        indices  += size_t(mesh->mNumFaces) * 3;
+    }
+    for (unsigned int c = 0; c < node->mNumChildren; ++c)
+        countNodeMeshes(scene, node->mChildren[c], vertices, indices);
+}
+
+static MeshData loadMeshAssimp(const std::string& path, const std::string& ext)
+{
     Assimp::Importer importer;
-    unsigned int flags = 0;
-
-    if (ext == "ply") {
-        flags = aiProcess_Triangulate |
-                aiProcess_JoinIdenticalVertices |
-                aiProcess_GenNormals;
-        std::cout << "Using PLY import flags\n";
-    } else if (ext == "stl") {
-        flags = aiProcess_Triangulate |
-                aiProcess_JoinIdenticalVertices |
-                aiProcess_GenNormals;
-        std::cout << "Using STL import flags\n";
-    } else if (ext == "obj") {
-        flags = aiProcess_Triangulate |
-                aiProcess_JoinIdenticalVertices |
-                aiProcess_GenSmoothNormals;
-        std::cout << "Using OBJ import flags\n";
-    } else {
-        flags = aiProcess_Triangulate |
-                aiProcess_JoinIdenticalVertices |
-                aiProcess_GenNormals;
+    unsigned int flags = meshImportFlags();
+
+    if (ext == "ply" || ext == "stl" || ext == "obj")
+        std::cout << "Using " << ext << " import flags\n";
+    else
         std::cout << "Unknown extension, using default flags\n";
-    }
 
     std::cout << "Calling Assimp ReadFile...\n";
     const aiScene* scene = importer.ReadFile(path, flags);
@@ -76,35 +161,98 @@ MeshData loadMesh(
         throw std::runtime_error("Scene has no meshes");
     }
 
-    const aiMesh* mesh = scene->mMeshes[0];
-
     MeshData data;
-    data.vertices.reserve(mesh->mNumVertices);
-    data.indices.reserve(mesh->mNumFaces * 3);
+    size_t   vertexTotal = 0, indexTotal = 0;
+    countNodeMeshes(scene, scene->mRootNode, vertexTotal, indexTotal);
+    data.vertices.reserve(vertexTotal);
+    data.indices.reserve(indexTotal);
 
-    std::cout << "Vertices in mesh: " << mesh->mNumVertices << "\n";
-    std::cout << "Faces in mesh:    " << mesh->mNumFaces << "\n";
+    size_t skippedFaces = 0;
+    appendNodeMeshes(scene, scene->mRootNode, glm::mat4(1.0f), data, skippedFaces);
 
-    for (unsigned int i = 0; i < mesh->mNumVertices; ++i) {
-        aiVector3D p = mesh->mVertices[i];
-        aiVector3D n = mesh->HasNormals() ? mesh->mNormals[i] : aiVector3D(0, 0, 1);
+    // normals are generated only for the parts that lack them
+    data.hasNormals = std::all_of(data.partNormals.begin(), data.partNormals.end(),
+                                  [](uint8_t n) { return n != 0; });
 
-        Vertex v;
-        v.pos    = { p.x, p.y, p.z };
-        v.normal = { n.x, n.y, n.z };
-        data.vertices.push_back(v);
+    std::cout << "Meshes in scene:  " << scene->mNumMeshes << "\n";
+    std::cout << "Mesh instances:   " << data.submeshes.size() << "\n";
+    if (skippedFaces)
+        std::cout << "Skipped " << skippedFaces << " non-triangle faces (points / lines)\n";
+
+    return data;
+}
+
+// ----------------------------------------
+// main load function
+// ----------------------------------------
+
+MeshData loadMesh(
+    const std::string& path,
+    bool writePlyCopy,
+    const std::string& plyOutPath
+) {
+    std::string ext = toLowerExt(path);
+    std::cout << "Loading mesh: " << path << "\n";
+    std::cout << "Extension: " << ext << "\n";
+
+    auto t0 = std::chrono::steady_clock::now();
+
+    // .xrmesh files are written after the weld and normal generation, so
+    // they go to the GPU as they are
+    MeshData data;
+    const bool compressed = ext == "xrmesh";
+    bool native = false;
+    if (compressed) {
+        data = readMeshCompressed(path);
+    } else {
+        native = Config::USE_NATIVE_READERS && readMeshNative(path, ext, data);
+        if (!native) {
+            data = loadMeshAssimp(path, ext);
+        }
     }
 
-    for (unsigned int f = 0; f < mesh->mNumFaces; ++f) {
-        const aiFace& face = mesh->mFaces[f];
-        if (face.mNumIndices != 3) continue;
-        data.indices.push_back(face.mIndices[0]);
-        data.indices.push_back(face.mIndices[1]);
-        data.indices.push_back(face.mIndices[2]);
+    // single-part sources (and the native readers) draw as one range
+    if (data.submeshes.empty() && !data.indices.empty()) {
+        SubMesh whole;
+        whole.indexCount  = static_cast<uint32_t>(data.indices.size());
+        whole.vertexCount = static_cast<uint32_t>(data.vertices.size());
+        data.submeshes.push_back(whole);
     }
 
+    auto t1 = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(t1 - t0).count();
+    double mb      = static_cast<double>(std::filesystem::file_size(path)) / (1024.0 * 1024.0);
+
     std::cout << "Loaded vertices: "  << data.vertices.size()    << "\n";
     std::cout << "Loaded triangles: " << data.indices.size() / 3 << "\n";
+    std::cout << "Loaded submeshes: " << data.submeshes.size()    << "\n";
+    std::cout << (compressed ? "Compressed" : native ? "Native" : "Assimp") << " load: "
+              << mb << " MB in " << seconds * 1000.0 << " ms ("
+              << (seconds > 0.0 ? mb / seconds : 0.0) << " MB/s)\n";
+    reportMemoryUsage("after import");
+
+    if (Config::WELD_VERTICES && !compressed) {
+        WeldStats w = weldMesh(data, Config::WELD_EPSILON);
+        std::cout << "Weld: vertices " << w.verticesBefore << " -> " << w.verticesAfter
+                  << ", triangles " << w.trianglesBefore << " -> " << w.trianglesAfter
+                  << " (" << w.degenerateRemoved << " degenerate, "
+                  << w.duplicateRemoved << " duplicate) in " << w.milliseconds << " ms\n";
+        reportMemoryUsage("after weld");
+    }
+
+    if (!data.hasNormals) {
+        NormalStats n = generateSmoothNormals(data, Config::NORMAL_CREASE_ANGLE,
+                                              Config::NORMAL_ANGLE_WEIGHTED
+                                                  ? NormalWeighting::Angle
+                                                  : NormalWeighting::Area);
+        data.hasNormals = true;
+        data.partNormals.clear();
+        std::cout << "Smooth normals (crease " << Config::NORMAL_CREASE_ANGLE << " deg, "
+                  << (Config::NORMAL_ANGLE_WEIGHTED ? "angle" : "area") << "-weighted): vertices "
+                  << n.verticesBefore << " -> " << n.verticesAfter
+                  << " in " << n.milliseconds << " ms\n";
+        reportMemoryUsage("after normals");
+    }
 
     if (writePlyCopy) {
         std::string out = plyOutPath;
@@ -116,7 +264,9 @@ MeshData loadMesh(
                 out = path.substr(0, dotPos) + ".out.ply";
         }
         std::cout << "Writing PLY copy to: " << out << "\n";
-        writeMeshAsPly(data, out);
+        writeMeshAsPly(data, out, Config::PLY_COPY_BINARY
+                                      ? PlyWriteFormat::BinaryLittleEndian
+                                      : PlyWriteFormat::Ascii);
     }
 
     return data;
@@ -126,20 +276,163 @@ MeshData loadMesh(
 // PLY writer
 // ----------------------------------------
 
+static bool hostIsLittleEndian()
+{
+    const uint16_t probe = 1;
+    uint8_t first = 0;
+    std::memcpy(&first, &probe, 1);
+    return first == 1;
+}
+
+template <typename T>
+static void storeLE(uint8_t* dst, T value, bool swap)
+{
+    std::memcpy(dst, &value, sizeof(T));
+    if (swap) std::reverse(dst, dst + sizeof(T));
+}
+
+// Formats `count` items in parallel into per-task text buffers and writes
+// them in order. Work is done in rounds so only a bounded amount of text is
+// held in memory at once.
+template <typename FormatFn>
+static void writeAsciiBlocks(std::ofstream& ofs, size_t count, size_t maxBytesPerItem,
+                             FormatFn formatItem)
+{
+    constexpr size_t ITEMS_PER_BLOCK = 1 << 16;
+
+    const size_t blocksPerRound = workerCount() * 2;
+    std::vector<std::vector<char>> buffers(blocksPerRound);
+    std::vector<size_t>            used(blocksPerRound);
+
+    for (size_t roundStart = 0; roundStart < count;
+         roundStart += blocksPerRound * ITEMS_PER_BLOCK) {
+        parallelTasks(blocksPerRound, [&](size_t b) {
+            size_t begin = roundStart + b * ITEMS_PER_BLOCK;
+            size_t end   = std::min(count, begin + ITEMS_PER_BLOCK);
+            used[b] = 0;
+            if (begin >= end) return;
+
+            std::vector<char>& buf = buffers[b];
+            buf.resize((end - begin) * maxBytesPerItem);
+            char* out = buf.data();
+            for (size_t i = begin; i < end; ++i)
+                out = formatItem(out, i);
+            used[b] = static_cast<size_t>(out - buf.data());
+        });
+
+        for (size_t b = 0; b < blocksPerRound; ++b)
+            ofs.write(buffers[b].data(), static_cast<std::streamsize>(used[b]));
+    }
+}
+
+static char* formatFloat(char* out, float value, char sep)
+{
+    // shortest representation that round-trips; 16 chars always suffice
+    out = std::to_chars(out, out + 16, value).ptr;
+    *out++ = sep;
+    return out;
+}
+
+static char* formatUInt(char* out, uint32_t value, char sep)
+{
+    out = std::to_chars(out, out + 10, value).ptr;
+    *out++ = sep;
+    return out;
+}
+
+static void writePlyBodyAscii(std::ofstream& ofs, const MeshData& mesh)
+{
+    writeAsciiBlocks(ofs, mesh.vertices.size(), 6 * 17,
+        [&](char* out, size_t i) {
+            const Vertex& v = mesh.vertices[i];
+            out = formatFloat(out, v.pos.x,    ' ');
+            out = formatFloat(out, v.pos.y,    ' ');
+            out = formatFloat(out, v.pos.z,    ' ');
+            out = formatFloat(out, v.normal.x, ' ');
+            out = formatFloat(out, v.normal.y, ' ');
+            out = formatFloat(out, v.normal.z, '\n');
+            return out;
+        });
+
+    writeAsciiBlocks(ofs, mesh.indices.size() / 3, 2 + 3 * 11,
+        [&](char* out, size_t t) {
+            *out++ = '3';
+            *out++ = ' ';
+            out = formatUInt(out, mesh.indices[3 * t + 0], ' ');
+            out = formatUInt(out, mesh.indices[3 * t + 1], ' ');
+            out = formatUInt(out, mesh.indices[3 * t + 2], '\n');
+            return out;
+        });
+}
+
+static void writePlyBodyBinary(std::ofstream& ofs, const MeshData& mesh)
+{
+    static_assert(sizeof(Vertex) == 6 * sizeof(float),
+                  "Vertex is expected to be tightly packed pos + normal");
+
+    constexpr size_t ITEMS_PER_BLOCK = 1 << 20;
+    const bool swap = !hostIsLittleEndian();
+
+    // vertex rows are exactly the in-memory Vertex layout on little-endian hosts
+    if (!swap) {
+        ofs.write(reinterpret_cast<const char*>(mesh.vertices.data()),
+                  static_cast<std::streamsize>(mesh.vertices.size() * sizeof(Vertex)));
+    } else {
+        std::vector<uint8_t> block;
+        for (size_t begin = 0; begin < mesh.vertices.size(); begin += ITEMS_PER_BLOCK) {
+            size_t end = std::min(mesh.vertices.size(), begin + ITEMS_PER_BLOCK);
+            block.resize((end - begin) * sizeof(Vertex));
+            const float* src = &mesh.vertices[begin].pos.x;
+            for (size_t k = 0; k < (end - begin) * 6; ++k)
+                storeLE(block.data() + 4 * k, src[k], swap);
+            ofs.write(reinterpret_cast<const char*>(block.data()),
+                      static_cast<std::streamsize>(block.size()));
+        }
+    }
+
+    // faces: "uchar 3, int i0, int i1, int i2" = 13 bytes each
+    constexpr size_t FACE_BYTES = 1 + 3 * sizeof(int32_t);
+    const size_t triangleCount = mesh.indices.size() / 3;
+    std::vector<uint8_t> block;
+
+    for (size_t begin = 0; begin < triangleCount; begin += ITEMS_PER_BLOCK) {
+        size_t end = std::min(triangleCount, begin + ITEMS_PER_BLOCK);
+        block.resize((end - begin) * FACE_BYTES);
+
+        parallelRanges(end - begin, 1 << 16, [&](size_t b, size_t e, size_t) {
+            for (size_t t = b; t < e; ++t) {
+                uint8_t* dst = block.data() + t * FACE_BYTES;
+                const uint32_t* tri = &mesh.indices[3 * (begin + t)];
+                dst[0] = 3;
+                storeLE(dst + 1, static_cast<int32_t>(tri[0]), swap);
+                storeLE(dst + 5, static_cast<int32_t>(tri[1]), swap);
+                storeLE(dst + 9, static_cast<int32_t>(tri[2]), swap);
+            }
+        });
+
+        ofs.write(reinterpret_cast<const char*>(block.data()),
+                  static_cast<std::streamsize>(block.size()));
+    }
+}
+
 void writeMeshAsPly(
     const MeshData& mesh,
-    const std::string& path
+    const std::string& path,
+    PlyWriteFormat format
 ) {
-    std::ofstream ofs(path, std::ios::out | std::ios::trunc);
+    auto t0 = std::chrono::steady_clock::now();
+
+    std::ofstream ofs(path, std::ios::out | std::ios::trunc | std::ios::binary);
     if (!ofs) {
         throw std::runtime_error("Failed to open PLY file for writing: " + path);
     }
 
     const size_t vertexCount   = mesh.vertices.size();
     const size_t triangleCount = mesh.indices.size() / 3;
+    const bool   binary        = format == PlyWriteFormat::BinaryLittleEndian;
 
     ofs << "ply\n";
-    ofs << "format ascii 1.0\n";
+    ofs << (binary ? "format binary_little_endian 1.0\n" : "format ascii 1.0\n");
     ofs << "element vertex " << vertexCount << "\n";
     ofs << "property float x\n";
     ofs << "property float y\n";
@@ -151,22 +444,20 @@ void writeMeshAsPly(
     ofs << "property list uchar int vertex_indices\n";
     ofs << "end_header\n";
 
-    for (const auto& v : mesh.vertices) {
-        ofs << v.pos.x    << " "
-            << v.pos.y    << " "
-            << v.pos.z    << " "
-            << v.normal.x << " "
-            << v.normal.y << " "
-            << v.normal.z << "\n";
-    }
+    if (binary)
+        writePlyBodyBinary(ofs, mesh);
+    else
+        writePlyBodyAscii(ofs, mesh);
 
-    for (size_t i = 0; i < triangleCount; ++i) {
-        uint32_t i0 = mesh.indices[3 * i + 0];
-        uint32_t i1 = mesh.indices[3 * i + 1];
-        uint32_t i2 = mesh.indices[3 * i + 2];
-        ofs << "3 " << i0 << " " << i1 << " " << i2 << "\n";
+    if (!ofs) {
+        throw std::runtime_error("Failed to write PLY file: " + path);
     }
+    const double mb = static_cast<double>(ofs.tellp()) / (1024.0 * 1024.0);
+    ofs.close();
 
-    std::cout << "PLY written, vertices: " << vertexCount
-              << " triangles: " << triangleCount << "\n";
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    std::cout << "PLY written (" << (binary ? "binary" : "ascii") << "), vertices: " << vertexCount
+              << " triangles: " << triangleCount << ", "
+              << mb << " MB in " << seconds * 1000.0 << " ms ("
+              << (seconds > 0.0 ? mb / seconds : 0.0) << " MB/s)\n";
 }
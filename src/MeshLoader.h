@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <vector>
 #include <string>
 #include <glm/vec3.hpp>
@@ -9,18 +10,98 @@ struct Vertex {
     glm::vec3 normal;
 };
 
+// One part of the scene: a contiguous slice of MeshData::indices. Indices
+// are global (baseVertex 0) until splitIntoIndexChunks() makes them local
+// to a chunk; baseVertex is then added to each index when drawing.
+struct SubMesh {
+    uint32_t firstIndex  = 0;
+    uint32_t indexCount  = 0;
+    uint32_t firstVertex = 0;
+    uint32_t vertexCount = 0;
+    uint32_t baseVertex  = 0;
+};
+
+// A run of ~64-128 neighbouring triangles inside one submesh, with the
+// bounds used to skip it on the CPU (see MeshClusters.h). Plain floats so
+// the array can be stored in the mesh cache as it is.
+struct MeshCluster {
+    uint32_t firstIndex  = 0;
+    uint32_t indexCount  = 0;
+    uint32_t baseVertex  = 0;        // same as the owning submesh
+    float    center[3]   = {};       // bounding sphere, mesh units
+    float    radius      = 0.0f;
+    float    coneAxis[3] = {};       // average face normal
+    float    coneCutoff  = 1.0f;     // sin of the cone half-angle; >= 1: no cone
+};
+
+// A coarser version of the whole mesh (level 1, 2, ...; level 0 is the
+// submeshes themselves). Its index ranges are MeshData::lodRanges
+// [firstRange, firstRange + submesh count): one per submesh, same
+// baseVertex, indices appended after level 0 and reusing its vertices.
+struct MeshLod {
+    uint32_t firstRange = 0;
+    uint32_t triangles  = 0;
+    float    error      = 0.0f;   // geometric deviation from level 0, mesh units
+};
+
 struct MeshData {
-    std::vector<Vertex>   vertices;
-    std::vector<uint32_t> indices;
+    std::vector<Vertex>      vertices;
+    std::vector<uint32_t>    indices;
+    std::vector<SubMesh>     submeshes;   // at least one entry after loadMesh()
+    std::vector<MeshCluster> clusters;    // empty unless buildClusters() ran
+    std::vector<MeshLod>     lods;        // empty unless buildLodChain() ran
+    std::vector<SubMesh>     lodRanges;
+
+    // False while the normals are placeholders (the file had none, or only
+    // per-face ones); loadMesh() then generates smooth normals. When only
+    // some parts of a scene lack normals, partNormals says which (one entry
+    // per submesh, 1 = normals from the file); empty = all parts alike.
+    bool                 hasNormals = true;
+    std::vector<uint8_t> partNormals;
 };
 
+// Whether submesh s carries normals from the file.
+inline bool submeshHasNormals(const MeshData& mesh, size_t s)
+{
+    return mesh.partNormals.empty() ? mesh.hasNormals : mesh.partNormals[s] != 0;
+}
+
+// Assimp post-processing flags used for every import.
+unsigned int meshImportFlags();
+
 MeshData loadMesh(
     const std::string& path,
     bool writePlyCopy = false,
     const std::string& plyOutPath = ""
 );
 
+enum class PlyWriteFormat {
+    Ascii,               // formatted in parallel with std::to_chars
+    BinaryLittleEndian   // vertex / face arrays written as large blocks
+};
+
 void writeMeshAsPly(
     const MeshData& mesh,
-    const std::string& path
+    const std::string& path,
+    PlyWriteFormat format = PlyWriteFormat::Ascii
 );
+
+// Compressed container (.xrmesh, see MeshCodec.cpp): positions quantized to
+// positionBits per axis inside the bounding cube, octahedral normals,
+// delta + zigzag varint streams squeezed with an order-0 rANS coder. Data is
+// cut into independent blocks so both directions run on all cores.
+// loadMesh() reads .xrmesh files directly (no weld / normal generation).
+struct MeshCodecStats {
+    size_t rawBytes        = 0;   // vertices + indices as 32-bit floats / ints
+    size_t compressedBytes = 0;   // whole file
+    size_t blocks          = 0;
+    double milliseconds    = 0.0;
+};
+
+MeshCodecStats writeMeshCompressed(
+    const MeshData& mesh,
+    const std::string& path,
+    unsigned positionBits = 16
+);
+
+MeshData readMeshCompressed(const std::string& path, MeshCodecStats* stats = nullptr);
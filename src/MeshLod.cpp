@@ -0,0 +1,347 @@
+#include "MeshLod.h"
+#include "Parallel.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+// a level is dropped when it keeps more than this share of the one before
+static constexpr double MIN_LEVEL_REDUCTION = 0.8;
+
+// collapse passes per level before giving up on the target
+static constexpr int MAX_PASSES = 32;
+
+// a collapse may not turn a triangle by more than ~80 degrees
+static constexpr float MIN_NORMAL_COS = 0.2f;
+
+// ----------------------------------------
+// quadrics
+// ----------------------------------------
+
+namespace {
+
+// Area-weighted sum of squared distances to a set of planes; evaluate()
+// divides by the total area, so errors are mean squared distances.
+struct Quadric {
+    double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+    double b0 = 0, b1 = 0, b2 = 0, c = 0, w = 0;
+
+    void addPlane(const glm::vec3& n, double d, double weight)
+    {
+        a00 += weight * n.x * n.x; a01 += weight * n.x * n.y; a02 += weight * n.x * n.z;
+        a11 += weight * n.y * n.y; a12 += weight * n.y * n.z; a22 += weight * n.z * n.z;
+        b0  += weight * n.x * d;   b1  += weight * n.y * d;   b2  += weight * n.z * d;
+        c   += weight * d * d;
+        w   += weight;
+    }
+
+    Quadric& operator+=(const Quadric& o)
+    {
+        a00 += o.a00; a01 += o.a01; a02 += o.a02; a11 += o.a11; a12 += o.a12; a22 += o.a22;
+        b0  += o.b0;  b1  += o.b1;  b2  += o.b2;  c   += o.c;   w   += o.w;
+        return *this;
+    }
+
+    double evaluate(const glm::vec3& p) const
+    {
+        const double x = p.x, y = p.y, z = p.z;
+        const double e = a00 * x * x + a11 * y * y + a22 * z * z
+                       + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+                       + 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+        return w > 0.0 ? std::max(e, 0.0) / w : 0.0;
+    }
+};
+
+struct Collapse {
+    uint32_t from;
+    uint32_t to;
+    double   cost;
+};
+
+// One submesh in its own vertex numbering (0 .. vertexCount).
+struct Simplifier {
+    std::vector<glm::vec3> pos;
+    std::vector<Quadric>   quadric;
+    std::vector<uint8_t>   locked;
+    std::vector<uint32_t>  indices;
+    double                 maxCost = 0.0;
+
+    // scratch, reused between passes
+    std::vector<uint32_t> adjacencyStart;
+    std::vector<uint32_t> adjacency;
+    std::vector<uint8_t>  touched;
+    std::vector<uint32_t> collapsedInto;
+    std::vector<Collapse> candidates;
+};
+
+} // namespace
+
+// ----------------------------------------
+// setup
+// ----------------------------------------
+
+static void initSimplifier(Simplifier& s)
+{
+    const size_t vertexCount = s.pos.size();
+    const size_t triCount    = s.indices.size() / 3;
+
+    s.quadric.assign(vertexCount, Quadric{});
+    for (size_t t = 0; t < triCount; ++t) {
+        const uint32_t* tri = &s.indices[3 * t];
+        const glm::vec3 n   = glm::cross(s.pos[tri[1]] - s.pos[tri[0]], s.pos[tri[2]] - s.pos[tri[0]]);
+        const float     len = glm::length(n);
+        if (len <= 0.0f) continue;
+        const glm::vec3 unit = n / len;
+        const double    d    = -glm::dot(unit, s.pos[tri[0]]);
+        Quadric q;
+        q.addPlane(unit, d, 0.5 * len);
+        for (int k = 0; k < 3; ++k) s.quadric[tri[k]] += q;
+    }
+
+    s.locked.assign(vertexCount, 0);
+
+    // open border: an edge used by a single triangle
+    std::vector<uint64_t> edges;
+    edges.reserve(3 * triCount);
+    for (size_t t = 0; t < triCount; ++t)
+        for (int k = 0; k < 3; ++k) {
+            uint32_t a = s.indices[3 * t + k], b = s.indices[3 * t + (k + 1) % 3];
+            if (a > b) std::swap(a, b);
+            edges.push_back((uint64_t(a) << 32) | b);
+        }
+    std::sort(edges.begin(), edges.end());
+    for (size_t i = 0; i < edges.size();) {
+        size_t j = i + 1;
+        while (j < edges.size() && edges[j] == edges[i]) ++j;
+        if (j - i == 1) {
+            s.locked[uint32_t(edges[i] >> 32)] = 1;
+            s.locked[uint32_t(edges[i])]       = 1;
+        }
+        i = j;
+    }
+
+    // vertices split at a crease: moving one would tear the surface
+    std::vector<uint32_t> byPos(vertexCount);
+    for (uint32_t v = 0; v < vertexCount; ++v) byPos[v] = v;
+    auto less = [&](uint32_t a, uint32_t b) {
+        const glm::vec3 &p = s.pos[a], &q = s.pos[b];
+        if (p.x != q.x) return p.x < q.x;
+        if (p.y != q.y) return p.y < q.y;
+        return p.z < q.z;
+    };
+    std::sort(byPos.begin(), byPos.end(), less);
+    for (size_t i = 1; i < vertexCount; ++i)
+        if (s.pos[byPos[i]] == s.pos[byPos[i - 1]])
+            s.locked[byPos[i]] = s.locked[byPos[i - 1]] = 1;
+}
+
+// ----------------------------------------
+// collapse passes
+// ----------------------------------------
+
+static void buildAdjacency(Simplifier& s)
+{
+    const size_t vertexCount = s.pos.size();
+    s.adjacencyStart.assign(vertexCount + 1, 0);
+    for (uint32_t v : s.indices) ++s.adjacencyStart[v + 1];
+    for (size_t v = 0; v < vertexCount; ++v) s.adjacencyStart[v + 1] += s.adjacencyStart[v];
+
+    s.adjacency.resize(s.indices.size());
+    std::vector<uint32_t> cursor(s.adjacencyStart.begin(), s.adjacencyStart.end() - 1);
+    for (size_t c = 0; c < s.indices.size(); ++c)
+        s.adjacency[cursor[s.indices[c]]++] = static_cast<uint32_t>(c / 3);
+}
+
+// False if moving from onto to would flip or badly turn a triangle
+// around from.
+static bool keepsOrientation(const Simplifier& s, uint32_t from, uint32_t to)
+{
+    const glm::vec3& target = s.pos[to];
+    for (uint32_t a = s.adjacencyStart[from]; a < s.adjacencyStart[from + 1]; ++a) {
+        const uint32_t* tri = &s.indices[3 * size_t(s.adjacency[a])];
+        if (tri[0] == to || tri[1] == to || tri[2] == to) continue;   // removed by the collapse
+
+        glm::vec3 p[3] = { s.pos[tri[0]], s.pos[tri[1]], s.pos[tri[2]] };
+        const glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+        for (int k = 0; k < 3; ++k)
+            if (tri[k] == from) p[k] = target;
+        const glm::vec3 after = glm::cross(p[1] - p[0], p[2] - p[0]);
+
+        const float lb = glm::length(before), la = glm::length(after);
+        if (la <= 0.0f) return false;
+        if (lb > 0.0f && glm::dot(before, after) < MIN_NORMAL_COS * lb * la) return false;
+    }
+    return true;
+}
+
+// One round of independent collapses, cheapest first; no two collapses
+// share a triangle, so the orientation checks stay valid. Returns the
+// number of collapses made.
+static size_t collapsePass(Simplifier& s, size_t targetTriangles)
+{
+    const size_t triCount = s.indices.size() / 3;
+    if (triCount <= targetTriangles) return 0;
+
+    buildAdjacency(s);
+
+    s.candidates.clear();
+    for (size_t t = 0; t < triCount; ++t)
+        for (int k = 0; k < 3; ++k) {
+            const uint32_t a = s.indices[3 * t + k], b = s.indices[3 * t + (k + 1) % 3];
+            if (a > b) continue;   // interior edges are seen from both sides
+            Quadric q = s.quadric[a];
+            q += s.quadric[b];
+            const double toB = s.locked[a] ? -1.0 : q.evaluate(s.pos[b]);
+            const double toA = s.locked[b] ? -1.0 : q.evaluate(s.pos[a]);
+            if (toB >= 0.0 && (toA < 0.0 || toB <= toA)) s.candidates.push_back({ a, b, toB });
+            else if (toA >= 0.0)                         s.candidates.push_back({ b, a, toA });
+        }
+    std::sort(s.candidates.begin(), s.candidates.end(),
+              [](const Collapse& x, const Collapse& y) { return x.cost < y.cost; });
+
+    // each collapse removes about two triangles
+    const size_t wanted = (triCount - targetTriangles + 1) / 2;
+    s.touched.assign(s.pos.size(), 0);
+    s.collapsedInto.resize(s.pos.size());
+    for (uint32_t v = 0; v < s.collapsedInto.size(); ++v) s.collapsedInto[v] = v;
+
+    size_t done = 0;
+    for (const Collapse& c : s.candidates) {
+        if (done >= wanted) break;
+        if (s.touched[c.from] || s.touched[c.to]) continue;
+        if (!keepsOrientation(s, c.from, c.to)) continue;
+
+        s.collapsedInto[c.from] = c.to;
+        s.quadric[c.to] += s.quadric[c.from];
+        s.maxCost = std::max(s.maxCost, c.cost);
+        ++done;
+
+        for (uint32_t a = s.adjacencyStart[c.from]; a < s.adjacencyStart[c.from + 1]; ++a) {
+            const uint32_t* tri = &s.indices[3 * size_t(s.adjacency[a])];
+            for (int k = 0; k < 3; ++k) s.touched[tri[k]] = 1;
+        }
+    }
+    if (done == 0) return 0;
+
+    // remap and drop the triangles that lost an edge
+    size_t out = 0;
+    for (size_t t = 0; t < triCount; ++t) {
+        const uint32_t a = s.collapsedInto[s.indices[3 * t]];
+        const uint32_t b = s.collapsedInto[s.indices[3 * t + 1]];
+        const uint32_t c = s.collapsedInto[s.indices[3 * t + 2]];
+        if (a == b || b == c || a == c) continue;
+        s.indices[out++] = a;
+        s.indices[out++] = b;
+        s.indices[out++] = c;
+    }
+    s.indices.resize(out);
+    return done;
+}
+
+// ----------------------------------------
+// chain
+// ----------------------------------------
+
+namespace {
+
+struct SubmeshLevels {
+    std::vector<std::vector<uint32_t>> indices;   // per level >= 1, submesh-local
+    std::vector<float>                 error;     // per level >= 1
+};
+
+} // namespace
+
+static SubmeshLevels simplifySubmesh(const MeshData& mesh, const SubMesh& sub, uint32_t offset,
+                                     size_t levels)
+{
+    Simplifier s;
+    s.pos.resize(sub.vertexCount);
+    for (uint32_t v = 0; v < sub.vertexCount; ++v) s.pos[v] = mesh.vertices[sub.firstVertex + v].pos;
+    s.indices.assign(mesh.indices.begin() + sub.firstIndex,
+                     mesh.indices.begin() + sub.firstIndex + sub.indexCount);
+    for (uint32_t& i : s.indices) i -= offset;
+    initSimplifier(s);
+
+    SubmeshLevels out;
+    for (size_t level = 1; level < levels; ++level) {
+        const size_t target = s.indices.size() / 6;   // half the triangles
+        for (int pass = 0; pass < MAX_PASSES; ++pass)
+            if (collapsePass(s, target) == 0) break;
+
+        out.indices.push_back(s.indices);
+        out.error.push_back(static_cast<float>(std::sqrt(s.maxCost)));
+    }
+    return out;
+}
+
+LodStats buildLodChain(MeshData& mesh, size_t maxLevels)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    LodStats stats;
+    mesh.lods.clear();
+    mesh.lodRanges.clear();
+    stats.levels = 1;
+    if (maxLevels < 2 || mesh.submeshes.empty()) return stats;
+
+    // each submesh must only reference its own vertex range
+    for (const SubMesh& sub : mesh.submeshes) {
+        const uint32_t offset = sub.firstVertex - sub.baseVertex;
+        for (uint32_t i = sub.firstIndex; i < sub.firstIndex + sub.indexCount; ++i)
+            if (mesh.indices[i] - offset >= sub.vertexCount) {
+                std::cerr << "Warning: submesh indices leave its vertex range, no LOD levels\n";
+                return stats;
+            }
+    }
+
+    std::vector<SubmeshLevels> perSubmesh(mesh.submeshes.size());
+    parallelTasks(mesh.submeshes.size(), [&](size_t i) {
+        const SubMesh& sub = mesh.submeshes[i];
+        perSubmesh[i] = simplifySubmesh(mesh, sub, sub.firstVertex - sub.baseVertex, maxLevels);
+    });
+
+    // keep the levels that still pay off
+    std::vector<MeshLod> kept;
+    size_t previousTriangles = mesh.indices.size() / 3;
+    size_t appendedIndices   = 0;
+    for (size_t level = 1; level < maxLevels; ++level) {
+        MeshLod lod;
+        size_t  triangles = 0;
+        for (const SubmeshLevels& l : perSubmesh) {
+            triangles += l.indices[level - 1].size() / 3;
+            lod.error  = std::max(lod.error, l.error[level - 1]);
+        }
+        if (triangles > MIN_LEVEL_REDUCTION * previousTriangles) break;
+        previousTriangles = triangles;
+        appendedIndices  += 3 * triangles;
+
+        lod.firstRange = static_cast<uint32_t>(kept.size() * mesh.submeshes.size());
+        lod.triangles  = static_cast<uint32_t>(triangles);
+        kept.push_back(lod);
+    }
+
+    mesh.indices.reserve(mesh.indices.size() + appendedIndices);
+    mesh.lodRanges.reserve(kept.size() * mesh.submeshes.size());
+    for (size_t level = 1; level <= kept.size(); ++level) {
+        for (size_t i = 0; i < mesh.submeshes.size(); ++i) {
+            const SubMesh&               sub    = mesh.submeshes[i];
+            const std::vector<uint32_t>& local  = perSubmesh[i].indices[level - 1];
+            const uint32_t               offset = sub.firstVertex - sub.baseVertex;
+
+            SubMesh range    = sub;
+            range.firstIndex = static_cast<uint32_t>(mesh.indices.size());
+            range.indexCount = static_cast<uint32_t>(local.size());
+            for (uint32_t v : local) mesh.indices.push_back(v + offset);
+            mesh.lodRanges.push_back(range);
+        }
+    }
+    mesh.lods = std::move(kept);
+
+    stats.levels       = mesh.lods.size() + 1;
+    stats.milliseconds = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - t0).count();
+    return stats;
+}
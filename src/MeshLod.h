@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "MeshLoader.h"
+
+// Builds MeshData::lods: a chain of coarser index sets, each with about half
+// the triangles of the one before, by quadric-error edge collapse
+// (Garland & Heckbert 1997).
+//
+// Collapses only move a vertex onto a neighbouring vertex, so every level
+// reuses the level-0 vertex buffer and only adds indices. Open borders
+// (including the seams between index chunks) and vertices that share their
+// position with another vertex (normal creases) stay fixed, so levels never
+// crack between submeshes and keep their silhouettes. Each submesh is
+// simplified on its own, in parallel. Run after splitIntoIndexChunks().
+
+struct LodStats {
+    size_t levels       = 0;   // including level 0
+    double milliseconds = 0.0;
+};
+
+LodStats buildLodChain(MeshData& mesh, size_t maxLevels);
@@ -0,0 +1,239 @@
+#include "MeshNormals.h"
+#include "Parallel.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+static constexpr size_t MIN_RANGE = 1u << 15;
+
+// cluster normals closer than this (cosine) are treated as one
+static constexpr float SAME_NORMAL_COS = 0.99999f;
+
+static glm::vec3 normalizeOrUp(const glm::vec3& n)
+{
+    float len = glm::length(n);
+    return (len > 0.0f) ? n / len : glm::vec3(0.0f, 0.0f, 1.0f);
+}
+
+// ----------------------------------------
+// per-vertex resolve
+// ----------------------------------------
+
+// Everything one worker needs to resolve the corners around a vertex.
+struct CornerData {
+    const std::vector<glm::vec3>& faceNormal;     // unit, zero for degenerate faces
+    const std::vector<float>&     cornerWeight;
+    const std::vector<uint32_t>&  adjacency;      // corners grouped by vertex
+    const std::vector<uint32_t>&  adjacencyStart;
+    float                         creaseCos;      // <= -1: no creases
+    float                         halfCreaseCos;
+};
+
+// Splits the corners around vertex v into groups that share one normal,
+// writes each corner's group to cornerCluster and returns the group normals
+// (unit length) in clusters. Only v's corners are written, so every vertex
+// can be resolved by a different worker.
+static void resolveVertex(const CornerData& d, size_t v, std::vector<uint32_t>& cornerCluster,
+                          std::vector<glm::vec3>& clusters)
+{
+    clusters.clear();
+    const uint32_t* begin = d.adjacency.data() + d.adjacencyStart[v];
+    const uint32_t* end   = d.adjacency.data() + d.adjacencyStart[v + 1];
+    if (begin == end) return;
+
+    glm::vec3 total(0.0f);
+    for (const uint32_t* c = begin; c != end; ++c)
+        total += d.cornerWeight[*c] * d.faceNormal[*c / 3];
+    const glm::vec3 smooth = normalizeOrUp(total);
+
+    // if every face is within half the crease angle of the average, every
+    // pair is within the crease angle: one normal, no pairwise test needed
+    bool single = d.creaseCos <= -1.0f;
+    if (!single) {
+        single = true;
+        for (const uint32_t* c = begin; c != end && single; ++c) {
+            const glm::vec3& n = d.faceNormal[*c / 3];
+            single = n == glm::vec3(0.0f) || glm::dot(n, smooth) >= d.halfCreaseCos;
+        }
+    }
+    if (single) {
+        clusters.push_back(smooth);
+        for (const uint32_t* c = begin; c != end; ++c) cornerCluster[*c] = 0;
+        return;
+    }
+
+    bool hasDegenerate = false;
+    for (const uint32_t* c = begin; c != end; ++c) {
+        const glm::vec3& own = d.faceNormal[*c / 3];
+        if (own == glm::vec3(0.0f)) { hasDegenerate = true; continue; }
+
+        glm::vec3 sum(0.0f);
+        for (const uint32_t* o = begin; o != end; ++o) {
+            const glm::vec3& other = d.faceNormal[*o / 3];
+            if (glm::dot(own, other) >= d.creaseCos)
+                sum += d.cornerWeight[*o] * other;
+        }
+        const glm::vec3 n = normalizeOrUp(sum);
+
+        uint32_t cluster = 0;
+        while (cluster < clusters.size() && glm::dot(clusters[cluster], n) < SAME_NORMAL_COS)
+            ++cluster;
+        if (cluster == clusters.size()) clusters.push_back(n);
+        cornerCluster[*c] = cluster;
+    }
+
+    // corners of zero-area faces have no direction of their own
+    if (hasDegenerate) {
+        if (clusters.empty()) clusters.push_back(glm::vec3(0.0f, 0.0f, 1.0f));
+        for (const uint32_t* c = begin; c != end; ++c)
+            if (d.faceNormal[*c / 3] == glm::vec3(0.0f)) cornerCluster[*c] = 0;
+    }
+}
+
+// ----------------------------------------
+// normals
+// ----------------------------------------
+
+NormalStats generateSmoothNormals(MeshData& mesh, float creaseAngleDegrees,
+                                  NormalWeighting weighting)
+{
+    auto t0 = std::chrono::steady_clock::now();
+
+    NormalStats stats;
+    const size_t vertexCount = mesh.vertices.size();
+    const size_t cornerCount = mesh.indices.size() - mesh.indices.size() % 3;
+    const size_t triCount    = cornerCount / 3;
+    stats.verticesBefore = vertexCount;
+    stats.verticesAfter  = vertexCount;
+    if (vertexCount == 0) return stats;
+
+    Vertex*   verts = mesh.vertices.data();
+    uint32_t* idx   = mesh.indices.data();
+
+    // vertices of parts that already have normals are left alone
+    std::vector<uint8_t> generate;
+    if (!mesh.partNormals.empty()) {
+        generate.assign(vertexCount, 0);
+        parallelTasks(mesh.submeshes.size(), [&](size_t s) {
+            if (submeshHasNormals(mesh, s)) return;
+            const SubMesh& sub = mesh.submeshes[s];
+            std::fill(generate.begin() + sub.firstVertex,
+                      generate.begin() + sub.firstVertex + sub.vertexCount, uint8_t(1));
+        });
+    }
+
+    // face normals, corner weights and how many corners touch each vertex
+    std::vector<glm::vec3>             faceNormal(triCount);
+    std::vector<float>                 cornerWeight(cornerCount);
+    std::vector<std::atomic<uint32_t>> incidence(vertexCount);
+
+    parallelRanges(triCount, MIN_RANGE, [&](size_t begin, size_t end, size_t) {
+        for (size_t t = begin; t < end; ++t) {
+            const uint32_t* tri = idx + 3 * t;
+            if (tri[0] >= vertexCount || tri[1] >= vertexCount || tri[2] >= vertexCount)
+                throw std::runtime_error("Mesh index out of range");
+
+            const glm::vec3 p[3] = { verts[tri[0]].pos, verts[tri[1]].pos, verts[tri[2]].pos };
+            const glm::vec3 n    = glm::cross(p[1] - p[0], p[2] - p[0]);
+            const float     len  = glm::length(n);
+            faceNormal[t] = (len > 0.0f) ? n / len : glm::vec3(0.0f);
+
+            for (int k = 0; k < 3; ++k) {
+                float w = len;
+                if (weighting == NormalWeighting::Angle) {
+                    glm::vec3 e1 = p[(k + 1) % 3] - p[k];
+                    glm::vec3 e2 = p[(k + 2) % 3] - p[k];
+                    w = std::atan2(glm::length(glm::cross(e1, e2)), glm::dot(e1, e2));
+                }
+                cornerWeight[3 * t + k] = (len > 0.0f) ? w : 0.0f;
+                incidence[tri[k]].fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    });
+
+    // corners grouped by vertex (CSR); slots are claimed with atomic
+    // decrements, then every list is sorted so the sums are deterministic
+    const std::vector<uint32_t> adjacencyStart = parallelExclusiveScan(incidence);
+    std::vector<uint32_t>       adjacency(cornerCount);
+
+    parallelRanges(cornerCount, MIN_RANGE, [&](size_t begin, size_t end, size_t) {
+        for (size_t c = begin; c < end; ++c) {
+            const uint32_t v    = idx[c];
+            const uint32_t slot = incidence[v].fetch_sub(1, std::memory_order_relaxed) - 1;
+            adjacency[adjacencyStart[v] + slot] = static_cast<uint32_t>(c);
+        }
+    });
+    std::vector<std::atomic<uint32_t>>().swap(incidence);
+
+    const float crease    = glm::radians(std::max(creaseAngleDegrees, 0.0f));
+    const float creaseCos = (creaseAngleDegrees >= 180.0f) ? -1.0f : std::cos(crease);
+    const CornerData data{ faceNormal, cornerWeight, adjacency, adjacencyStart,
+                           creaseCos, std::cos(0.5f * crease) };
+
+    // gather: each vertex owns its corners, so nothing is written twice.
+    // The first normal goes straight into the vertex; extra ones are counted.
+    std::vector<uint32_t> cornerCluster(cornerCount);
+    std::vector<uint32_t> vertexSlots(vertexCount);
+    const size_t          ranges = parallelRangeCount(vertexCount, MIN_RANGE);
+    std::vector<uint8_t>  rangeSplits(ranges, 0);
+
+    parallelRanges(vertexCount, MIN_RANGE, [&](size_t begin, size_t end, size_t r) {
+        std::vector<glm::vec3> clusters;
+        for (size_t v = begin; v < end; ++v) {
+            if (!generate.empty() && !generate[v]) {
+                vertexSlots[v] = 1;   // keeps the file's normal
+                continue;
+            }
+            std::sort(adjacency.begin() + adjacencyStart[v], adjacency.begin() + adjacencyStart[v + 1]);
+            resolveVertex(data, v, cornerCluster, clusters);
+            if (!clusters.empty()) verts[v].normal = clusters[0];
+            vertexSlots[v] = static_cast<uint32_t>(std::max<size_t>(clusters.size(), 1));
+            if (clusters.size() > 1) rangeSplits[r] = 1;
+        }
+    });
+
+    const bool split = std::find(rangeSplits.begin(), rangeSplits.end(), 1) != rangeSplits.end();
+    if (split) {
+        // every crease vertex becomes one vertex per normal, placed right
+        // after the original so the vertex order (and submesh ranges) hold
+        const std::vector<uint32_t> newStart = parallelExclusiveScan(vertexSlots);
+        std::vector<Vertex>         vertices(newStart[vertexCount]);
+
+        parallelRanges(vertexCount, MIN_RANGE, [&](size_t begin, size_t end, size_t) {
+            std::vector<glm::vec3> clusters;
+            for (size_t v = begin; v < end; ++v) {
+                Vertex* out = vertices.data() + newStart[v];
+                out[0] = verts[v];
+                if (vertexSlots[v] == 1) {
+                    for (uint32_t a = adjacencyStart[v]; a < adjacencyStart[v + 1]; ++a)
+                        idx[adjacency[a]] = newStart[v];
+                    continue;
+                }
+
+                resolveVertex(data, v, cornerCluster, clusters);
+                for (size_t k = 1; k < clusters.size(); ++k)
+                    out[k] = Vertex{ verts[v].pos, clusters[k] };
+                for (uint32_t a = adjacencyStart[v]; a < adjacencyStart[v + 1]; ++a)
+                    idx[adjacency[a]] = newStart[v] + cornerCluster[adjacency[a]];
+            }
+        });
+
+        for (SubMesh& s : mesh.submeshes) {
+            const uint32_t first = newStart[s.firstVertex];
+            s.vertexCount = newStart[size_t(s.firstVertex) + s.vertexCount] - first;
+            s.firstVertex = first;
+        }
+        mesh.vertices = std::move(vertices);
+    }
+
+    stats.verticesAfter = mesh.vertices.size();
+    stats.milliseconds  = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - t0).count();
+    return stats;
+}
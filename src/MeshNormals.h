@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+
+#include "MeshLoader.h"
+
+// Parallel smooth normals for meshes that carry none (STL facets, OBJ,
+// PLY without nx/ny/nz); replaces Assimp's GenNormals / GenSmoothNormals.
+// With MeshData::partNormals set, only the parts without normals of their
+// own are touched.
+//
+// Every corner takes the weighted sum of the face normals around its vertex
+// whose faces lie within the crease angle of its own face. Corners of one
+// vertex that end up with different normals are split into separate
+// vertices (so hard edges stay hard); with a crease angle of 180 degrees
+// nothing is split. Run after weldMesh(), which provides the sharing.
+
+enum class NormalWeighting {
+    Angle,   // corner angle: independent of how the surface is triangulated
+    Area     // face area: cheaper, favours large faces
+};
+
+struct NormalStats {
+    size_t verticesBefore = 0;
+    size_t verticesAfter  = 0;   // larger when creases split vertices
+    double milliseconds   = 0.0;
+};
+
+NormalStats generateSmoothNormals(MeshData& mesh, float creaseAngleDegrees,
+                                  NormalWeighting weighting);
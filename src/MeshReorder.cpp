@@ -0,0 +1,237 @@
+#include "MeshReorder.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+namespace {
+
+// One independently reordered piece: a triangle range whose indices all
+// fall inside a vertex range.
+struct Group {
+    uint32_t firstIndex  = 0;
+    uint32_t indexCount  = 0;
+    uint32_t firstVertex = 0;
+    uint32_t vertexCount = 0;
+};
+
+} // namespace
+
+// ----------------------------------------
+// cache simulation
+// ----------------------------------------
+
+// Misses of a FIFO post-transform cache; indices are local to the group.
+static size_t countCacheMisses(const uint32_t* indices, size_t count, uint32_t vertexCount)
+{
+    std::vector<uint32_t> insertedAt(vertexCount, NONE);
+    uint32_t clock  = 0;
+    size_t   misses = 0;
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t& t = insertedAt[indices[i]];
+        if (t == NONE || clock - t >= VERTEX_CACHE_SIZE) {
+            t = clock++;
+            ++misses;
+        }
+    }
+    return misses;
+}
+
+// ----------------------------------------
+// Tipsify
+// ----------------------------------------
+
+// Returns the new triangle order (triangle numbers local to the group).
+// Fans around one vertex at a time and moves on to the cached neighbour
+// that will still be in the cache after its remaining triangles are
+// emitted; dead ends fall back to recently used vertices, then to the
+// next vertex in input order.
+static std::vector<uint32_t> tipsify(const uint32_t* indices, uint32_t triCount, uint32_t vertexCount)
+{
+    const int64_t cacheSize = VERTEX_CACHE_SIZE;
+
+    // vertex -> triangles
+    std::vector<uint32_t> live(vertexCount, 0);
+    for (size_t i = 0; i < size_t(triCount) * 3; ++i) ++live[indices[i]];
+
+    std::vector<uint32_t> adjacencyStart(size_t(vertexCount) + 1, 0);
+    for (uint32_t v = 0; v < vertexCount; ++v) adjacencyStart[v + 1] = adjacencyStart[v] + live[v];
+    std::vector<uint32_t> adjacency(adjacencyStart.back());
+    {
+        std::vector<uint32_t> cursor(adjacencyStart.begin(), adjacencyStart.end() - 1);
+        for (uint32_t t = 0; t < triCount; ++t)
+            for (int k = 0; k < 3; ++k) adjacency[cursor[indices[3 * t + k]]++] = t;
+    }
+
+    std::vector<int64_t>  cacheTime(vertexCount, 0);
+    std::vector<uint8_t>  emitted(triCount, 0);
+    std::vector<uint32_t> deadEnd;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> order;
+    order.reserve(triCount);
+
+    int64_t  stamp  = cacheSize + 1;
+    uint32_t cursor = 0;   // next vertex in input order for dead ends
+    int64_t  fan    = vertexCount ? 0 : -1;
+
+    while (fan >= 0) {
+        const uint32_t f = static_cast<uint32_t>(fan);
+        candidates.clear();
+
+        for (uint32_t a = adjacencyStart[f]; a < adjacencyStart[f + 1]; ++a) {
+            const uint32_t t = adjacency[a];
+            if (emitted[t]) continue;
+            emitted[t] = 1;
+            order.push_back(t);
+            for (int k = 0; k < 3; ++k) {
+                const uint32_t v = indices[3 * t + k];
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                --live[v];
+                if (stamp - cacheTime[v] > cacheSize) cacheTime[v] = stamp++;
+            }
+        }
+
+        // best candidate: still has triangles and stays cached while they go
+        fan = -1;
+        int64_t best = -1;
+        for (uint32_t v : candidates) {
+            if (live[v] == 0) continue;
+            int64_t priority = 0;
+            if (stamp - cacheTime[v] + 2 * int64_t(live[v]) <= cacheSize)
+                priority = stamp - cacheTime[v];
+            if (priority > best) {
+                best = priority;
+                fan  = v;
+            }
+        }
+
+        if (fan < 0) {
+            while (!deadEnd.empty()) {
+                const uint32_t d = deadEnd.back();
+                deadEnd.pop_back();
+                if (live[d] > 0) { fan = d; break; }
+            }
+        }
+        while (fan < 0 && cursor < vertexCount) {
+            if (live[cursor] > 0) fan = cursor;
+            ++cursor;
+        }
+    }
+    return order;
+}
+
+// ----------------------------------------
+// per group
+// ----------------------------------------
+
+struct GroupResult {
+    size_t missesBefore = 0;
+    size_t missesAfter  = 0;
+    size_t verticesUsed = 0;
+};
+
+static GroupResult reorderGroup(MeshData& mesh, const Group& g)
+{
+    GroupResult r;
+    const uint32_t triCount = g.indexCount / 3;
+    if (triCount == 0 || g.vertexCount == 0) return r;
+
+    // local copy of the group's indices, relative to firstVertex
+    std::vector<uint32_t> local(mesh.indices.begin() + g.firstIndex,
+                                mesh.indices.begin() + g.firstIndex + size_t(triCount) * 3);
+    for (uint32_t& i : local) i -= g.firstVertex;
+
+    r.missesBefore = countCacheMisses(local.data(), local.size(), g.vertexCount);
+
+    // 1. triangle order
+    const std::vector<uint32_t> order = tipsify(local.data(), triCount, g.vertexCount);
+    std::vector<uint32_t> sorted(local.size());
+    for (uint32_t n = 0; n < triCount; ++n)
+        std::memcpy(&sorted[3 * size_t(n)], &local[3 * size_t(order[n])], 3 * sizeof(uint32_t));
+
+    // 2. vertex order: first use, unreferenced vertices at the end
+    std::vector<uint32_t> remap(g.vertexCount, NONE);
+    uint32_t next = 0;
+    for (uint32_t& i : sorted) {
+        if (remap[i] == NONE) remap[i] = next++;
+        i = remap[i];
+    }
+    r.verticesUsed = next;
+    for (uint32_t& m : remap)
+        if (m == NONE) m = next++;
+
+    r.missesAfter = countCacheMisses(sorted.data(), sorted.size(), g.vertexCount);
+
+    // write back
+    Vertex* verts = mesh.vertices.data() + g.firstVertex;
+    std::vector<Vertex> original(verts, verts + g.vertexCount);
+    for (uint32_t v = 0; v < g.vertexCount; ++v) verts[remap[v]] = original[v];
+
+    uint32_t* dst = mesh.indices.data() + g.firstIndex;
+    for (size_t i = 0; i < sorted.size(); ++i) dst[i] = sorted[i] + g.firstVertex;
+    return r;
+}
+
+// ----------------------------------------
+// entry point
+// ----------------------------------------
+
+ReorderStats optimizeVertexCache(MeshData& mesh)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    ReorderStats stats;
+    if (mesh.indices.empty()) return stats;
+
+    // one group per submesh when every submesh only uses its own vertex
+    // range; otherwise the whole mesh is one group
+    std::vector<Group> groups;
+    bool separable = !mesh.submeshes.empty();
+    for (const SubMesh& s : mesh.submeshes) {
+        if (s.baseVertex != 0)
+            throw std::runtime_error("optimizeVertexCache() must run before splitIntoIndexChunks()");
+        for (uint32_t i = s.firstIndex; i < s.firstIndex + s.indexCount && separable; ++i) {
+            const uint32_t v = mesh.indices[i];
+            separable = v >= s.firstVertex && v - s.firstVertex < s.vertexCount;
+        }
+        groups.push_back({ s.firstIndex, s.indexCount, s.firstVertex, s.vertexCount });
+    }
+    if (!separable) {
+        for (uint32_t v : mesh.indices)
+            if (v >= mesh.vertices.size()) throw std::runtime_error("Mesh index out of range");
+        groups.assign(1, { 0, static_cast<uint32_t>(mesh.indices.size()),
+                           0, static_cast<uint32_t>(mesh.vertices.size()) });
+    }
+
+    // largest groups first so one big part does not start last
+    std::vector<size_t> byCost(groups.size());
+    for (size_t i = 0; i < byCost.size(); ++i) byCost[i] = i;
+    std::sort(byCost.begin(), byCost.end(),
+              [&](size_t a, size_t b) { return groups[a].indexCount > groups[b].indexCount; });
+
+    std::vector<GroupResult> results(groups.size());
+    parallelTasks(groups.size(), [&](size_t k) {
+        results[byCost[k]] = reorderGroup(mesh, groups[byCost[k]]);
+    });
+
+    size_t before = 0, after = 0, vertices = 0;
+    for (const GroupResult& r : results) {
+        before   += r.missesBefore;
+        after    += r.missesAfter;
+        vertices += r.verticesUsed;
+    }
+    const double triangles = static_cast<double>(mesh.indices.size() / 3);
+    stats.acmrBefore   = triangles > 0 ? before / triangles : 0.0;
+    stats.acmrAfter    = triangles > 0 ? after  / triangles : 0.0;
+    stats.atvrBefore   = vertices  > 0 ? double(before) / vertices : 0.0;
+    stats.atvrAfter    = vertices  > 0 ? double(after)  / vertices : 0.0;
+    stats.milliseconds = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - t0).count();
+    return stats;
+}
@@ -0,0 +1,386 @@
+#include "MeshStream.h"
+#include "Parallel.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+static constexpr size_t BATCH_VERTICES   = 1u << 18;
+static constexpr size_t BATCH_TRIANGLES  = 1u << 16;
+static constexpr size_t MAX_QUEUED_BYTES = 256u << 20;   // reader backpressure
+
+static constexpr size_t STL_HEADER_SIZE = 80 + 4;
+static constexpr size_t STL_RECORD_SIZE = 50;
+static constexpr size_t PLY_TRIANGLE_SIZE = 1 + 3 * 4;    // uchar count + 3 x int
+
+static size_t batchBytes(const MeshBatch& b)
+{
+    return b.vertices.size() * sizeof(VulkanVertex) + b.indices.size() * sizeof(uint32_t);
+}
+
+MeshStream::~MeshStream()
+{
+    stop();
+}
+
+// ----------------------------------------
+// open
+// ----------------------------------------
+
+bool MeshStream::open(const std::string& path)
+{
+    std::string ext = std::filesystem::path(path).extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (ext != ".ply" && ext != ".stl") return false;
+
+    m_file = MappedFile(path);
+    const uint8_t* data = m_file.data();
+    const size_t   size = m_file.size();
+
+    if (ext == ".stl") {
+        if (size < STL_HEADER_SIZE) return false;
+        m_swap = !hostIsLittleEndian();
+        const size_t triangles = loadScalar<uint32_t>(data + 80, m_swap);
+        if (triangles == 0 || STL_HEADER_SIZE + triangles * STL_RECORD_SIZE != size)
+            return false;   // ASCII STL
+
+        m_kind        = Kind::Stl;
+        m_vertexCount = triangles * 3;
+        m_indexCount  = triangles * 3;
+    } else {
+        PlyHeader header = parsePlyHeader(data, size);
+        if (header.format == PlyFormat::Ascii) return false;
+        m_swap = (header.format == PlyFormat::BinaryBigEndian) == hostIsLittleEndian();
+
+        // exactly "vertex" then "face", so both sections start at known offsets
+        if (header.elements.size() != 2 ||
+            header.elements[0].name != "vertex" || header.elements[1].name != "face")
+            return false;
+        const PlyElement& ve = header.elements[0];
+        const PlyElement& fe = header.elements[1];
+
+        m_vertexStride = 0;
+        std::vector<Field> fields(ve.properties.size());
+        for (size_t i = 0; i < ve.properties.size(); ++i) {
+            if (ve.properties[i].isList) return false;
+            fields[i].offset = m_vertexStride;
+            fields[i].type   = ve.properties[i].type;
+            m_vertexStride += plyTypeSize(ve.properties[i].type);
+        }
+
+        // normals have to come with the file: generating them needs every face
+        const char* names[6] = { "x", "y", "z", "nx", "ny", "nz" };
+        bool rawRows = !m_swap && m_vertexStride == sizeof(VulkanVertex);
+        for (int k = 0; k < 6; ++k) {
+            int idx = findScalarProperty(ve, names[k]);
+            if (idx < 0) return false;
+            m_fields[k] = fields[idx];
+            rawRows = rawRows && idx == k && fields[idx].type == PlyType::Float32;
+        }
+        m_rawRows = rawRows;
+
+        if (fe.properties.size() != 1 || findIndexListProperty(fe) != 0) return false;
+        const PlyProperty& list = fe.properties[0];
+        if (plyTypeSize(list.countType) != 1 || plyTypeSize(list.type) != 4 ||
+            list.type == PlyType::Float32)
+            return false;
+
+        // the buffers are sized from the header, so every face must be a
+        // triangle; with a single "list uchar int" property that is exactly
+        // the case when the face section is 13 bytes per face
+        const size_t body = size - header.dataOffset;
+        if (ve.count == 0 || fe.count == 0 ||
+            body / m_vertexStride < ve.count ||
+            body - ve.count * m_vertexStride != fe.count * PLY_TRIANGLE_SIZE)
+            return false;
+
+        m_kind        = Kind::Ply;
+        m_vertexData  = data + header.dataOffset;
+        m_faceData    = m_vertexData + ve.count * m_vertexStride;
+        m_vertexCount = ve.count;
+        m_indexCount  = fe.count * 3;
+    }
+
+    if (m_vertexCount > std::numeric_limits<uint32_t>::max() ||
+        m_indexCount  > std::numeric_limits<uint32_t>::max())
+        throw std::runtime_error("Mesh is too large for 32-bit indices");
+
+    m_previewBounds = sampleBounds(1u << 16);
+    return true;
+}
+
+size_t MeshStream::maxBatchBytes() const
+{
+    if (m_kind == Kind::Stl)
+        return BATCH_TRIANGLES * 3 * (sizeof(VulkanVertex) + sizeof(uint32_t));
+    return std::max(BATCH_VERTICES * sizeof(VulkanVertex),
+                    BATCH_TRIANGLES * 3 * sizeof(uint32_t));
+}
+
+// ----------------------------------------
+// thread / queue
+// ----------------------------------------
+
+void MeshStream::start()
+{
+    if (m_kind == Kind::None) throw std::runtime_error("MeshStream::start() before open()");
+    m_thread = std::thread(&MeshStream::run, this);
+}
+
+void MeshStream::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    if (m_thread.joinable()) m_thread.join();
+}
+
+void MeshStream::run()
+{
+    try {
+        if (m_kind == Kind::Ply) streamPly();
+        else                     streamStl();
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_error = std::current_exception();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_done = true;
+    }
+    m_cv.notify_all();
+}
+
+bool MeshStream::push(MeshBatch&& batch)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock, [&] { return m_stop || m_queuedBytes < MAX_QUEUED_BYTES; });
+    if (m_stop) return false;
+
+    m_queuedBytes += batchBytes(batch);
+    m_queue.push_back(std::move(batch));
+    return true;
+}
+
+bool MeshStream::pop(MeshBatch& out)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_error) std::rethrow_exception(m_error);
+        if (m_queue.empty()) return false;
+
+        out = std::move(m_queue.front());
+        m_queue.pop_front();
+        m_queuedBytes -= batchBytes(out);
+    }
+    m_cv.notify_all();
+    return true;
+}
+
+bool MeshStream::finished()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_error) std::rethrow_exception(m_error);
+    return m_done && m_queue.empty();
+}
+
+// ----------------------------------------
+// readers
+// ----------------------------------------
+
+void MeshStream::streamPly()
+{
+    const float inf = std::numeric_limits<float>::max();
+    glm::vec3 bmin(inf), bmax(-inf);
+
+    for (size_t first = 0; first < m_vertexCount; first += BATCH_VERTICES) {
+        const size_t n = std::min(BATCH_VERTICES, m_vertexCount - first);
+
+        MeshBatch batch;
+        batch.firstVertex = first;
+        batch.firstIndex  = 0;
+        batch.vertices.resize(n);
+
+        const uint8_t* rows = m_vertexData + first * m_vertexStride;
+        if (m_rawRows) {
+            std::memcpy(batch.vertices.data(), rows, n * sizeof(VulkanVertex));
+        } else {
+            for (size_t i = 0; i < n; ++i) {
+                const uint8_t* row = rows + i * m_vertexStride;
+                VulkanVertex&  v   = batch.vertices[i];
+                for (int k = 0; k < 3; ++k) {
+                    v.pos[k]    = static_cast<float>(loadPlyScalar(row + m_fields[k].offset,     m_fields[k].type,     m_swap));
+                    v.normal[k] = static_cast<float>(loadPlyScalar(row + m_fields[k + 3].offset, m_fields[k + 3].type, m_swap));
+                }
+            }
+        }
+
+        for (const auto& v : batch.vertices) {
+            glm::vec3 p(v.pos[0], v.pos[1], v.pos[2]);
+            bmin = glm::min(bmin, p);
+            bmax = glm::max(bmax, p);
+        }
+
+        if (!push(std::move(batch))) return;
+    }
+
+    const size_t triangles = m_indexCount / 3;
+    for (size_t first = 0; first < triangles; first += BATCH_TRIANGLES) {
+        const size_t n = std::min(BATCH_TRIANGLES, triangles - first);
+
+        MeshBatch batch;
+        batch.firstVertex = m_vertexCount;
+        batch.firstIndex  = first * 3;
+        batch.indices.resize(n * 3);
+
+        const uint8_t* rec = m_faceData + first * PLY_TRIANGLE_SIZE;
+        for (size_t t = 0; t < n; ++t, rec += PLY_TRIANGLE_SIZE) {
+            if (rec[0] != 3)
+                throw std::runtime_error("Streamed PLY contains a non-triangle face");
+            for (int k = 0; k < 3; ++k) {
+                uint32_t idx = loadScalar<uint32_t>(rec + 1 + 4 * k, m_swap);
+                if (idx >= m_vertexCount)
+                    throw std::runtime_error("PLY face index out of range");
+                batch.indices[t * 3 + k] = idx;
+            }
+        }
+
+        if (!push(std::move(batch))) return;
+    }
+
+    m_bounds = exactBounds(bmin, bmax);
+}
+
+void MeshStream::streamStl()
+{
+    const float inf = std::numeric_limits<float>::max();
+    glm::vec3 bmin(inf), bmax(-inf);
+
+    const size_t triangles = m_indexCount / 3;
+    for (size_t first = 0; first < triangles; first += BATCH_TRIANGLES) {
+        const size_t n = std::min(BATCH_TRIANGLES, triangles - first);
+
+        MeshBatch batch;
+        batch.firstVertex = first * 3;
+        batch.firstIndex  = first * 3;
+        batch.vertices.resize(n * 3);
+        batch.indices.resize(n * 3);
+
+        const uint8_t* rec = m_file.data() + STL_HEADER_SIZE + first * STL_RECORD_SIZE;
+        for (size_t t = 0; t < n; ++t, rec += STL_RECORD_SIZE) {
+            float f[12];
+            for (int k = 0; k < 12; ++k)
+                f[k] = loadScalar<float>(rec + 4 * k, m_swap);
+
+            glm::vec3 p[3] = { glm::vec3(f[3], f[4],  f[5]),
+                               glm::vec3(f[6], f[7],  f[8]),
+                               glm::vec3(f[9], f[10], f[11]) };
+
+            // flat facet normals (from the face when the file's is zero):
+            // smooth normals need the weld, which needs the whole mesh
+            glm::vec3 nrm(f[0], f[1], f[2]);
+            float len = glm::length(nrm);
+            if (!(len > 0.0f)) {
+                nrm = glm::cross(p[1] - p[0], p[2] - p[0]);
+                len = glm::length(nrm);
+            }
+            nrm = (len > 0.0f) ? nrm / len : glm::vec3(0.0f, 0.0f, 1.0f);
+
+            for (int k = 0; k < 3; ++k) {
+                VulkanVertex& v = batch.vertices[t * 3 + k];
+                v.pos[0] = p[k].x;   v.pos[1] = p[k].y;   v.pos[2] = p[k].z;
+                v.normal[0] = nrm.x; v.normal[1] = nrm.y; v.normal[2] = nrm.z;
+                batch.indices[t * 3 + k] = static_cast<uint32_t>(batch.firstVertex + t * 3 + k);
+
+                bmin = glm::min(bmin, p[k]);
+                bmax = glm::max(bmax, p[k]);
+            }
+        }
+
+        if (!push(std::move(batch))) return;
+    }
+
+    m_bounds = exactBounds(bmin, bmax);
+}
+
+// ----------------------------------------
+// bounds
+// ----------------------------------------
+
+glm::vec3 MeshStream::positionAt(size_t i) const
+{
+    if (m_kind == Kind::Stl) {
+        const uint8_t* p = m_file.data() + STL_HEADER_SIZE + (i / 3) * STL_RECORD_SIZE + 12 + (i % 3) * 12;
+        return glm::vec3(loadScalar<float>(p, m_swap),
+                         loadScalar<float>(p + 4, m_swap),
+                         loadScalar<float>(p + 8, m_swap));
+    }
+
+    const uint8_t* row = m_vertexData + i * m_vertexStride;
+    return glm::vec3(static_cast<float>(loadPlyScalar(row + m_fields[0].offset, m_fields[0].type, m_swap)),
+                     static_cast<float>(loadPlyScalar(row + m_fields[1].offset, m_fields[1].type, m_swap)),
+                     static_cast<float>(loadPlyScalar(row + m_fields[2].offset, m_fields[2].type, m_swap)));
+}
+
+// Evenly strided sample, so the first frames are framed roughly right
+// without touching the whole file.
+MeshBounds MeshStream::sampleBounds(size_t maxSamples) const
+{
+    const size_t samples = std::min(maxSamples, m_vertexCount);
+    const size_t step    = m_vertexCount / samples;
+
+    const float inf = std::numeric_limits<float>::max();
+    MeshBounds b{};
+    b.min = glm::vec3(inf);
+    b.max = glm::vec3(-inf);
+    for (size_t s = 0; s < samples; ++s) {
+        glm::vec3 p = positionAt(s * step);
+        b.min = glm::min(b.min, p);
+        b.max = glm::max(b.max, p);
+    }
+    b.center = 0.5f * (b.min + b.max);
+
+    float maxR2 = 0.0f;
+    for (size_t s = 0; s < samples; ++s) {
+        glm::vec3 d = positionAt(s * step) - b.center;
+        maxR2 = std::max(maxR2, glm::dot(d, d));
+    }
+    b.radius = std::sqrt(maxR2);
+    return b;
+}
+
+// Radius around the box center, matching computeBounds(); the mapping is
+// still hot from the batches so this second pass is cheap.
+MeshBounds MeshStream::exactBounds(const glm::vec3& min, const glm::vec3& max) const
+{
+    MeshBounds b{};
+    b.min    = min;
+    b.max    = max;
+    b.center = 0.5f * (min + max);
+
+    std::vector<float> rangeMax(parallelRangeCount(m_vertexCount, 1u << 16), 0.0f);
+    parallelRanges(m_vertexCount, 1u << 16, [&](size_t begin, size_t end, size_t r) {
+        float m = 0.0f;
+        for (size_t i = begin; i < end; ++i) {
+            glm::vec3 d = positionAt(i) - b.center;
+            m = std::max(m, glm::dot(d, d));
+        }
+        rangeMax[r] = m;
+    });
+
+    float maxR2 = 0.0f;
+    for (float m : rangeMax) maxR2 = std::max(maxR2, m);
+    b.radius = std::sqrt(maxR2);
+    return b;
+}
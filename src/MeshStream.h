@@ -0,0 +1,110 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "MappedFile.h"
+#include "MeshUtils.h"
+#include "PlyHeader.h"
+#include "VulkanVertex.h"
+
+// Progressive loading: a background thread decodes the mesh in batches so
+// the renderer can show it while the rest of the file is still being read.
+//
+// Only layouts whose final vertex / index counts are known from the header
+// can be streamed, because the GPU buffers are sized up front: binary PLY
+// with per-vertex normals and triangle faces, and binary STL. Positions are
+// streamed in file units; the renderer normalizes through its model matrix.
+
+// One slice of the final arrays. Batches arrive in order and each one lands
+// at a fixed offset, so indices are always contiguous from zero.
+struct MeshBatch {
+    size_t                    firstVertex = 0;
+    std::vector<VulkanVertex> vertices;
+    size_t                    firstIndex = 0;
+    std::vector<uint32_t>     indices;
+};
+
+class MeshStream {
+public:
+    MeshStream() = default;
+    ~MeshStream();
+
+    MeshStream(const MeshStream&)            = delete;
+    MeshStream& operator=(const MeshStream&) = delete;
+
+    // Maps the file and checks that it can be streamed; false if not
+    // (caller falls back to loadMesh). Throws on malformed files.
+    bool open(const std::string& path);
+
+    void start();   // launches the reader thread
+    void stop();    // cancels and joins it
+
+    size_t vertexCount() const { return m_vertexCount; }
+    size_t indexCount()  const { return m_indexCount; }
+
+    // Largest batch, in bytes of vertex + index data.
+    size_t maxBatchBytes() const;
+
+    // Estimated from a sample of the vertices; valid right after open().
+    const MeshBounds& previewBounds() const { return m_previewBounds; }
+    // Exact; valid once finished() returns true.
+    const MeshBounds& bounds() const { return m_bounds; }
+
+    // Moves the next decoded batch into out. False when none is ready yet.
+    // Rethrows anything the reader thread threw.
+    bool pop(MeshBatch& out);
+
+    // True once the reader is done and every batch has been popped.
+    bool finished();
+
+private:
+    enum class Kind { None, Ply, Stl };
+
+    struct Field {
+        size_t  offset = 0;
+        PlyType type   = PlyType::Float32;
+    };
+
+    void run();
+    void streamPly();
+    void streamStl();
+    bool push(MeshBatch&& batch);
+
+    glm::vec3  positionAt(size_t i) const;
+    MeshBounds sampleBounds(size_t maxSamples) const;
+    MeshBounds exactBounds(const glm::vec3& min, const glm::vec3& max) const;
+
+    MappedFile m_file;
+    Kind       m_kind = Kind::None;
+    bool       m_swap = false;
+
+    // binary PLY layout
+    const uint8_t* m_vertexData   = nullptr;
+    const uint8_t* m_faceData     = nullptr;
+    size_t         m_vertexStride = 0;
+    Field          m_fields[6];          // x y z nx ny nz
+    bool           m_rawRows      = false;   // rows already match VulkanVertex
+
+    size_t     m_vertexCount = 0;
+    size_t     m_indexCount  = 0;
+    MeshBounds m_previewBounds{};
+    MeshBounds m_bounds{};
+
+    // producer / consumer queue
+    std::thread             m_thread;
+    std::mutex              m_mutex;
+    std::condition_variable m_cv;
+    std::deque<MeshBatch>   m_queue;
+    size_t                  m_queuedBytes = 0;
+    bool                    m_done        = false;
+    bool                    m_stop        = false;
+    std::exception_ptr      m_error;
+};
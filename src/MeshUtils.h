@@ -1,11 +1,15 @@
 #pragma once
 
 #include "MeshLoader.h"
+#include "Parallel.h"
 
 #include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 #include <limits>
 #include <algorithm>
 #include <cmath>
+#include <vector>
 
 struct MeshBounds {
     glm::vec3 min;
@@ -14,51 +18,86 @@ struct MeshBounds {
     float     radius;
 };
 
-inline MeshBounds computeBounds(const MeshData &mesh) {
-    MeshBounds b{};
-    b.min = glm::vec3(
-        std::numeric_limits<float>::max(),
-        std::numeric_limits<float>::max(),
-        std::numeric_limits<float>::max()
-    );
-    b.max = glm::vec3(
-        std::numeric_limits<float>::lowest(),
-        std::numeric_limits<float>::lowest(),
-        std::numeric_limits<float>::lowest()
-    );
+// Box + sphere around the box center. The box is one parallel reduction;
+// the radius needs that center, so it is a second parallel pass. Inner
+// loops work on plain floats with independent accumulators so they
+// vectorize.
+inline MeshBounds computeBounds(const Vertex *verts, size_t count) {
+    constexpr size_t MIN_RANGE = 1u << 16;
+    const size_t ranges = parallelRangeCount(count, MIN_RANGE);
 
-    for (const auto &v : mesh.vertices) {
-        b.min.x = std::min(b.min.x, v.pos.x);
-        b.min.y = std::min(b.min.y, v.pos.y);
-        b.min.z = std::min(b.min.z, v.pos.z);
+    const float inf = std::numeric_limits<float>::max();
+    MeshBounds b{};
+    b.min = glm::vec3(inf);
+    b.max = glm::vec3(-inf);
 
-        b.max.x = std::max(b.max.x, v.pos.x);
-        b.max.y = std::max(b.max.y, v.pos.y);
-        b.max.z = std::max(b.max.z, v.pos.z);
+    std::vector<MeshBounds> partial(ranges, b);
+    parallelRanges(count, MIN_RANGE, [&](size_t begin, size_t end, size_t r) {
+        float lo[3] = { inf, inf, inf };
+        float hi[3] = { -inf, -inf, -inf };
+        for (size_t i = begin; i < end; ++i) {
+            const float* p = &verts[i].pos.x;
+            for (int k = 0; k < 3; ++k) {
+                lo[k] = std::min(lo[k], p[k]);
+                hi[k] = std::max(hi[k], p[k]);
+            }
+        }
+        partial[r].min = glm::vec3(lo[0], lo[1], lo[2]);
+        partial[r].max = glm::vec3(hi[0], hi[1], hi[2]);
+    });
+    for (const MeshBounds &p : partial) {
+        b.min = glm::min(b.min, p.min);
+        b.max = glm::max(b.max, p.max);
     }
 
     b.center = 0.5f * (b.min + b.max);
 
+    std::vector<float> rangeR2(ranges, 0.0f);
+    parallelRanges(count, MIN_RANGE, [&](size_t begin, size_t end, size_t r) {
+        const float c[3] = { b.center.x, b.center.y, b.center.z };
+        float maxR2 = 0.0f;
+        for (size_t i = begin; i < end; ++i) {
+            const float* p = &verts[i].pos.x;
+            const float dx = p[0] - c[0], dy = p[1] - c[1], dz = p[2] - c[2];
+            maxR2 = std::max(maxR2, dx * dx + dy * dy + dz * dz);
+        }
+        rangeR2[r] = maxR2;
+    });
+
     float maxR2 = 0.0f;
-    for (const auto &v : mesh.vertices) {
-        glm::vec3 d = v.pos - b.center;
-        float r2 = d.x * d.x + d.y * d.y + d.z * d.z;
-        if (r2 > maxR2) maxR2 = r2;
-    }
+    for (float r2 : rangeR2) maxR2 = std::max(maxR2, r2);
     b.radius = maxR2 > 0.0f ? std::sqrt(maxR2) : 0.0f;
     return b;
 }
 
-inline void normalizeToUnitSphere(MeshData &mesh, MeshBounds &boundsOut) {
-    boundsOut = computeBounds(mesh);
-    glm::vec3 c = boundsOut.center;
-    float r = boundsOut.radius;
+inline MeshBounds computeBounds(const MeshData &mesh) {
+    return computeBounds(mesh.vertices.data(), mesh.vertices.size());
+}
+
+// Maps the bounding sphere onto the unit sphere. Used as the model matrix
+// when the vertex data is left in file units.
+inline glm::mat4 normalizationMatrix(const MeshBounds &b) {
+    float scale = (b.radius > 0.0f) ? (1.0f / b.radius) : 1.0f;
+    return glm::scale(glm::mat4(1.0f), glm::vec3(scale)) *
+           glm::translate(glm::mat4(1.0f), -b.center);
+}
 
-    float scale = (r > 0.0f) ? (1.0f / r) : 1.0f;
+// Rewrites the positions into the unit sphere (one parallel pass on top of
+// computeBounds()); boundsOut receives the bounds after the transform.
+inline void normalizeToUnitSphere(MeshData &mesh, MeshBounds &boundsOut) {
+    const MeshBounds b = computeBounds(mesh);
+    const glm::vec3  c = b.center;
+    const float      scale = (b.radius > 0.0f) ? (1.0f / b.radius) : 1.0f;
 
-    for (auto &v : mesh.vertices) {
-        v.pos = (v.pos - c) * scale;
-    }
+    Vertex* verts = mesh.vertices.data();
+    parallelRanges(mesh.vertices.size(), 1u << 16, [&](size_t begin, size_t end, size_t) {
+        for (size_t i = begin; i < end; ++i)
+            verts[i].pos = (verts[i].pos - c) * scale;
+    });
 
-    boundsOut = computeBounds(mesh);
+    // the transform is affine, so the new box and sphere follow directly
+    boundsOut.min    = (b.min - c) * scale;
+    boundsOut.max    = (b.max - c) * scale;
+    boundsOut.center = glm::vec3(0.0f);
+    boundsOut.radius = b.radius * scale;
 }
@@ -0,0 +1,403 @@
+#include "MeshWeld.h"
+#include "CompactVertex.h"
+#include "Hash.h"
+#include "Parallel.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+static constexpr uint32_t EMPTY_SLOT     = std::numeric_limits<uint32_t>::max();
+static constexpr unsigned PARTITION_BITS = 8;
+static constexpr size_t   PARTITIONS     = size_t(1) << PARTITION_BITS;
+static constexpr size_t   MIN_RANGE      = 1u << 16;
+
+// ----------------------------------------
+// keys
+// ----------------------------------------
+
+struct VertexKey {
+    uint32_t x, y, z;   // quantized position
+    uint32_t normal;    // octahedral normal from the file; 0 for placeholders
+    uint32_t part;      // submesh; parts never weld into each other
+    bool operator==(const VertexKey& o) const {
+        return x == o.x && y == o.y && z == o.z && normal == o.normal && part == o.part;
+    }
+};
+
+struct TriangleKey {
+    uint32_t a, b, c;   // rotated so a is the lowest index
+    bool operator==(const TriangleKey& o) const { return a == o.a && b == o.b && c == o.c; }
+};
+
+static uint64_t hashKey(const VertexKey& k)
+{
+    uint64_t h = combineHash(k.part, k.x);
+    h = combineHash(h, k.y);
+    h = combineHash(h, k.z);
+    return combineHash(h, k.normal);
+}
+
+static uint64_t hashKey(const TriangleKey& k)
+{
+    return combineHash(combineHash(k.a, k.b), k.c);
+}
+
+struct NoPayload {};
+
+// ----------------------------------------
+// parallel grouping
+// ----------------------------------------
+
+// Groups the items in [0, count) by key and returns, for every item, the
+// lowest index with the same key. Payloads of later items are folded into
+// the group's first one with merge(); emit(first, payload) runs once per
+// group. No locks are needed:
+//
+//  1. every worker dedups its own range in small cache-resident blocks,
+//     which already removes the neighbouring repeats typical of STL soup;
+//  2. the block-local survivors are bucketed by the top hash bits with a
+//     counting sort that keeps index order, and each bucket is resolved by
+//     one worker with a private open-addressing table;
+//  3. every item is pointed at its block representative's final group.
+template <typename Key, typename Payload, typename MakeFn, typename MergeFn, typename EmitFn>
+static std::vector<uint32_t> groupByKey(size_t count, MakeFn make, MergeFn merge, EmitFn emit)
+{
+    struct Record {
+        Key      key;
+        Payload  payload;
+        uint32_t item;
+        uint64_t hash;
+    };
+
+    constexpr size_t BLOCK_ITEMS = 1u << 14;
+    constexpr size_t BLOCK_SLOTS = BLOCK_ITEMS * 2;
+
+    std::vector<uint32_t> first(count);
+    if (count == 0) return first;
+
+    // 1. block-local dedup; first[] temporarily holds the block representative
+    const size_t ranges = parallelRangeCount(count, MIN_RANGE);
+    std::vector<std::vector<Record>> local(ranges);
+    std::vector<uint32_t>            offsets(ranges * PARTITIONS, 0);
+
+    parallelRanges(count, MIN_RANGE, [&](size_t begin, size_t end, size_t r) {
+        std::vector<Record>&  out       = local[r];
+        uint32_t*             histogram = &offsets[r * PARTITIONS];
+        std::vector<uint32_t> table(BLOCK_SLOTS);   // index into out
+
+        for (size_t blockBegin = begin; blockBegin < end; blockBegin += BLOCK_ITEMS) {
+            const size_t blockEnd = std::min(end, blockBegin + BLOCK_ITEMS);
+            std::fill(table.begin(), table.end(), EMPTY_SLOT);
+
+            for (size_t i = blockBegin; i < blockEnd; ++i) {
+                Record rec;
+                make(i, rec.key, rec.payload);
+                rec.item = static_cast<uint32_t>(i);
+                rec.hash = hashKey(rec.key);
+
+                size_t slot = static_cast<size_t>(rec.hash) & (BLOCK_SLOTS - 1);
+                for (;;) {
+                    const uint32_t t = table[slot];
+                    if (t == EMPTY_SLOT) {
+                        table[slot] = static_cast<uint32_t>(out.size());
+                        first[i]    = rec.item;
+                        ++histogram[rec.hash >> (64 - PARTITION_BITS)];
+                        out.push_back(rec);
+                        break;
+                    }
+                    Record& head = out[t];
+                    if (head.hash == rec.hash && head.key == rec.key) {
+                        first[i] = head.item;
+                        merge(head.payload, rec.payload);
+                        break;
+                    }
+                    slot = (slot + 1) & (BLOCK_SLOTS - 1);
+                }
+            }
+        }
+    });
+
+    // 2. bucket the survivors: partition-major, then range order, so every
+    //    partition stays sorted by item
+    std::vector<uint32_t> partitionStart(PARTITIONS + 1, 0);
+    uint32_t total = 0;
+    for (size_t p = 0; p < PARTITIONS; ++p) {
+        partitionStart[p] = total;
+        for (size_t r = 0; r < ranges; ++r) {
+            uint32_t n = offsets[r * PARTITIONS + p];
+            offsets[r * PARTITIONS + p] = total;
+            total += n;
+        }
+    }
+    partitionStart[PARTITIONS] = total;
+
+    std::vector<Record> records(total);
+    parallelTasks(ranges, [&](size_t r) {
+        uint32_t* cursor = &offsets[r * PARTITIONS];
+        for (const Record& rec : local[r])
+            records[cursor[rec.hash >> (64 - PARTITION_BITS)]++] = rec;
+        std::vector<Record>().swap(local[r]);
+    });
+
+    parallelTasks(PARTITIONS, [&](size_t p) {
+        const uint32_t begin = partitionStart[p];
+        const uint32_t end   = partitionStart[p + 1];
+        if (begin == end) return;
+
+        size_t tableSize = 16;
+        while (tableSize < 2 * size_t(end - begin)) tableSize <<= 1;
+        const size_t mask = tableSize - 1;
+        std::vector<uint32_t> table(tableSize, EMPTY_SLOT);   // record index
+
+        for (uint32_t k = begin; k < end; ++k) {
+            Record& rec  = records[k];
+            size_t  slot = static_cast<size_t>(rec.hash) & mask;
+            for (;;) {
+                const uint32_t t = table[slot];
+                if (t == EMPTY_SLOT) {
+                    table[slot] = k;
+                    break;
+                }
+                Record& head = records[t];
+                if (head.hash == rec.hash && head.key == rec.key) {
+                    first[rec.item] = head.item;
+                    merge(head.payload, rec.payload);
+                    break;
+                }
+                slot = (slot + 1) & mask;
+            }
+        }
+
+        for (uint32_t t : table)
+            if (t != EMPTY_SLOT) emit(records[t].item, records[t].payload);
+    });
+
+    // 3. block representatives now hold their final group
+    parallelRanges(count, MIN_RANGE, [&](size_t begin, size_t end, size_t) {
+        for (size_t i = begin; i < end; ++i)
+            if (first[i] != i) first[i] = first[first[i]];
+    });
+
+    return first;
+}
+
+// ----------------------------------------
+// weld
+// ----------------------------------------
+
+WeldStats weldMesh(MeshData& mesh, float relativeEpsilon)
+{
+    auto t0 = std::chrono::steady_clock::now();
+
+    WeldStats stats;
+    const size_t vertexCount = mesh.vertices.size();
+    const size_t triCount    = mesh.indices.size() / 3;
+    stats.verticesBefore  = vertexCount;
+    stats.trianglesBefore = triCount;
+    stats.verticesAfter   = vertexCount;
+    stats.trianglesAfter  = triCount;
+    if (vertexCount == 0 || triCount == 0) return stats;
+    if (vertexCount >= EMPTY_SLOT || triCount >= EMPTY_SLOT)
+        throw std::runtime_error("Mesh is too large to weld with 32-bit indices");
+
+    Vertex*   verts = mesh.vertices.data();
+    uint32_t* idx   = mesh.indices.data();
+
+    // submesh of every vertex, so separate parts never weld into each other
+    std::vector<uint32_t> vertexPart;
+    if (mesh.submeshes.size() > 1) {
+        vertexPart.assign(vertexCount, 0);
+        parallelTasks(mesh.submeshes.size(), [&](size_t s) {
+            const SubMesh& sub = mesh.submeshes[s];
+            std::fill(vertexPart.begin() + sub.firstVertex,
+                      vertexPart.begin() + sub.firstVertex + sub.vertexCount,
+                      static_cast<uint32_t>(s));
+        });
+    }
+    auto partOf = [&](size_t i) -> uint32_t { return vertexPart.empty() ? 0u : vertexPart[i]; };
+
+    // normals from the file are part of the key, so hard edges stay split
+    std::vector<uint8_t> normalsFromFile(std::max<size_t>(mesh.submeshes.size(), 1));
+    for (size_t s = 0; s < normalsFromFile.size(); ++s)
+        normalsFromFile[s] = mesh.submeshes.empty() ? mesh.hasNormals : submeshHasNormals(mesh, s);
+    auto fileNormal = [&](size_t i) { return normalsFromFile[partOf(i)] != 0; };
+
+    // grid cell size relative to the bounding box diagonal
+    float cell = 0.0f;
+    if (relativeEpsilon > 0.0f) {
+        const size_t ranges = parallelRangeCount(vertexCount, MIN_RANGE);
+        std::vector<glm::vec3> rangeMin(ranges, verts[0].pos), rangeMax(ranges, verts[0].pos);
+        parallelRanges(vertexCount, MIN_RANGE, [&](size_t begin, size_t end, size_t r) {
+            for (size_t i = begin; i < end; ++i) {
+                rangeMin[r] = glm::min(rangeMin[r], verts[i].pos);
+                rangeMax[r] = glm::max(rangeMax[r], verts[i].pos);
+            }
+        });
+        glm::vec3 bmin = rangeMin[0], bmax = rangeMax[0];
+        for (size_t r = 1; r < ranges; ++r) {
+            bmin = glm::min(bmin, rangeMin[r]);
+            bmax = glm::max(bmax, rangeMax[r]);
+        }
+
+        // keep quantized coordinates inside 32 bits
+        glm::vec3 extent  = glm::max(glm::abs(bmin), glm::abs(bmax));
+        float     maxAbs  = std::max(extent.x, std::max(extent.y, extent.z));
+        cell = std::max(relativeEpsilon * glm::length(bmax - bmin), maxAbs / float(1 << 30));
+    }
+    const double invCell = (cell > 0.0f) ? 1.0 / cell : 0.0;
+
+    auto quantize = [invCell](float v) -> uint32_t {
+        if (invCell > 0.0 && std::isfinite(v))
+            return static_cast<uint32_t>(static_cast<int32_t>(std::floor(v * invCell)));
+        if (v == 0.0f) v = 0.0f;   // -0 welds with +0
+        uint32_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        return bits;
+    };
+
+    auto packNormal = [](const glm::vec3& n) -> uint32_t {
+        const float len = glm::length(n);
+        int16_t oct[2];
+        octEncode((len > 0.0f) ? n / len : glm::vec3(0.0f, 0.0f, 1.0f), oct);
+        return uint32_t(uint16_t(oct[0])) | uint32_t(uint16_t(oct[1])) << 16;
+    };
+
+    // merged vertices keep the first position; placeholder normals are
+    // summed, file normals keep the first one
+    const std::vector<uint32_t> rep = groupByKey<VertexKey, glm::vec3>(
+        vertexCount,
+        [&](size_t i, VertexKey& key, glm::vec3& normal) {
+            const glm::vec3& p = verts[i].pos;
+            const uint32_t   n = fileNormal(i) ? packNormal(verts[i].normal) : 0u;
+            key    = { quantize(p.x), quantize(p.y), quantize(p.z), n, partOf(i) };
+            normal = verts[i].normal;
+        },
+        [](glm::vec3& sum, const glm::vec3& n) { sum += n; },
+        [&](uint32_t first, const glm::vec3& sum) {
+            if (!fileNormal(first)) verts[first].normal = sum;
+        });
+
+    // remap triangles to representatives and rotate each one so its lowest
+    // index comes first (winding unchanged), which makes duplicates compare equal
+    const size_t triRanges = parallelRangeCount(triCount, MIN_RANGE);
+    std::vector<size_t>  degenerate(triRanges, 0);
+    std::vector<uint8_t> keepTri(triCount, 0);
+
+    parallelRanges(triCount, MIN_RANGE, [&](size_t begin, size_t end, size_t r) {
+        for (size_t t = begin; t < end; ++t) {
+            uint32_t* tri = idx + 3 * t;
+            if (tri[0] >= vertexCount || tri[1] >= vertexCount || tri[2] >= vertexCount)
+                throw std::runtime_error("Mesh index out of range");
+
+            uint32_t a = rep[tri[0]], b = rep[tri[1]], c = rep[tri[2]];
+            if (b < a && b < c)      { uint32_t x = a; a = b; b = c; c = x; }
+            else if (c < a && c < b) { uint32_t x = c; c = b; b = a; a = x; }
+            tri[0] = a; tri[1] = b; tri[2] = c;
+
+            bool collapsed = a == b || b == c || a == c;
+            if (!collapsed) {
+                glm::vec3 n = glm::cross(verts[b].pos - verts[a].pos, verts[c].pos - verts[a].pos);
+                collapsed = glm::dot(n, n) == 0.0f;
+            }
+            if (collapsed) ++degenerate[r];
+            keepTri[t] = collapsed ? 0 : 1;
+        }
+    });
+
+    const std::vector<uint32_t> firstTri = groupByKey<TriangleKey, NoPayload>(
+        triCount,
+        [&](size_t t, TriangleKey& key, NoPayload&) { key = { idx[3 * t], idx[3 * t + 1], idx[3 * t + 2] }; },
+        [](NoPayload&, const NoPayload&) {},
+        [](uint32_t, const NoPayload&) {});
+
+    // drop repeats and mark the vertices that survive
+    std::unique_ptr<std::atomic<uint8_t>[]> referenced(new std::atomic<uint8_t>[vertexCount]);
+    parallelRanges(vertexCount, MIN_RANGE, [&](size_t begin, size_t end, size_t) {
+        for (size_t i = begin; i < end; ++i) referenced[i].store(0, std::memory_order_relaxed);
+    });
+
+    std::vector<size_t> duplicate(triRanges, 0);
+    parallelRanges(triCount, MIN_RANGE, [&](size_t begin, size_t end, size_t r) {
+        for (size_t t = begin; t < end; ++t) {
+            if (!keepTri[t]) continue;
+            if (firstTri[t] != t) {
+                keepTri[t] = 0;
+                ++duplicate[r];
+                continue;
+            }
+            for (int k = 0; k < 3; ++k)
+                referenced[idx[3 * t + k]].store(1, std::memory_order_relaxed);
+        }
+    });
+
+    std::vector<uint8_t> keepVertex(vertexCount);
+    parallelRanges(vertexCount, MIN_RANGE, [&](size_t begin, size_t end, size_t) {
+        for (size_t i = begin; i < end; ++i)
+            keepVertex[i] = referenced[i].load(std::memory_order_relaxed);
+    });
+    referenced.reset();
+
+    // compact, keeping the original order of both arrays
+    const std::vector<uint32_t> vertexPos = parallelExclusiveScan(keepVertex);
+    const std::vector<uint32_t> triPos    = parallelExclusiveScan(keepTri);
+
+    std::vector<Vertex> vertices(vertexPos[vertexCount]);
+    parallelRanges(vertexCount, MIN_RANGE, [&](size_t begin, size_t end, size_t) {
+        for (size_t i = begin; i < end; ++i) {
+            if (!keepVertex[i]) continue;
+            Vertex v   = verts[i];
+            float  len = glm::length(v.normal);
+            v.normal   = (len > 0.0f) ? v.normal / len : glm::vec3(0.0f, 0.0f, 1.0f);
+            vertices[vertexPos[i]] = v;
+        }
+    });
+
+    std::vector<uint32_t> indices(static_cast<size_t>(triPos[triCount]) * 3);
+    parallelRanges(triCount, MIN_RANGE, [&](size_t begin, size_t end, size_t) {
+        for (size_t t = begin; t < end; ++t) {
+            if (!keepTri[t]) continue;
+            uint32_t* out = indices.data() + size_t(triPos[t]) * 3;
+            for (int k = 0; k < 3; ++k) out[k] = vertexPos[idx[3 * t + k]];
+        }
+    });
+
+    std::vector<SubMesh> submeshes;
+    std::vector<uint8_t> partNormals;
+    submeshes.reserve(mesh.submeshes.size());
+    for (size_t i = 0; i < mesh.submeshes.size(); ++i) {
+        const SubMesh& s = mesh.submeshes[i];
+        const size_t firstTriangle = s.firstIndex / 3;
+        const size_t endTriangle   = (size_t(s.firstIndex) + s.indexCount) / 3;
+
+        SubMesh n;
+        n.firstIndex  = triPos[firstTriangle] * 3;
+        n.indexCount  = (triPos[endTriangle] - triPos[firstTriangle]) * 3;
+        n.firstVertex = vertexPos[s.firstVertex];
+        n.vertexCount = vertexPos[size_t(s.firstVertex) + s.vertexCount] - n.firstVertex;
+        if (n.indexCount == 0) continue;
+        submeshes.push_back(n);
+        if (!mesh.partNormals.empty()) partNormals.push_back(mesh.partNormals[i]);
+    }
+
+    mesh.vertices    = std::move(vertices);
+    mesh.indices     = std::move(indices);
+    mesh.submeshes   = std::move(submeshes);
+    mesh.partNormals = std::move(partNormals);
+
+    for (size_t d : degenerate) stats.degenerateRemoved += d;
+    for (size_t d : duplicate)  stats.duplicateRemoved  += d;
+    stats.verticesAfter  = mesh.vertices.size();
+    stats.trianglesAfter = mesh.indices.size() / 3;
+    stats.milliseconds   = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - t0).count();
+    return stats;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+
+#include "MeshLoader.h"
+
+// Parallel replacement for aiProcess_JoinIdenticalVertices plus cleanup.
+//
+// Positions are quantized to a grid of cell size epsilon * bounding-box
+// diagonal (epsilon = 0 means bit-identical positions) and vertices that
+// fall into the same cell within the same submesh are merged. Normals from
+// the file are part of the match (quantized octahedral), so hard edges are
+// kept; placeholder normals are averaged. Triangles that collapse, have zero area or repeat an
+// earlier triangle are dropped, then vertices no triangle references are
+// removed. Vertex and triangle order is preserved and submesh ranges are
+// updated.
+
+struct WeldStats {
+    size_t verticesBefore    = 0;
+    size_t verticesAfter     = 0;
+    size_t trianglesBefore   = 0;
+    size_t trianglesAfter    = 0;
+    size_t degenerateRemoved = 0;
+    size_t duplicateRemoved  = 0;
+    double milliseconds      = 0.0;
+};
+
+WeldStats weldMesh(MeshData& mesh, float relativeEpsilon);
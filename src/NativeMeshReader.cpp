@@ -0,0 +1,676 @@
+#include "NativeMeshReader.h"
+#include "MappedFile.h"
+#include "PlyHeader.h"
+#include "Parallel.h"
+
+#include <glm/glm.hpp>
+
+#include <stdexcept>
+#include <iostream>
+#include <sstream>
+#include <cstring>
+#include <charconv>
+#include <algorithm>
+#include <atomic>
+#include <utility>
+#include <vector>
+
+static_assert(sizeof(Vertex) == 6 * sizeof(float),
+              "Vertex is expected to be tightly packed pos + normal");
+
+// ----------------------------------------
+// errors
+// ----------------------------------------
+
+static std::runtime_error truncated(const char* what)
+{
+    return std::runtime_error(std::string("Unexpected end of file in ") + what);
+}
+
+// ----------------------------------------
+// binary PLY
+// ----------------------------------------
+
+static const uint8_t* skipBinaryElement(const PlyElement& e, const uint8_t* p,
+                                        const uint8_t* end, bool swap)
+{
+    bool   fixed  = true;
+    size_t stride = 0;
+    for (const auto& prop : e.properties) {
+        if (prop.isList) { fixed = false; break; }
+        stride += plyTypeSize(prop.type);
+    }
+
+    if (fixed) {
+        if (static_cast<size_t>(end - p) / (stride ? stride : 1) < e.count)
+            throw truncated("PLY element");
+        return p + stride * e.count;
+    }
+
+    for (size_t i = 0; i < e.count; ++i) {
+        for (const auto& prop : e.properties) {
+            if (!prop.isList) {
+                p += plyTypeSize(prop.type);
+            } else {
+                if (p + plyTypeSize(prop.countType) > end) throw truncated("PLY element");
+                size_t n = static_cast<size_t>(loadPlyScalar(p, prop.countType, swap));
+                p += plyTypeSize(prop.countType) + n * plyTypeSize(prop.type);
+            }
+            if (p > end) throw truncated("PLY element");
+        }
+    }
+    return p;
+}
+
+static const uint8_t* readBinaryPlyVertices(const PlyElement& e, const uint8_t* p,
+                                            const uint8_t* end, bool swap,
+                                            MeshData& out, bool& hasNormals)
+{
+    struct Field {
+        size_t  offset = 0;
+        PlyType type   = PlyType::Float32;
+    };
+
+    std::vector<Field> fields(e.properties.size());
+    size_t stride = 0;
+    for (size_t i = 0; i < e.properties.size(); ++i) {
+        if (e.properties[i].isList)
+            throw std::runtime_error("PLY vertex element with list properties is not supported");
+        fields[i].offset = stride;
+        fields[i].type   = e.properties[i].type;
+        stride += plyTypeSize(e.properties[i].type);
+    }
+
+    const int ix  = findScalarProperty(e, "x");
+    const int iy  = findScalarProperty(e, "y");
+    const int iz  = findScalarProperty(e, "z");
+    const int inx = findScalarProperty(e, "nx");
+    const int iny = findScalarProperty(e, "ny");
+    const int inz = findScalarProperty(e, "nz");
+    if (ix < 0 || iy < 0 || iz < 0)
+        throw std::runtime_error("PLY vertex element has no x/y/z properties");
+    hasNormals = (inx >= 0 && iny >= 0 && inz >= 0);
+
+    if (stride == 0 || static_cast<size_t>(end - p) / stride < e.count)
+        throw truncated("PLY vertex data");
+
+    out.vertices.resize(e.count);
+    Vertex* dst = out.vertices.data();
+
+    bool allFloat = true;
+    for (const auto& prop : e.properties)
+        allFloat = allFloat && prop.type == PlyType::Float32;
+
+    // fast path: rows are exactly "x y z nx ny nz" floats in host byte order,
+    // which is the in-memory layout of Vertex
+    if (!swap && allFloat && stride == sizeof(Vertex) && hasNormals &&
+        ix == 0 && iy == 1 && iz == 2 && inx == 3 && iny == 4 && inz == 5) {
+        std::memcpy(dst, p, stride * e.count);
+        return p + stride * e.count;
+    }
+
+    const bool  directFloats = !swap && allFloat;
+    const Field fx = fields[ix], fy = fields[iy], fz = fields[iz];
+
+    for (size_t i = 0; i < e.count; ++i) {
+        const uint8_t* row = p + i * stride;
+        Vertex& v = dst[i];
+
+        if (directFloats) {
+            std::memcpy(&v.pos.x, row + fx.offset, sizeof(float));
+            std::memcpy(&v.pos.y, row + fy.offset, sizeof(float));
+            std::memcpy(&v.pos.z, row + fz.offset, sizeof(float));
+        } else {
+            v.pos.x = static_cast<float>(loadPlyScalar(row + fx.offset, fx.type, swap));
+            v.pos.y = static_cast<float>(loadPlyScalar(row + fy.offset, fy.type, swap));
+            v.pos.z = static_cast<float>(loadPlyScalar(row + fz.offset, fz.type, swap));
+        }
+
+        if (hasNormals) {
+            v.normal.x = static_cast<float>(loadPlyScalar(row + fields[inx].offset, fields[inx].type, swap));
+            v.normal.y = static_cast<float>(loadPlyScalar(row + fields[iny].offset, fields[iny].type, swap));
+            v.normal.z = static_cast<float>(loadPlyScalar(row + fields[inz].offset, fields[inz].type, swap));
+        }
+    }
+
+    return p + stride * e.count;
+}
+
+static void emitPolygon(const uint32_t* poly, size_t n, size_t vertexCount,
+                        std::vector<uint32_t>& indices)
+{
+    for (size_t k = 0; k < n; ++k) {
+        if (poly[k] >= vertexCount)
+            throw std::runtime_error("PLY face index out of range");
+    }
+    // fan triangulation, matching aiProcess_Triangulate for convex faces
+    for (size_t k = 2; k < n; ++k) {
+        indices.push_back(poly[0]);
+        indices.push_back(poly[k - 1]);
+        indices.push_back(poly[k]);
+    }
+}
+
+static const uint8_t* readBinaryPlyFaces(const PlyElement& e, const uint8_t* p,
+                                         const uint8_t* end, bool swap,
+                                         size_t vertexCount, MeshData& out)
+{
+    const int listIdx = findIndexListProperty(e);
+    if (listIdx < 0)
+        throw std::runtime_error("PLY face element has no vertex_indices list");
+
+    const PlyProperty& list = e.properties[listIdx];
+    if (list.type == PlyType::Float32 || list.type == PlyType::Float64)
+        throw std::runtime_error("PLY face indices must be integers");
+
+    out.indices.reserve(out.indices.size() + e.count * 3);
+
+    const size_t countSize = plyTypeSize(list.countType);
+    const size_t itemSize  = plyTypeSize(list.type);
+    std::vector<uint32_t> poly;
+
+    // fast path: the element is just "list uchar int|uint vertex_indices"
+    const bool tightTriangles = e.properties.size() == 1 && countSize == 1 && itemSize == 4;
+
+    for (size_t f = 0; f < e.count; ++f) {
+        if (tightTriangles && p + 13 <= end && *p == 3) {
+            uint32_t tri[3];
+            tri[0] = loadScalar<uint32_t>(p + 1, swap);
+            tri[1] = loadScalar<uint32_t>(p + 5, swap);
+            tri[2] = loadScalar<uint32_t>(p + 9, swap);
+            emitPolygon(tri, 3, vertexCount, out.indices);
+            p += 13;
+            continue;
+        }
+
+        for (size_t i = 0; i < e.properties.size(); ++i) {
+            const PlyProperty& prop = e.properties[i];
+            if (!prop.isList) {
+                p += plyTypeSize(prop.type);
+                if (p > end) throw truncated("PLY face data");
+                continue;
+            }
+
+            if (p + plyTypeSize(prop.countType) > end) throw truncated("PLY face data");
+            size_t n = static_cast<size_t>(loadPlyScalar(p, prop.countType, swap));
+            p += plyTypeSize(prop.countType);
+
+            const size_t bytes = n * plyTypeSize(prop.type);
+            if (static_cast<size_t>(end - p) < bytes) throw truncated("PLY face data");
+
+            if (static_cast<int>(i) == listIdx) {
+                poly.resize(n);
+                for (size_t k = 0; k < n; ++k)
+                    poly[k] = static_cast<uint32_t>(loadPlyScalar(p + k * itemSize, prop.type, swap));
+                emitPolygon(poly.data(), n, vertexCount, out.indices);
+            }
+            p += bytes;
+        }
+    }
+
+    return p;
+}
+
+static void readBinaryPly(const PlyHeader& header, const uint8_t* data, size_t size,
+                          MeshData& out)
+{
+    const bool swap = (header.format == PlyFormat::BinaryBigEndian) == hostIsLittleEndian();
+
+    const PlyElement* vertexElement = findElement(header, "vertex");
+    if (!vertexElement) throw std::runtime_error("PLY file has no vertex element");
+    const size_t vertexCount = vertexElement->count;
+
+    const uint8_t* p   = data + header.dataOffset;
+    const uint8_t* end = data + size;
+    bool hasNormals    = false;
+
+    for (const auto& e : header.elements) {
+        if (&e == vertexElement)
+            p = readBinaryPlyVertices(e, p, end, swap, out, hasNormals);
+        else if (e.name == "face")
+            p = readBinaryPlyFaces(e, p, end, swap, vertexCount, out);
+        else
+            p = skipBinaryElement(e, p, end, swap);
+    }
+
+    if (!hasNormals) {
+        std::cout << "PLY has no normals, smooth normals are generated after import\n";
+        out.hasNormals = false;
+    }
+}
+
+// ----------------------------------------
+// binary STL
+// ----------------------------------------
+
+static bool readBinaryStl(const uint8_t* data, size_t size, MeshData& out)
+{
+    constexpr size_t HEADER_SIZE = 80 + 4;
+    constexpr size_t RECORD_SIZE = 50;   // normal, 3 vertices, uint16 attribute
+
+    if (size < HEADER_SIZE) return false;
+
+    const bool   swap  = !hostIsLittleEndian();
+    const size_t count = loadScalar<uint32_t>(data + 80, swap);
+
+    // an ASCII STL (or a truncated binary one) will not match the record count
+    if (HEADER_SIZE + count * RECORD_SIZE != size) return false;
+
+    out.vertices.resize(count * 3);
+    out.indices.resize(count * 3);
+
+    // the stored facet normals would make every vertex unique; smooth
+    // normals are generated once the soup has been welded
+    out.hasNormals = false;
+    const glm::vec3 placeholder(0.0f, 0.0f, 1.0f);
+
+    const uint8_t* rec = data + HEADER_SIZE;
+    for (size_t t = 0; t < count; ++t, rec += RECORD_SIZE) {
+        float f[9];
+        for (int k = 0; k < 9; ++k)
+            f[k] = loadScalar<float>(rec + 12 + 4 * k, swap);
+
+        Vertex* v = &out.vertices[3 * t];
+        v[0].pos = glm::vec3(f[0], f[1], f[2]); v[0].normal = placeholder;
+        v[1].pos = glm::vec3(f[3], f[4], f[5]); v[1].normal = placeholder;
+        v[2].pos = glm::vec3(f[6], f[7], f[8]); v[2].normal = placeholder;
+
+        out.indices[3 * t + 0] = static_cast<uint32_t>(3 * t + 0);
+        out.indices[3 * t + 1] = static_cast<uint32_t>(3 * t + 1);
+        out.indices[3 * t + 2] = static_cast<uint32_t>(3 * t + 2);
+    }
+    return true;
+}
+
+// ----------------------------------------
+// text chunking (shared by ASCII PLY and OBJ)
+// ----------------------------------------
+
+struct TextChunk {
+    const char* begin = nullptr;
+    const char* end   = nullptr;
+};
+
+// Splits [begin, end) into chunks that start at a line start and end just
+// past a '\n' (or at end). A few chunks per worker keeps the load balanced.
+static std::vector<TextChunk> splitIntoLineChunks(const char* begin, const char* end)
+{
+    constexpr size_t MIN_CHUNK_BYTES = 1 << 20;
+
+    const size_t total      = static_cast<size_t>(end - begin);
+    const size_t chunkCount = std::max<size_t>(1, std::min<size_t>(workerCount() * 4,
+                                                                   total / MIN_CHUNK_BYTES));
+
+    std::vector<TextChunk> chunks;
+    const char* start = begin;
+    for (size_t c = 1; c <= chunkCount && start < end; ++c) {
+        const char* cut = (c == chunkCount) ? end : begin + total * c / chunkCount;
+        if (cut < start) cut = start;
+        if (cut < end) {
+            const void* nl = std::memchr(cut, '\n', static_cast<size_t>(end - cut));
+            cut = nl ? static_cast<const char*>(nl) + 1 : end;
+        }
+        chunks.push_back({ start, cut });
+        start = cut;
+    }
+    return chunks;
+}
+
+static const char* findLineEnd(const char* p, const char* end)
+{
+    const void* nl = std::memchr(p, '\n', static_cast<size_t>(end - p));
+    return nl ? static_cast<const char*>(nl) : end;
+}
+
+static size_t countLines(const TextChunk& chunk)
+{
+    size_t lines = 0;
+    for (const char* p = chunk.begin; p < chunk.end; ++lines) {
+        const char* eol = findLineEnd(p, chunk.end);
+        p = (eol < chunk.end) ? eol + 1 : chunk.end;
+    }
+    return lines;
+}
+
+static bool isBlank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static const char* skipBlanks(const char* p, const char* end)
+{
+    while (p < end && isBlank(*p)) ++p;
+    return p;
+}
+
+template <typename T>
+static bool parseNumber(const char*& p, const char* end, T& value)
+{
+    p = skipBlanks(p, end);
+    if (p < end && *p == '+') ++p;
+    auto res = std::from_chars(p, end, value);
+    if (res.ec != std::errc()) return false;
+    p = res.ptr;
+    return true;
+}
+
+// ----------------------------------------
+// ASCII PLY (parallel)
+// ----------------------------------------
+
+static bool readAsciiPly(const PlyHeader& header, const uint8_t* data, size_t size,
+                         MeshData& out)
+{
+    // Lines are mapped to elements purely by position, so only the usual
+    // "vertex, face, ..." layout with scalar vertex properties and the index
+    // list first in the face element is handled; anything else goes to Assimp.
+    if (header.elements.empty() || header.elements[0].name != "vertex") return false;
+    const PlyElement& ve = header.elements[0];
+    const PlyElement* fe = (header.elements.size() > 1 && header.elements[1].name == "face")
+                         ? &header.elements[1] : nullptr;
+
+    for (const auto& prop : ve.properties)
+        if (prop.isList) return false;
+    if (fe && findIndexListProperty(*fe) != 0) return false;
+
+    // destination slot per vertex property: 0..2 position, 3..5 normal, -1 unused
+    static const char* const SLOT_NAMES[6] = { "x", "y", "z", "nx", "ny", "nz" };
+    std::vector<int> slots(ve.properties.size(), -1);
+    int found = 0;
+    for (int s = 0; s < 6; ++s) {
+        int idx = findScalarProperty(ve, SLOT_NAMES[s]);
+        if (idx >= 0) { slots[idx] = s; found |= 1 << s; }
+    }
+    if ((found & 0x7) != 0x7)
+        throw std::runtime_error("PLY vertex element has no x/y/z properties");
+    const bool hasNormals = (found & 0x38) == 0x38;
+
+    const size_t vertexCount = ve.count;
+    const size_t faceCount   = fe ? fe->count : 0;
+    const size_t usedLines   = vertexCount + faceCount;
+
+    const char* body = reinterpret_cast<const char*>(data + header.dataOffset);
+    const char* end  = reinterpret_cast<const char*>(data + size);
+    std::vector<TextChunk> chunks = splitIntoLineChunks(body, end);
+
+    // pass 1: line counts give every chunk its first global line number
+    std::vector<size_t> firstLine(chunks.size() + 1, 0);
+    parallelTasks(chunks.size(), [&](size_t c) {
+        firstLine[c + 1] = countLines(chunks[c]);
+    });
+    for (size_t c = 0; c < chunks.size(); ++c) firstLine[c + 1] += firstLine[c];
+    if (firstLine.back() < usedLines) throw truncated("ASCII PLY data");
+
+    // pass 2: vertices go straight to their final slot, faces to per-chunk lists
+    out.vertices.resize(vertexCount);
+    std::vector<std::vector<uint32_t>> chunkIndices(chunks.size());
+
+    parallelTasks(chunks.size(), [&](size_t c) {
+        std::vector<uint32_t>& indices = chunkIndices[c];
+        std::vector<uint32_t>  poly;
+
+        size_t      line = firstLine[c];
+        const char* p    = chunks[c].begin;
+        const char* cend = chunks[c].end;
+
+        for (; p < cend && line < usedLines; ++line) {
+            const char* eol = findLineEnd(p, cend);
+            const char* q   = p;
+
+            if (line < vertexCount) {
+                float values[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+                for (int slot : slots) {
+                    float v = 0.0f;
+                    if (!parseNumber(q, eol, v))
+                        throw std::runtime_error("Malformed ASCII PLY vertex on data line " +
+                                                 std::to_string(line + 1));
+                    if (slot >= 0) values[slot] = v;
+                }
+                Vertex& vx = out.vertices[line];
+                vx.pos    = glm::vec3(values[0], values[1], values[2]);
+                vx.normal = glm::vec3(values[3], values[4], values[5]);
+            } else {
+                // every index takes at least a digit and a separator
+                size_t n = 0;
+                if (!parseNumber(q, eol, n) || n > size_t(eol - q + 1) / 2)
+                    throw std::runtime_error("Malformed ASCII PLY face on data line " +
+                                             std::to_string(line + 1));
+                poly.resize(n);
+                for (size_t k = 0; k < n; ++k) {
+                    int64_t idx = 0;
+                    if (!parseNumber(q, eol, idx) || idx < 0)
+                        throw std::runtime_error("Malformed ASCII PLY face on data line " +
+                                                 std::to_string(line + 1));
+                    poly[k] = static_cast<uint32_t>(std::min<int64_t>(idx, UINT32_MAX));
+                }
+                emitPolygon(poly.data(), n, vertexCount, indices);
+            }
+
+            p = (eol < cend) ? eol + 1 : cend;
+        }
+    });
+
+    // stitch the per-chunk face lists in order
+    std::vector<size_t> indexOffset(chunks.size() + 1, 0);
+    for (size_t c = 0; c < chunks.size(); ++c)
+        indexOffset[c + 1] = indexOffset[c] + chunkIndices[c].size();
+
+    out.indices.resize(indexOffset.back());
+    parallelTasks(chunks.size(), [&](size_t c) {
+        std::copy(chunkIndices[c].begin(), chunkIndices[c].end(),
+                  out.indices.begin() + indexOffset[c]);
+        std::vector<uint32_t>().swap(chunkIndices[c]);
+    });
+
+    if (!hasNormals) {
+        std::cout << "PLY has no normals, smooth normals are generated after import\n";
+        out.hasNormals = false;
+    }
+    return true;
+}
+
+// ----------------------------------------
+// OBJ (parallel)
+// ----------------------------------------
+
+struct ObjChunk {
+    std::vector<glm::vec3> positions;
+    // absolute 0-based indices; relative references are patched at stitch
+    // time from the (slot, chunk-local vertex) pairs in `relative`
+    std::vector<uint32_t>                    indices;
+    std::vector<std::pair<size_t, int64_t>>  relative;
+    bool hasFaces        = false;
+    bool partBeforeFaces = false;   // o / g / usemtl before this chunk's first face
+};
+
+static bool isPartStatement(const char* q, const char* eol)
+{
+    if (eol - q >= 2 && (q[0] == 'o' || q[0] == 'g') && isBlank(q[1])) return true;
+    return eol - q >= 7 && std::memcmp(q, "usemtl", 6) == 0 && isBlank(q[6]);
+}
+
+// Two kinds of file are left to Assimp, which sets handOff and stops the
+// parse on every chunk:
+// - files with their own normals: OBJ indexes normals separately from
+//   positions, and Assimp keeps them (one vertex per position / normal
+//   pair) where this reader would regenerate them;
+// - files with several parts (o / g / usemtl after a face), which Assimp
+//   turns into one submesh each. A part statement before this chunk's
+//   first face only counts if an earlier chunk had faces (see readObj()).
+static void parseObjChunk(const TextChunk& chunk, ObjChunk& out, std::atomic<bool>& handOff)
+{
+    struct Corner {
+        int64_t value;
+        bool    relative;
+    };
+    std::vector<Corner> poly;
+
+    auto emit = [&](const Corner& corner) {
+        if (corner.relative) {
+            out.relative.emplace_back(out.indices.size(), corner.value);
+            out.indices.push_back(0);
+        } else {
+            if (corner.value > static_cast<int64_t>(UINT32_MAX))
+                throw std::runtime_error("OBJ vertex index out of range");
+            out.indices.push_back(static_cast<uint32_t>(corner.value));
+        }
+    };
+
+    for (const char* p = chunk.begin; p < chunk.end && !handOff.load(std::memory_order_relaxed); ) {
+        const char* eol = findLineEnd(p, chunk.end);
+        const char* q   = skipBlanks(p, eol);
+        p = (eol < chunk.end) ? eol + 1 : chunk.end;
+
+        const bool normal = eol - q >= 3 && q[0] == 'v' && q[1] == 'n' && isBlank(q[2]);
+        if (normal || (out.hasFaces && isPartStatement(q, eol))) {
+            handOff.store(true, std::memory_order_relaxed);
+            break;
+        }
+        if (isPartStatement(q, eol)) {
+            out.partBeforeFaces = true;
+            continue;
+        }
+        if (eol - q < 2 || !isBlank(q[1])) continue;
+
+        if (q[0] == 'v') {
+            glm::vec3 v(0.0f);
+            q += 1;
+            if (!parseNumber(q, eol, v.x) || !parseNumber(q, eol, v.y) || !parseNumber(q, eol, v.z))
+                throw std::runtime_error("Malformed OBJ vertex line");
+            out.positions.push_back(v);
+        } else if (q[0] == 'f') {
+            q += 1;
+            poly.clear();
+            out.hasFaces = true;
+            const int64_t localCount = static_cast<int64_t>(out.positions.size());
+
+            for (;;) {
+                q = skipBlanks(q, eol);
+                if (q >= eol) break;
+
+                int64_t idx = 0;
+                if (!parseNumber(q, eol, idx) || idx == 0)
+                    throw std::runtime_error("Malformed OBJ face line");
+                // texture references ("i/t") are not used; normal ones
+                // ("i/t/n", "i//n") need "vn" lines, which end the parse
+                while (q < eol && !isBlank(*q)) ++q;
+
+                if (idx > 0) poly.push_back({ idx - 1, false });
+                else         poly.push_back({ localCount + idx, true });
+            }
+
+            for (size_t k = 2; k < poly.size(); ++k) {
+                emit(poly[0]);
+                emit(poly[k - 1]);
+                emit(poly[k]);
+            }
+        }
+        // vt / s / mtllib / comments are ignored
+    }
+}
+
+// Returns false for files with normals or several parts (see parseObjChunk()).
+static bool readObj(const uint8_t* data, size_t size, MeshData& out)
+{
+    const char* begin = reinterpret_cast<const char*>(data);
+    std::vector<TextChunk> chunks = splitIntoLineChunks(begin, begin + size);
+    std::vector<ObjChunk>  parsed(chunks.size());
+    std::atomic<bool>      handOff{ false };
+
+    parallelTasks(chunks.size(), [&](size_t c) {
+        parseObjChunk(chunks[c], parsed[c], handOff);
+    });
+    if (handOff) return false;
+
+    bool facesBefore = false;
+    for (const ObjChunk& chunk : parsed) {
+        if (chunk.partBeforeFaces && facesBefore) return false;
+        facesBefore = facesBefore || chunk.hasFaces;
+    }
+
+    // per-chunk vertex / index offsets
+    std::vector<size_t> vertexOffset(chunks.size() + 1, 0);
+    std::vector<size_t> indexOffset(chunks.size() + 1, 0);
+    for (size_t c = 0; c < chunks.size(); ++c) {
+        vertexOffset[c + 1] = vertexOffset[c] + parsed[c].positions.size();
+        indexOffset[c + 1]  = indexOffset[c]  + parsed[c].indices.size();
+    }
+    const size_t vertexCount = vertexOffset.back();
+    if (vertexCount > UINT32_MAX) throw std::runtime_error("OBJ has too many vertices");
+
+    out.vertices.resize(vertexCount);
+    out.indices.resize(indexOffset.back());
+
+    parallelTasks(chunks.size(), [&](size_t c) {
+        ObjChunk& chunk = parsed[c];
+
+        Vertex* dstV = out.vertices.data() + vertexOffset[c];
+        for (size_t i = 0; i < chunk.positions.size(); ++i)
+            dstV[i].pos = chunk.positions[i];
+
+        uint32_t* dstI = out.indices.data() + indexOffset[c];
+        std::copy(chunk.indices.begin(), chunk.indices.end(), dstI);
+
+        for (const auto& rel : chunk.relative) {
+            int64_t global = static_cast<int64_t>(vertexOffset[c]) + rel.second;
+            if (global < 0)
+                throw std::runtime_error("OBJ relative index points before the first vertex");
+            dstI[rel.first] = static_cast<uint32_t>(global);
+        }
+
+        for (size_t i = 0; i < chunk.indices.size(); ++i)
+            if (dstI[i] >= vertexCount)
+                throw std::runtime_error("OBJ face index out of range");
+
+        chunk = ObjChunk{};
+    });
+
+    // no normals in the file: smooth ones are generated after the weld
+    out.hasNormals = false;
+    return true;
+}
+
+// ----------------------------------------
+// entry point
+// ----------------------------------------
+
+bool readMeshNative(const std::string& path, const std::string& ext, MeshData& out)
+{
+    if (ext != "ply" && ext != "stl" && ext != "obj") return false;
+
+    MappedFile file(path);
+
+    if (ext == "obj") {
+        std::cout << "Using parallel OBJ parser (" << workerCount() << " threads)\n";
+        if (!readObj(file.data(), file.size(), out)) {
+            std::cout << "OBJ normals / multiple parts not supported natively\n";
+            out = MeshData{};
+            return false;
+        }
+        return true;
+    }
+
+    if (ext == "ply") {
+        PlyHeader header = parsePlyHeader(file.data(), file.size());
+        if (header.format == PlyFormat::Ascii) {
+            std::cout << "Using parallel ASCII PLY parser (" << workerCount() << " threads)\n";
+            if (!readAsciiPly(header, file.data(), file.size(), out)) {
+                std::cout << "ASCII PLY element layout not supported natively\n";
+                out = MeshData{};
+                return false;
+            }
+            return true;
+        }
+        std::cout << "Using native binary PLY reader\n";
+        readBinaryPly(header, file.data(), file.size(), out);
+        return true;
+    }
+
+    if (!readBinaryStl(file.data(), file.size(), out)) {
+        std::cout << "Not a binary STL, no native reader\n";
+        out = MeshData{};
+        return false;
+    }
+    std::cout << "Using native binary STL reader\n";
+    return true;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <string>
+
+#include "MeshLoader.h"
+
+// Built-in readers that decode straight from a memory-mapped file into
+// MeshData, without going through Assimp.
+//
+// Supported: binary little/big-endian PLY, binary STL, and ASCII PLY / OBJ,
+// which are split into newline-aligned chunks and parsed on all cores.
+// OBJ files with their own normals ("vn") or several parts (o / g /
+// usemtl between faces) are left to Assimp.
+// Returns false when the file is in a variant these readers do not handle,
+// so the caller can fall back to Assimp. Throws on malformed files.
+bool readMeshNative(const std::string& path, const std::string& ext, MeshData& out);
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <thread>
+#include <vector>
+
+// Minimal fork/join helpers on top of std::thread.
+// Worker 0 always runs on the calling thread; the first exception thrown by
+// any worker is rethrown once all workers have joined.
+
+inline unsigned workerCount()
+{
+    unsigned n = std::thread::hardware_concurrency();
+    return n ? n : 1;
+}
+
+// Runs fn(task) for every task in [0, taskCount), tasks strided over workers.
+template <typename Fn>
+void parallelTasks(size_t taskCount, Fn&& fn)
+{
+    const size_t threads = std::min<size_t>(workerCount(), taskCount);
+    if (threads <= 1) {
+        for (size_t t = 0; t < taskCount; ++t) fn(t);
+        return;
+    }
+
+    std::vector<std::exception_ptr> errors(threads);
+    auto work = [&](size_t worker) {
+        try {
+            for (size_t t = worker; t < taskCount; t += threads) fn(t);
+        } catch (...) {
+            errors[worker] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (size_t w = 1; w < threads; ++w) pool.emplace_back(work, w);
+    work(0);
+    for (auto& t : pool) t.join();
+
+    for (auto& e : errors)
+        if (e) std::rethrow_exception(e);
+}
+
+// Number of ranges parallelRanges() will use for count items; lets callers
+// size per-range scratch storage up front.
+inline size_t parallelRangeCount(size_t count, size_t minRange)
+{
+    if (count == 0) return 0;
+    minRange = std::max<size_t>(minRange, 1);
+    size_t ranges = std::min<size_t>(workerCount(), (count + minRange - 1) / minRange);
+    return std::max<size_t>(ranges, 1);
+}
+
+// Splits [0, count) into one contiguous range per worker (never smaller than
+// minRange) and runs fn(begin, end, rangeIndex) on each.
+template <typename Fn>
+void parallelRanges(size_t count, size_t minRange, Fn&& fn)
+{
+    const size_t ranges = parallelRangeCount(count, minRange);
+    if (ranges == 0) return;
+
+    parallelTasks(ranges, [&](size_t r) {
+        size_t begin = count * r / ranges;
+        size_t end   = count * (r + 1) / ranges;
+        fn(begin, end, r);
+    });
+}
+
+// Exclusive prefix sum of flags (0/1 or small counts) in parallel:
+// out[i] = sum of flags[0..i), out[count] = total. Used to compact arrays
+// while keeping their order.
+template <typename T>
+std::vector<uint32_t> parallelExclusiveScan(const std::vector<T>& flags, size_t minRange = 1u << 16)
+{
+    const size_t count  = flags.size();
+    const size_t ranges = parallelRangeCount(count, minRange);
+    std::vector<uint32_t> out(count + 1, 0);
+    if (count == 0) return out;
+
+    std::vector<uint32_t> rangeSums(ranges, 0);
+    parallelRanges(count, minRange, [&](size_t begin, size_t end, size_t r) {
+        uint32_t sum = 0;
+        for (size_t i = begin; i < end; ++i) sum += static_cast<uint32_t>(flags[i]);
+        rangeSums[r] = sum;
+    });
+
+    std::vector<uint32_t> rangeStart(ranges, 0);
+    uint32_t total = 0;
+    for (size_t r = 0; r < ranges; ++r) {
+        rangeStart[r] = total;
+        total += rangeSums[r];
+    }
+
+    parallelRanges(count, minRange, [&](size_t begin, size_t end, size_t r) {
+        uint32_t sum = rangeStart[r];
+        for (size_t i = begin; i < end; ++i) {
+            out[i] = sum;
+            sum += static_cast<uint32_t>(flags[i]);
+        }
+    });
+    out[count] = total;
+    return out;
+}
@@ -0,0 +1,99 @@
+#include "PipelineCache.h"
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+// VkPipelineCacheHeaderVersionOne, read field by field: headerSize,
+// headerVersion, vendorID, deviceID, then the 16-byte pipelineCacheUUID
+static constexpr size_t CACHE_HEADER_SIZE = 16 + VK_UUID_SIZE;
+
+void PipelineCache::init(VkPhysicalDevice physicalDevice, VkDevice device, const std::string& path)
+{
+    m_device = device;
+    m_path   = path;
+    vkGetPhysicalDeviceProperties(physicalDevice, &m_properties);
+
+    std::vector<char> data;
+    if (!m_path.empty()) {
+        std::ifstream ifs(m_path, std::ios::in | std::ios::binary);
+        if (ifs) data.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+
+        if (data.empty()) {
+            std::cout << "Pipeline cache: " << m_path << " not found, starting empty\n";
+        } else if (!matchesDevice(data.data(), data.size())) {
+            std::cout << "Pipeline cache: " << m_path << " is from another device or driver, starting empty\n";
+            data.clear();
+        } else {
+            std::cout << "Pipeline cache: loaded " << data.size() / 1024.0 << " KB from " << m_path << "\n";
+        }
+    }
+
+    VkPipelineCacheCreateInfo ci{};
+    ci.sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    ci.initialDataSize = data.size();
+    ci.pInitialData    = data.empty() ? nullptr : data.data();
+
+    if (vkCreatePipelineCache(m_device, &ci, nullptr, &m_cache) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create pipeline cache");
+    }
+}
+
+void PipelineCache::destroy()
+{
+    if (m_cache != VK_NULL_HANDLE) vkDestroyPipelineCache(m_device, m_cache, nullptr);
+    m_cache  = VK_NULL_HANDLE;
+    m_device = VK_NULL_HANDLE;
+}
+
+bool PipelineCache::matchesDevice(const void* data, size_t size) const
+{
+    if (size < CACHE_HEADER_SIZE) return false;
+
+    uint32_t fields[4];
+    std::memcpy(fields, data, sizeof(fields));
+    const uint8_t* uuid = static_cast<const uint8_t*>(data) + sizeof(fields);
+
+    return fields[0] >= CACHE_HEADER_SIZE && fields[0] <= size &&
+           fields[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+           fields[2] == m_properties.vendorID &&
+           fields[3] == m_properties.deviceID &&
+           std::memcmp(uuid, m_properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+void PipelineCache::save() const
+{
+    if (m_cache == VK_NULL_HANDLE || m_path.empty()) return;
+
+    size_t size = 0;
+    if (vkGetPipelineCacheData(m_device, m_cache, &size, nullptr) != VK_SUCCESS || size == 0) return;
+    std::vector<char> data(size);
+    if (vkGetPipelineCacheData(m_device, m_cache, &size, data.data()) != VK_SUCCESS) return;
+
+    const std::string tmpPath = m_path + ".tmp";
+    {
+        std::ofstream ofs(tmpPath, std::ios::out | std::ios::trunc | std::ios::binary);
+        ofs.write(data.data(), static_cast<std::streamsize>(size));
+        if (!ofs) {
+            std::cerr << "Warning: cannot write pipeline cache " << m_path << "\n";
+            ofs.close();
+            std::error_code ec;
+            std::filesystem::remove(tmpPath, ec);
+            return;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, m_path, ec);
+    if (ec) {
+        std::cerr << "Warning: failed to finalize pipeline cache " << m_path << ": " << ec.message() << "\n";
+        std::filesystem::remove(tmpPath, ec);
+        return;
+    }
+    std::cout << "Wrote pipeline cache: " << m_path << " (" << size / 1024.0 << " KB)\n";
+}
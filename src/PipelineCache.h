@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include <vulkan/vulkan.h>
+
+// VkPipelineCache persisted to a file between runs.
+//
+// The blob the driver returns starts with a VkPipelineCacheHeaderVersionOne
+// (header size, version, vendor ID, device ID, pipelineCacheUUID). init()
+// only hands a file back to the driver when that header matches the
+// current device, so a different GPU or a driver update starts from an
+// empty cache instead of relying on the driver to reject a foreign blob.
+// save() writes next to the target and renames, like the mesh cache.
+
+class PipelineCache {
+public:
+    PipelineCache() = default;
+    ~PipelineCache() { destroy(); }
+
+    PipelineCache(const PipelineCache&)            = delete;
+    PipelineCache& operator=(const PipelineCache&) = delete;
+
+    // Creates the cache, seeded from path when the file is valid for this
+    // device. An empty path keeps the cache in memory only.
+    void init(VkPhysicalDevice physicalDevice, VkDevice device, const std::string& path);
+
+    // Writes the current contents to the path given to init(), if any.
+    void save() const;
+    void destroy();
+
+    VkPipelineCache handle() const { return m_cache; }
+
+private:
+    bool matchesDevice(const void* data, size_t size) const;
+
+    VkDevice                   m_device = VK_NULL_HANDLE;
+    VkPipelineCache            m_cache  = VK_NULL_HANDLE;
+    VkPhysicalDeviceProperties m_properties{};
+    std::string                m_path;
+};
@@ -0,0 +1,104 @@
+#include "PlyHeader.h"
+
+#include <sstream>
+#include <stdexcept>
+
+static PlyType parsePlyType(const std::string& name)
+{
+    if (name == "char"   || name == "int8")    return PlyType::Int8;
+    if (name == "uchar"  || name == "uint8")   return PlyType::UInt8;
+    if (name == "short"  || name == "int16")   return PlyType::Int16;
+    if (name == "ushort" || name == "uint16")  return PlyType::UInt16;
+    if (name == "int"    || name == "int32")   return PlyType::Int32;
+    if (name == "uint"   || name == "uint32")  return PlyType::UInt32;
+    if (name == "float"  || name == "float32") return PlyType::Float32;
+    if (name == "double" || name == "float64") return PlyType::Float64;
+    throw std::runtime_error("Unknown PLY property type: " + name);
+}
+
+PlyHeader parsePlyHeader(const uint8_t* data, size_t size)
+{
+    PlyHeader header;
+    size_t pos       = 0;
+    bool   firstLine = true;
+    bool   ended     = false;
+
+    while (pos < size && !ended) {
+        size_t eol = pos;
+        while (eol < size && data[eol] != '\n') ++eol;
+
+        std::string line(reinterpret_cast<const char*>(data + pos), eol - pos);
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        pos = (eol < size) ? eol + 1 : size;
+
+        std::istringstream ss(line);
+        std::string keyword;
+        ss >> keyword;
+
+        if (firstLine) {
+            if (keyword != "ply") throw std::runtime_error("Not a PLY file");
+            firstLine = false;
+        } else if (keyword == "format") {
+            std::string fmt;
+            ss >> fmt;
+            if      (fmt == "ascii")                header.format = PlyFormat::Ascii;
+            else if (fmt == "binary_little_endian") header.format = PlyFormat::BinaryLittleEndian;
+            else if (fmt == "binary_big_endian")    header.format = PlyFormat::BinaryBigEndian;
+            else throw std::runtime_error("Unknown PLY format: " + fmt);
+        } else if (keyword == "element") {
+            PlyElement e;
+            ss >> e.name >> e.count;
+            header.elements.push_back(e);
+        } else if (keyword == "property") {
+            if (header.elements.empty())
+                throw std::runtime_error("PLY property declared before any element");
+
+            PlyProperty prop;
+            std::string type;
+            ss >> type;
+            if (type == "list") {
+                std::string countType, itemType;
+                ss >> countType >> itemType >> prop.name;
+                prop.isList    = true;
+                prop.countType = parsePlyType(countType);
+                prop.type      = parsePlyType(itemType);
+            } else {
+                ss >> prop.name;
+                prop.type = parsePlyType(type);
+            }
+            header.elements.back().properties.push_back(prop);
+        } else if (keyword == "end_header") {
+            ended = true;
+        }
+        // comment / obj_info lines are ignored
+    }
+
+    if (!ended) throw std::runtime_error("PLY header is missing end_header");
+    header.dataOffset = pos;
+    return header;
+}
+
+const PlyElement* findElement(const PlyHeader& header, const char* name)
+{
+    for (const auto& e : header.elements)
+        if (e.name == name) return &e;
+    return nullptr;
+}
+
+int findScalarProperty(const PlyElement& e, const char* name)
+{
+    for (size_t i = 0; i < e.properties.size(); ++i)
+        if (!e.properties[i].isList && e.properties[i].name == name)
+            return static_cast<int>(i);
+    return -1;
+}
+
+int findIndexListProperty(const PlyElement& e)
+{
+    for (size_t i = 0; i < e.properties.size(); ++i) {
+        const auto& p = e.properties[i];
+        if (p.isList && (p.name == "vertex_indices" || p.name == "vertex_index"))
+            return static_cast<int>(i);
+    }
+    return -1;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// PLY header model and the byte-level helpers shared by the native reader
+// and the streaming loader.
+
+// ----------------------------------------
+// byte helpers
+// ----------------------------------------
+
+inline bool hostIsLittleEndian()
+{
+    const uint16_t probe = 1;
+    uint8_t first = 0;
+    std::memcpy(&first, &probe, 1);
+    return first == 1;
+}
+
+template <typename T>
+inline T loadScalar(const uint8_t* p, bool swap)
+{
+    T value;
+    if (!swap) {
+        std::memcpy(&value, p, sizeof(T));
+        return value;
+    }
+    uint8_t tmp[sizeof(T)];
+    for (size_t i = 0; i < sizeof(T); ++i)
+        tmp[i] = p[sizeof(T) - 1 - i];
+    std::memcpy(&value, tmp, sizeof(T));
+    return value;
+}
+
+// ----------------------------------------
+// PLY header
+// ----------------------------------------
+
+enum class PlyType { Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64 };
+
+enum class PlyFormat { Ascii, BinaryLittleEndian, BinaryBigEndian };
+
+struct PlyProperty {
+    std::string name;
+    PlyType     type      = PlyType::Float32;  // item type for lists
+    bool        isList    = false;
+    PlyType     countType = PlyType::UInt8;
+};
+
+struct PlyElement {
+    std::string              name;
+    size_t                   count = 0;
+    std::vector<PlyProperty> properties;
+};
+
+struct PlyHeader {
+    PlyFormat               format = PlyFormat::Ascii;
+    std::vector<PlyElement> elements;
+    size_t                  dataOffset = 0;
+};
+
+inline size_t plyTypeSize(PlyType t)
+{
+    switch (t) {
+        case PlyType::Int8:
+        case PlyType::UInt8:   return 1;
+        case PlyType::Int16:
+        case PlyType::UInt16:  return 2;
+        case PlyType::Int32:
+        case PlyType::UInt32:
+        case PlyType::Float32: return 4;
+        case PlyType::Float64: return 8;
+    }
+    return 0;
+}
+
+inline double loadPlyScalar(const uint8_t* p, PlyType t, bool swap)
+{
+    switch (t) {
+        case PlyType::Int8:    return static_cast<int8_t>(*p);
+        case PlyType::UInt8:   return *p;
+        case PlyType::Int16:   return loadScalar<int16_t>(p, swap);
+        case PlyType::UInt16:  return loadScalar<uint16_t>(p, swap);
+        case PlyType::Int32:   return loadScalar<int32_t>(p, swap);
+        case PlyType::UInt32:  return loadScalar<uint32_t>(p, swap);
+        case PlyType::Float32: return loadScalar<float>(p, swap);
+        case PlyType::Float64: return loadScalar<double>(p, swap);
+    }
+    return 0.0;
+}
+
+// Parses everything up to and including end_header; throws on malformed headers.
+PlyHeader parsePlyHeader(const uint8_t* data, size_t size);
+
+const PlyElement* findElement(const PlyHeader& header, const char* name);
+int               findScalarProperty(const PlyElement& e, const char* name);
+int               findIndexListProperty(const PlyElement& e);   // vertex_indices / vertex_index
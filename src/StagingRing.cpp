@@ -0,0 +1,278 @@
+#include "StagingRing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <stdexcept>
+
+// pieces start on 16 bytes so element writes stay aligned
+static constexpr VkDeviceSize PIECE_ALIGNMENT = 16;
+
+// the reads the uploaded buffers feed
+static constexpr VkAccessFlags GEOMETRY_READ = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT |
+                                               VK_ACCESS_INDEX_READ_BIT |
+                                               VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+
+void StagingRing::init(VkDevice device, GpuAllocator& allocator,
+                       VkQueue queue, uint32_t queueFamily, VkDeviceSize size,
+                       uint32_t consumerFamily, VkSemaphore timeline)
+{
+    m_device         = device;
+    m_allocator      = &allocator;
+    m_queue          = queue;
+    m_queueFamily    = queueFamily;
+    m_consumerFamily = consumerFamily;
+    m_timeline       = consumerFamily != queueFamily ? timeline : VK_NULL_HANDLE;
+    if (consumerFamily != queueFamily && timeline == VK_NULL_HANDLE)
+        throw std::runtime_error("Staging ring: an ownership transfer needs a timeline semaphore");
+    m_slotSize  = size / SLOT_COUNT / PIECE_ALIGNMENT * PIECE_ALIGNMENT;
+    if (m_slotSize == 0) throw std::runtime_error("Staging ring is too small");
+
+    VkCommandPoolCreateInfo pci{};
+    pci.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pci.flags            = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT |
+                           VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    pci.queueFamilyIndex = queueFamily;
+    if (vkCreateCommandPool(m_device, &pci, nullptr, &m_pool) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create staging command pool");
+    }
+
+    VkBufferCreateInfo bci{};
+    bci.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bci.size        = m_slotSize * SLOT_COUNT;
+    bci.usage       = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bci.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if (vkCreateBuffer(m_device, &bci, nullptr, &m_buffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create staging ring buffer");
+    }
+
+    VkMemoryRequirements memReq;
+    vkGetBufferMemoryRequirements(m_device, m_buffer, &memReq);
+    m_memory = m_allocator->allocate(memReq,
+                                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                     AllocationStrategy::Linear);
+    vkBindBufferMemory(m_device, m_buffer, m_memory.memory, m_memory.offset);
+    m_mapped = static_cast<uint8_t*>(m_memory.mapped);
+
+    m_slots.resize(SLOT_COUNT);
+    std::vector<VkCommandBuffer> cmds(SLOT_COUNT);
+    VkCommandBufferAllocateInfo ai{};
+    ai.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    ai.commandPool        = m_pool;
+    ai.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    ai.commandBufferCount = SLOT_COUNT;
+    if (vkAllocateCommandBuffers(m_device, &ai, cmds.data()) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate staging command buffers");
+    }
+
+    VkFenceCreateInfo fci{};
+    fci.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    for (uint32_t i = 0; i < SLOT_COUNT; ++i) {
+        m_slots[i].cmd = cmds[i];
+        if (vkCreateFence(m_device, &fci, nullptr, &m_slots[i].fence) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create staging fence");
+        }
+    }
+    m_current = 0;
+    m_open    = false;
+    m_stats   = StagingStats{};
+    m_handovers.clear();
+
+    // the semaphore may outlive an earlier ring
+    m_value = 0;
+    if (m_timeline != VK_NULL_HANDLE) vkGetSemaphoreCounterValue(m_device, m_timeline, &m_value);
+}
+
+void StagingRing::destroy()
+{
+    if (m_device == VK_NULL_HANDLE) return;
+
+    finish();
+    for (Slot& s : m_slots)
+        if (s.fence != VK_NULL_HANDLE) vkDestroyFence(m_device, s.fence, nullptr);
+    m_slots.clear();
+    m_handovers.clear();
+    if (m_pool != VK_NULL_HANDLE) vkDestroyCommandPool(m_device, m_pool, nullptr);
+    if (m_buffer != VK_NULL_HANDLE) vkDestroyBuffer(m_device, m_buffer, nullptr);
+    m_allocator->free(m_memory);
+
+    m_pool   = VK_NULL_HANDLE;
+    m_buffer = VK_NULL_HANDLE;
+    m_mapped = nullptr;
+    m_device = VK_NULL_HANDLE;
+}
+
+// ----------------------------------------
+// slots
+// ----------------------------------------
+
+void StagingRing::waitSlot(Slot& slot)
+{
+    if (!slot.pending) return;
+
+    auto t0 = std::chrono::steady_clock::now();
+    vkWaitForFences(m_device, 1, &slot.fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+    m_stats.waitMilliseconds += std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - t0).count();
+
+    vkResetFences(m_device, 1, &slot.fence);
+    slot.pending = false;
+}
+
+void StagingRing::openSlot()
+{
+    Slot& slot = m_slots[m_current];
+    waitSlot(slot);   // only blocks when the GPU is a full ring behind
+
+    vkResetCommandBuffer(slot.cmd, 0);
+    VkCommandBufferBeginInfo bi{};
+    bi.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    bi.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(slot.cmd, &bi);
+
+    slot.used = 0;
+    slot.releases.clear();
+    m_open    = true;
+}
+
+uint64_t StagingRing::submit()
+{
+    if (!m_open) return m_value;
+    Slot& slot = m_slots[m_current];
+    const uint64_t value = m_value + 1;
+
+    VkSubmitInfo si{};
+    si.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    si.commandBufferCount = 1;
+    si.pCommandBuffers    = &slot.cmd;
+
+    VkTimelineSemaphoreSubmitInfo ts{};
+    if (m_timeline == VK_NULL_HANDLE) {
+        // draws submitted after this read the buffers without a queue wait
+        VkMemoryBarrier barrier{};
+        barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = GEOMETRY_READ;
+        vkCmdPipelineBarrier(slot.cmd,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+                             0, 1, &barrier, 0, nullptr, 0, nullptr);
+    } else {
+        // release the written ranges; the consumer records the matching
+        // acquire once the timeline reaches value
+        vkCmdPipelineBarrier(slot.cmd,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                             0, 0, nullptr,
+                             static_cast<uint32_t>(slot.releases.size()), slot.releases.data(),
+                             0, nullptr);
+
+        Handover h;
+        h.value    = value;
+        h.barriers = slot.releases;
+        for (VkBufferMemoryBarrier& b : h.barriers) {
+            b.srcAccessMask = 0;
+            b.dstAccessMask = GEOMETRY_READ;
+        }
+        m_handovers.push_back(std::move(h));
+
+        ts.sType                     = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        ts.signalSemaphoreValueCount = 1;
+        ts.pSignalSemaphoreValues    = &value;
+        si.pNext                     = &ts;
+        si.signalSemaphoreCount      = 1;
+        si.pSignalSemaphores         = &m_timeline;
+    }
+    vkEndCommandBuffer(slot.cmd);
+
+    if (vkQueueSubmit(m_queue, 1, &si, slot.fence) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to submit staging copy");
+    }
+
+    slot.pending = true;
+    m_stats.submits++;
+    m_current = (m_current + 1) % SLOT_COUNT;
+    m_open    = false;
+    m_value   = value;
+    return value;
+}
+
+uint64_t StagingRing::acquire(std::vector<VkBufferMemoryBarrier>& barriers)
+{
+    if (m_timeline == VK_NULL_HANDLE) return m_value;
+
+    uint64_t done = 0;
+    vkGetSemaphoreCounterValue(m_device, m_timeline, &done);
+    while (!m_handovers.empty() && m_handovers.front().value <= done) {
+        const auto& front = m_handovers.front().barriers;
+        barriers.insert(barriers.end(), front.begin(), front.end());
+        m_handovers.pop_front();
+    }
+    return done;
+}
+
+void StagingRing::addRelease(Slot& slot, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size)
+{
+    // consecutive pieces of one upload extend the same range
+    for (VkBufferMemoryBarrier& b : slot.releases) {
+        if (b.buffer == buffer && b.offset + b.size == offset) {
+            b.size += size;
+            return;
+        }
+    }
+
+    VkBufferMemoryBarrier b{};
+    b.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    b.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+    b.dstAccessMask       = 0;
+    b.srcQueueFamilyIndex = m_queueFamily;
+    b.dstQueueFamilyIndex = m_consumerFamily;
+    b.buffer              = buffer;
+    b.offset              = offset;
+    b.size                = size;
+    slot.releases.push_back(b);
+}
+
+void StagingRing::finish()
+{
+    submit();
+    for (Slot& s : m_slots) waitSlot(s);
+}
+
+// ----------------------------------------
+// upload
+// ----------------------------------------
+
+void StagingRing::upload(VkBuffer dst, VkDeviceSize dstOffset,
+                         size_t elementSize, size_t count, const FillFn& fill)
+{
+    if (elementSize == 0 || elementSize > m_slotSize)
+        throw std::runtime_error("Staging ring: element does not fit a slot");
+
+    size_t done = 0;
+    while (done < count) {
+        if (!m_open) openSlot();
+        Slot& slot = m_slots[m_current];
+
+        const VkDeviceSize start = (slot.used + PIECE_ALIGNMENT - 1) / PIECE_ALIGNMENT * PIECE_ALIGNMENT;
+        const size_t       fit   = start < m_slotSize ? size_t((m_slotSize - start) / elementSize) : 0;
+        if (fit == 0) {
+            submit();
+            continue;
+        }
+
+        const size_t       n      = std::min(fit, count - done);
+        const VkDeviceSize offset = VkDeviceSize(m_current) * m_slotSize + start;
+        fill(m_mapped + offset, done, n);
+
+        VkBufferCopy copy{};
+        copy.srcOffset = offset;
+        copy.dstOffset = dstOffset + VkDeviceSize(done) * elementSize;
+        copy.size      = VkDeviceSize(n) * elementSize;
+        vkCmdCopyBuffer(slot.cmd, m_buffer, dst, 1, &copy);
+        if (m_timeline != VK_NULL_HANDLE) addRelease(slot, dst, copy.dstOffset, copy.size);
+
+        slot.used       = start + copy.size;
+        m_stats.bytes  += copy.size;
+        done           += n;
+    }
+}
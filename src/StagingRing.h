@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "GpuAllocator.h"
+
+// Fixed-size, persistently mapped staging buffer for uploads of any size.
+//
+// The ring is cut into SLOT_COUNT slots, each with its own command buffer
+// and fence. upload() fills the current slot through a callback and
+// records the copy; when the slot is full it is submitted and the next
+// slot is opened, waiting on that slot's fence only if the GPU is still
+// copying out of it. The CPU therefore fills slot N+1 while the GPU copies
+// slot N, and host memory stays at the ring size whatever the mesh size.
+//
+// On the graphics queue every submit ends with a barrier from the copies to
+// vertex input and indirect reads, so draws submitted later on the same
+// queue see the data without a queue wait.
+//
+// On a dedicated transfer queue each submit instead releases the written
+// buffer ranges to the graphics family and signals the next value of a
+// timeline semaphore. acquire() hands back the matching acquire barriers
+// of every submit that has already completed, without waiting, so the
+// graphics queue only ever waits on finished copies.
+
+struct StagingStats {
+    VkDeviceSize bytes          = 0;
+    size_t       submits        = 0;
+    double       waitMilliseconds = 0.0;   // CPU blocked on slot fences
+};
+
+class StagingRing {
+public:
+    static constexpr uint32_t SLOT_COUNT = 4;
+
+    // Fills count elements starting at element first into dst.
+    using FillFn = std::function<void(void* dst, size_t first, size_t count)>;
+
+    StagingRing() = default;
+    ~StagingRing() { destroy(); }
+
+    StagingRing(const StagingRing&)            = delete;
+    StagingRing& operator=(const StagingRing&) = delete;
+
+    // consumerFamily is the family that reads the buffers; when it differs
+    // from queueFamily, timeline must be a timeline semaphore owned by the
+    // caller and every copy is handed over with an ownership transfer.
+    void init(VkDevice device, GpuAllocator& allocator,
+              VkQueue queue, uint32_t queueFamily, VkDeviceSize size,
+              uint32_t consumerFamily, VkSemaphore timeline);
+    void destroy();
+    bool isOpen() const { return m_buffer != VK_NULL_HANDLE; }
+
+    // Uploads count elements of elementSize bytes to dst at dstOffset, in
+    // as many pieces as the slots require. fill runs on the calling thread
+    // before upload() returns, so the source may be freed afterwards.
+    void upload(VkBuffer dst, VkDeviceSize dstOffset,
+                size_t elementSize, size_t count, const FillFn& fill);
+
+    // Submits the open slot, if any; does not wait. Returns the upload value
+    // the copies so far become visible at (see acquire()).
+    uint64_t submit();
+
+    // Appends the acquire barriers of every completed submit to barriers
+    // (record them on the consumer queue, after a wait on the timeline for
+    // the returned value) and returns the highest completed upload value.
+    // Without an ownership transfer nothing is appended and everything
+    // submitted counts as complete.
+    uint64_t acquire(std::vector<VkBufferMemoryBarrier>& barriers);
+
+    // Submits and waits until every copy has completed.
+    void finish();
+
+    const StagingStats& stats() const { return m_stats; }
+
+private:
+    struct Slot {
+        VkCommandBuffer cmd     = VK_NULL_HANDLE;
+        VkFence         fence   = VK_NULL_HANDLE;
+        VkDeviceSize    used    = 0;
+        bool            pending = false;   // submitted, fence not yet waited on
+        std::vector<VkBufferMemoryBarrier> releases;   // ranges written, one per buffer run
+    };
+
+    struct Handover {
+        uint64_t                           value = 0;
+        std::vector<VkBufferMemoryBarrier> barriers;
+    };
+
+    void openSlot();
+    void waitSlot(Slot& slot);
+    void addRelease(Slot& slot, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size);
+
+    VkDevice      m_device    = VK_NULL_HANDLE;
+    GpuAllocator* m_allocator = nullptr;
+    VkQueue       m_queue     = VK_NULL_HANDLE;
+    VkCommandPool m_pool      = VK_NULL_HANDLE;
+    VkBuffer      m_buffer    = VK_NULL_HANDLE;
+    GpuAllocation m_memory;
+    uint8_t*      m_mapped    = nullptr;
+    VkDeviceSize  m_slotSize  = 0;
+    uint32_t      m_current   = 0;
+    bool          m_open      = false;     // m_slots[m_current] is recording
+    uint32_t      m_queueFamily    = 0;
+    uint32_t      m_consumerFamily = 0;
+    VkSemaphore   m_timeline  = VK_NULL_HANDLE;   // only with an ownership transfer
+    uint64_t      m_value     = 0;         // last submitted upload value
+    std::vector<Slot>    m_slots;
+    std::deque<Handover> m_handovers;      // submitted, not yet acquired
+    StagingStats  m_stats;
+};
@@ -0,0 +1,83 @@
+#include "StartupTimeline.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct PhaseRecord {
+    const char*       name;
+    const char*       thread;
+    Clock::time_point start;
+    Clock::time_point end;
+};
+
+std::mutex               g_mutex;
+std::vector<PhaseRecord> g_phases;
+
+constexpr int BAR_WIDTH = 40;
+
+double msBetween(Clock::time_point a, Clock::time_point b)
+{
+    return std::chrono::duration<double, std::milli>(b - a).count();
+}
+
+} // namespace
+
+StartupPhase::StartupPhase(const char* name, const char* thread)
+    : m_name(name), m_thread(thread), m_start(Clock::now())
+{
+}
+
+void StartupPhase::end()
+{
+    if (!m_open) return;
+    m_open = false;
+
+    const Clock::time_point now = Clock::now();
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_phases.push_back({ m_name, m_thread, m_start, now });
+}
+
+void printStartupTimeline()
+{
+    std::vector<PhaseRecord> phases;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        phases.swap(g_phases);
+    }
+    if (phases.empty()) return;
+
+    std::sort(phases.begin(), phases.end(),
+              [](const PhaseRecord& a, const PhaseRecord& b) { return a.start < b.start; });
+
+    Clock::time_point first = phases.front().start;
+    Clock::time_point last  = phases.front().end;
+    for (const PhaseRecord& p : phases) last = std::max(last, p.end);
+    const double total = std::max(msBetween(first, last), 1e-3);
+
+    std::cout << "\nStartup timeline (" << total << " ms):\n";
+    for (const PhaseRecord& p : phases) {
+        const double begin = msBetween(first, p.start);
+        const double end   = msBetween(first, p.end);
+
+        const int from = std::min(BAR_WIDTH - 1, static_cast<int>(begin / total * BAR_WIDTH));
+        const int to   = std::max(from + 1, static_cast<int>(end / total * BAR_WIDTH + 0.5));
+        std::string bar(BAR_WIDTH, ' ');
+        std::fill(bar.begin() + from, bar.begin() + std::min(to, BAR_WIDTH), '#');
+
+        std::cout << "  " << std::left << std::setw(8) << p.thread
+                  << std::setw(20) << p.name << std::right
+                  << std::fixed << std::setprecision(1)
+                  << std::setw(9) << begin << " -" << std::setw(9) << end << " ms  |"
+                  << bar << "|\n";
+        std::cout.unsetf(std::ios::floatfield);
+        std::cout << std::setprecision(6);
+    }
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <chrono>
+
+// Wall-clock log of the startup phases, recorded from any thread, so the
+// overlap between mesh import and Vulkan setup can be seen at a glance.
+// Times are relative to the first phase recorded.
+
+// Records one phase from construction to destruction (or end()).
+class StartupPhase {
+public:
+    StartupPhase(const char* name, const char* thread = "main");
+    ~StartupPhase() { end(); }
+
+    StartupPhase(const StartupPhase&)            = delete;
+    StartupPhase& operator=(const StartupPhase&) = delete;
+
+    void end();
+
+private:
+    const char* m_name;
+    const char* m_thread;
+    std::chrono::steady_clock::time_point m_start;
+    bool m_open = true;
+};
+
+// Prints every phase recorded so far, one row per phase with a bar chart of
+// when it ran, then clears the log.
+void printStartupTimeline();
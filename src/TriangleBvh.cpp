@@ -0,0 +1,498 @@
+#include "TriangleBvh.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define BVH_USE_SSE 1
+#endif
+
+static constexpr int      SAH_BINS           = 16;
+static constexpr uint32_t MAX_LEAF_TRIANGLES = 8;
+static constexpr float    TRAVERSAL_COST     = 2.0f;   // two box tests, relative to one triangle test
+
+// nodes at least this large are binned in parallel while the top is split
+static constexpr uint32_t PARALLEL_NODE      = 1u << 16;
+// the top stops splitting once it has this many subtrees per worker
+static constexpr size_t   SUBTREES_PER_WORKER = 4;
+// ... or every remaining subtree is smaller than this
+static constexpr uint32_t MIN_SUBTREE        = 1u << 12;
+
+static constexpr float INF = std::numeric_limits<float>::infinity();
+
+namespace {
+
+struct Aabb {
+    glm::vec3 lo{ INF };
+    glm::vec3 hi{ -INF };
+
+    void grow(const glm::vec3& p) { lo = glm::min(lo, p); hi = glm::max(hi, p); }
+    void grow(const Aabb& b)      { lo = glm::min(lo, b.lo); hi = glm::max(hi, b.hi); }
+
+    float area() const
+    {
+        const glm::vec3 d = hi - lo;
+        return (d.x < 0.0f) ? 0.0f : d.x * d.y + d.y * d.z + d.z * d.x;
+    }
+    glm::vec3 center() const { return 0.5f * (lo + hi); }
+};
+
+struct Bin {
+    Aabb     bounds;
+    uint32_t count = 0;
+};
+
+struct BuildContext {
+    const std::vector<Aabb>& triBounds;
+    std::vector<uint32_t>&   ids;
+};
+
+struct Subtree {
+    uint32_t node;    // slot in the top-level array
+    uint32_t begin;
+    uint32_t end;
+};
+
+} // namespace
+
+// ----------------------------------------
+// SAH split
+// ----------------------------------------
+
+static void rangeBounds(const BuildContext& ctx, uint32_t begin, uint32_t end,
+                        Aabb& bounds, Aabb& centroids, bool parallel)
+{
+    auto accumulate = [&](size_t b, size_t e, Aabb& out, Aabb& outCentroids) {
+        for (size_t i = b; i < e; ++i) {
+            const Aabb& tb = ctx.triBounds[ctx.ids[i]];
+            out.grow(tb);
+            outCentroids.grow(tb.center());
+        }
+    };
+    if (!parallel) {
+        accumulate(begin, end, bounds, centroids);
+        return;
+    }
+
+    const size_t count = end - begin;
+    std::vector<Aabb> partBounds(parallelRangeCount(count, PARALLEL_NODE / 4));
+    std::vector<Aabb> partCentroids(partBounds.size());
+    parallelRanges(count, PARALLEL_NODE / 4, [&](size_t b, size_t e, size_t r) {
+        accumulate(begin + b, begin + e, partBounds[r], partCentroids[r]);
+    });
+    for (size_t r = 0; r < partBounds.size(); ++r) {
+        bounds.grow(partBounds[r]);
+        centroids.grow(partCentroids[r]);
+    }
+}
+
+// Fills node's bounds and either makes it a leaf (returns end) or
+// partitions ids[begin, end) and returns the first index of the right half.
+static uint32_t splitNode(const BuildContext& ctx, BvhNode& node, uint32_t begin, uint32_t end,
+                          bool parallel)
+{
+    Aabb bounds, centroids;
+    rangeBounds(ctx, begin, end, bounds, centroids, parallel);
+    for (int k = 0; k < 3; ++k) {
+        node.boundsMin[k] = bounds.lo[k];
+        node.boundsMax[k] = bounds.hi[k];
+    }
+
+    const uint32_t count = end - begin;
+    auto makeLeaf = [&]() {
+        node.first = begin;
+        node.count = count;
+        return end;
+    };
+    if (count <= 1) return makeLeaf();
+
+    // best bin boundary over all three axes
+    float bestCost  = INF;
+    int   bestAxis  = -1;
+    int   bestSplit = 0;
+    for (int axis = 0; axis < 3; ++axis) {
+        const float lo     = centroids.lo[axis];
+        const float extent = centroids.hi[axis] - lo;
+        if (!(extent > 0.0f)) continue;
+        const float scale = SAH_BINS / extent;
+
+        auto binOf = [&](uint32_t id) {
+            return std::min(SAH_BINS - 1, int((ctx.triBounds[id].center()[axis] - lo) * scale));
+        };
+
+        Bin bins[SAH_BINS];
+        if (parallel) {
+            std::vector<std::array<Bin, SAH_BINS>> part(parallelRangeCount(count, PARALLEL_NODE / 4));
+            parallelRanges(count, PARALLEL_NODE / 4, [&](size_t b, size_t e, size_t r) {
+                for (size_t i = begin + b; i < begin + e; ++i) {
+                    Bin& bin = part[r][binOf(ctx.ids[i])];
+                    bin.bounds.grow(ctx.triBounds[ctx.ids[i]]);
+                    ++bin.count;
+                }
+            });
+            for (const auto& p : part)
+                for (int b = 0; b < SAH_BINS; ++b) {
+                    bins[b].bounds.grow(p[b].bounds);
+                    bins[b].count += p[b].count;
+                }
+        } else {
+            for (uint32_t i = begin; i < end; ++i) {
+                Bin& bin = bins[binOf(ctx.ids[i])];
+                bin.bounds.grow(ctx.triBounds[ctx.ids[i]]);
+                ++bin.count;
+            }
+        }
+
+        // sweep from the right, then from the left
+        float    rightArea[SAH_BINS];
+        uint32_t rightCount[SAH_BINS];
+        Aabb     acc;
+        uint32_t n = 0;
+        for (int b = SAH_BINS - 1; b > 0; --b) {
+            acc.grow(bins[b].bounds);
+            n += bins[b].count;
+            rightArea[b]  = acc.area();
+            rightCount[b] = n;
+        }
+        acc = Aabb{};
+        n   = 0;
+        for (int b = 0; b < SAH_BINS - 1; ++b) {
+            acc.grow(bins[b].bounds);
+            n += bins[b].count;
+            const float cost = acc.area() * n + rightArea[b + 1] * rightCount[b + 1];
+            if (n > 0 && rightCount[b + 1] > 0 && cost < bestCost) {
+                bestCost  = cost;
+                bestAxis  = axis;
+                bestSplit = b + 1;
+            }
+        }
+    }
+
+    const float parentArea = bounds.area();
+    const float splitCost  = parentArea > 0.0f ? TRAVERSAL_COST + bestCost / parentArea : INF;
+    if (count <= MAX_LEAF_TRIANGLES && splitCost >= float(count)) return makeLeaf();
+
+    uint32_t mid;
+    if (bestAxis < 0) {
+        // all centroids coincide: halve to keep leaves small
+        if (count <= MAX_LEAF_TRIANGLES) return makeLeaf();
+        mid = begin + count / 2;
+    } else {
+        const float lo    = centroids.lo[bestAxis];
+        const float scale = SAH_BINS / (centroids.hi[bestAxis] - lo);
+        auto* split = std::partition(ctx.ids.data() + begin, ctx.ids.data() + end, [&](uint32_t id) {
+            return std::min(SAH_BINS - 1, int((ctx.triBounds[id].center()[bestAxis] - lo) * scale)) < bestSplit;
+        });
+        mid = static_cast<uint32_t>(split - ctx.ids.data());
+        if (mid == begin || mid == end) mid = begin + count / 2;
+    }
+    node.count = 0;
+    return mid;
+}
+
+// Serial build of the subtree below nodes[index].
+static void buildRecursive(const BuildContext& ctx, std::vector<BvhNode>& nodes, uint32_t index,
+                           uint32_t begin, uint32_t end)
+{
+    const uint32_t mid = splitNode(ctx, nodes[index], begin, end, false);
+    if (mid == end) return;
+
+    const uint32_t left = static_cast<uint32_t>(nodes.size());
+    nodes[index].first = left;
+    nodes.resize(nodes.size() + 2);
+    buildRecursive(ctx, nodes, left, begin, mid);
+    buildRecursive(ctx, nodes, left + 1, mid, end);
+}
+
+// ----------------------------------------
+// build
+// ----------------------------------------
+
+BvhStats TriangleBvh::build(const Vertex* vertices, size_t vertexCount,
+                            const uint32_t* indices, const std::vector<SubMesh>& submeshes)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    clear();
+    BvhStats stats;
+
+    m_positions.resize(vertexCount);
+    parallelRanges(vertexCount, 1u << 16, [&](size_t begin, size_t end, size_t) {
+        for (size_t i = begin; i < end; ++i) m_positions[i] = vertices[i].pos;
+    });
+
+    // triangles as global vertex indices
+    std::vector<uint32_t> tris;
+    size_t triCount = 0;
+    for (const SubMesh& s : submeshes) triCount += s.indexCount / 3;
+    tris.reserve(3 * triCount);
+    for (const SubMesh& s : submeshes)
+        for (uint32_t i = 0; i < s.indexCount / 3 * 3; ++i)
+            tris.push_back(indices[s.firstIndex + i] + s.baseVertex);
+    if (triCount == 0 || triCount > std::numeric_limits<uint32_t>::max() / 3) return stats;
+
+    std::vector<Aabb>     triBounds(triCount);
+    std::vector<uint32_t> ids(triCount);
+    parallelRanges(triCount, 1u << 15, [&](size_t begin, size_t end, size_t) {
+        for (size_t t = begin; t < end; ++t) {
+            Aabb b;
+            for (int k = 0; k < 3; ++k) b.grow(m_positions[tris[3 * t + k]]);
+            triBounds[t] = b;
+            ids[t]       = static_cast<uint32_t>(t);
+        }
+    });
+
+    const BuildContext ctx{ triBounds, ids };
+
+    // top: split the largest subtree until there is enough parallel work
+    m_nodes.reserve(2 * (triCount / 2 + 1));
+    m_nodes.resize(1);
+    std::vector<Subtree> pending{ { 0, 0, static_cast<uint32_t>(triCount) } };
+    const size_t wanted = SUBTREES_PER_WORKER * workerCount();
+    while (pending.size() < wanted) {
+        auto largest = std::max_element(pending.begin(), pending.end(), [](const Subtree& a, const Subtree& b) {
+            return a.end - a.begin < b.end - b.begin;
+        });
+        if (largest->end - largest->begin < MIN_SUBTREE) break;
+
+        const Subtree  s   = *largest;
+        const uint32_t mid = splitNode(ctx, m_nodes[s.node], s.begin, s.end,
+                                       s.end - s.begin >= PARALLEL_NODE);
+        pending.erase(largest);
+        if (mid == s.end) continue;   // became a leaf
+
+        const uint32_t left = static_cast<uint32_t>(m_nodes.size());
+        m_nodes[s.node].first = left;
+        m_nodes.resize(m_nodes.size() + 2);
+        pending.push_back({ left, s.begin, mid });
+        pending.push_back({ left + 1, mid, s.end });
+    }
+
+    // subtrees in parallel, each into its own array (local root at 0)
+    std::vector<std::vector<BvhNode>> local(pending.size());
+    parallelTasks(pending.size(), [&](size_t i) {
+        const uint32_t count = pending[i].end - pending[i].begin;
+        local[i].reserve(2 * (count / 2 + 1));
+        local[i].resize(1);
+        buildRecursive(ctx, local[i], 0, pending[i].begin, pending[i].end);
+    });
+
+    // stitch: local node j > 0 lands at base + j - 1, the root in its slot
+    std::vector<size_t> base(pending.size());
+    size_t total = m_nodes.size();
+    for (size_t i = 0; i < pending.size(); ++i) {
+        base[i] = total;
+        total  += local[i].size() - 1;
+    }
+    m_nodes.resize(total);
+    parallelTasks(pending.size(), [&](size_t i) {
+        const uint32_t shift = static_cast<uint32_t>(base[i] - 1);
+        for (size_t j = 0; j < local[i].size(); ++j) {
+            BvhNode n = local[i][j];
+            if (n.count == 0) n.first += shift;
+            m_nodes[j == 0 ? pending[i].node : base[i] + j - 1] = n;
+        }
+    });
+
+    // leaf order
+    m_triangles.resize(3 * triCount);
+    parallelRanges(triCount, 1u << 16, [&](size_t begin, size_t end, size_t) {
+        for (size_t i = begin; i < end; ++i)
+            for (int k = 0; k < 3; ++k) m_triangles[3 * i + k] = tris[3 * size_t(ids[i]) + k];
+    });
+    m_nodes.shrink_to_fit();
+
+    stats.triangles    = triCount;
+    stats.nodes        = m_nodes.size();
+    stats.bytes        = m_nodes.size() * sizeof(BvhNode) + m_triangles.size() * sizeof(uint32_t) +
+                         m_positions.size() * sizeof(glm::vec3);
+    stats.milliseconds = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - t0).count();
+    return stats;
+}
+
+void TriangleBvh::clear()
+{
+    std::vector<BvhNode>().swap(m_nodes);
+    std::vector<uint32_t>().swap(m_triangles);
+    std::vector<glm::vec3>().swap(m_positions);
+}
+
+void TriangleBvh::triangle(uint32_t t, glm::vec3& a, glm::vec3& b, glm::vec3& c) const
+{
+    a = m_positions[m_triangles[3 * size_t(t)]];
+    b = m_positions[m_triangles[3 * size_t(t) + 1]];
+    c = m_positions[m_triangles[3 * size_t(t) + 2]];
+}
+
+// ----------------------------------------
+// queries
+// ----------------------------------------
+
+namespace {
+
+// Ray in the form the slab test wants; the SSE path keeps it in registers.
+struct Ray {
+    glm::vec3 origin;
+    glm::vec3 invDir;
+#ifdef BVH_USE_SSE
+    __m128 o;
+    __m128 inv;
+#endif
+};
+
+} // namespace
+
+// Entry distance into the node's box, or INF if the ray misses it before tMax.
+static inline float rayBox(const BvhNode& n, const Ray& r, float tMax)
+{
+#ifdef BVH_USE_SSE
+    // lane 3 holds first / count and is never read back
+    const __m128 t1   = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(n.boundsMin), r.o), r.inv);
+    const __m128 t2   = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(n.boundsMax), r.o), r.inv);
+    const __m128 tmin = _mm_min_ps(t1, t2);
+    const __m128 tmax = _mm_max_ps(t1, t2);
+    const __m128 nearV = _mm_max_ss(_mm_max_ss(tmin, _mm_shuffle_ps(tmin, tmin, _MM_SHUFFLE(1, 1, 1, 1))),
+                                    _mm_shuffle_ps(tmin, tmin, _MM_SHUFFLE(2, 2, 2, 2)));
+    const __m128 farV  = _mm_min_ss(_mm_min_ss(tmax, _mm_shuffle_ps(tmax, tmax, _MM_SHUFFLE(1, 1, 1, 1))),
+                                    _mm_shuffle_ps(tmax, tmax, _MM_SHUFFLE(2, 2, 2, 2)));
+    const float tNear = std::max(_mm_cvtss_f32(nearV), 0.0f);
+    const float tFar  = std::min(_mm_cvtss_f32(farV), tMax);
+#else
+    float tNear = 0.0f, tFar = tMax;
+    for (int k = 0; k < 3; ++k) {
+        const float t1 = (n.boundsMin[k] - r.origin[k]) * r.invDir[k];
+        const float t2 = (n.boundsMax[k] - r.origin[k]) * r.invDir[k];
+        tNear = std::max(tNear, std::min(t1, t2));
+        tFar  = std::min(tFar, std::max(t1, t2));
+    }
+#endif
+    return tNear <= tFar ? tNear : INF;
+}
+
+// Möller-Trumbore, both sides; t in (0, tMax).
+static inline bool rayTriangle(const glm::vec3& o, const glm::vec3& d, const glm::vec3& a,
+                               const glm::vec3& b, const glm::vec3& c, float tMax, float& t)
+{
+    const glm::vec3 e1 = b - a, e2 = c - a;
+    const glm::vec3 p   = glm::cross(d, e2);
+    const float     det = glm::dot(e1, p);
+    if (std::fabs(det) < 1e-20f) return false;
+    const float     inv = 1.0f / det;
+    const glm::vec3 s   = o - a;
+    const float     u   = glm::dot(s, p) * inv;
+    if (u < 0.0f || u > 1.0f) return false;
+    const glm::vec3 q = glm::cross(s, e1);
+    const float     v = glm::dot(d, q) * inv;
+    if (v < 0.0f || u + v > 1.0f) return false;
+    t = glm::dot(e2, q) * inv;
+    return t > 0.0f && t < tMax;
+}
+
+bool TriangleBvh::intersectRay(const glm::vec3& origin, const glm::vec3& direction,
+                               float tMax, RayHit& hit) const
+{
+    if (m_nodes.empty()) return false;
+
+    Ray r;
+    r.origin = origin;
+    for (int k = 0; k < 3; ++k)
+        r.invDir[k] = direction[k] != 0.0f ? 1.0f / direction[k] : INF;
+#ifdef BVH_USE_SSE
+    r.o   = _mm_setr_ps(origin.x, origin.y, origin.z, 0.0f);
+    r.inv = _mm_setr_ps(r.invDir.x, r.invDir.y, r.invDir.z, 0.0f);
+#endif
+
+    // SAH trees have no depth bound, so the stack grows as needed
+    bool  found = false;
+    float best  = tMax;
+    if (rayBox(m_nodes[0], r, best) == INF) return false;
+    std::vector<uint32_t> stack;
+    stack.reserve(64);
+    stack.push_back(0);
+
+    while (!stack.empty()) {
+        const BvhNode& n = m_nodes[stack.back()];
+        stack.pop_back();
+        if (n.count > 0) {
+            for (uint32_t t = n.first; t < n.first + n.count; ++t) {
+                glm::vec3 a, b, c;
+                triangle(t, a, b, c);
+                float d;
+                if (rayTriangle(origin, direction, a, b, c, best, d)) {
+                    best         = d;
+                    hit.triangle = t;
+                    found        = true;
+                }
+            }
+            continue;
+        }
+
+        // nearer child on top of the stack
+        uint32_t near = n.first, far = n.first + 1;
+        float    tNear = rayBox(m_nodes[near], r, best);
+        float    tFar  = rayBox(m_nodes[far], r, best);
+        if (tFar < tNear) {
+            std::swap(near, far);
+            std::swap(tNear, tFar);
+        }
+        if (tFar != INF)  stack.push_back(far);
+        if (tNear != INF) stack.push_back(near);
+    }
+
+    if (found) {
+        hit.t     = best;
+        hit.point = origin + best * direction;
+    }
+    return found;
+}
+
+void TriangleBvh::queryBox(const glm::vec3& boxMin, const glm::vec3& boxMax,
+                           std::vector<uint32_t>& triangles) const
+{
+    if (m_nodes.empty()) return;
+
+    auto overlaps = [&](const glm::vec3& lo, const glm::vec3& hi) {
+        return lo.x <= boxMax.x && hi.x >= boxMin.x &&
+               lo.y <= boxMax.y && hi.y >= boxMin.y &&
+               lo.z <= boxMax.z && hi.z >= boxMin.z;
+    };
+#ifdef BVH_USE_SSE
+    const __m128 qMin = _mm_setr_ps(boxMin.x, boxMin.y, boxMin.z, 0.0f);
+    const __m128 qMax = _mm_setr_ps(boxMax.x, boxMax.y, boxMax.z, 0.0f);
+#endif
+    auto overlapsNode = [&](const BvhNode& n) {
+#ifdef BVH_USE_SSE
+        // lane 3 holds first / count and is masked off
+        const __m128 inside = _mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(n.boundsMin), qMax),
+                                         _mm_cmpge_ps(_mm_loadu_ps(n.boundsMax), qMin));
+        return (_mm_movemask_ps(inside) & 7) == 7;
+#else
+        return overlaps(glm::vec3(n.boundsMin[0], n.boundsMin[1], n.boundsMin[2]),
+                        glm::vec3(n.boundsMax[0], n.boundsMax[1], n.boundsMax[2]));
+#endif
+    };
+
+    std::vector<uint32_t> stack{ 0 };
+    while (!stack.empty()) {
+        const BvhNode& n = m_nodes[stack.back()];
+        stack.pop_back();
+        if (!overlapsNode(n)) continue;
+
+        if (n.count == 0) {
+            stack.push_back(n.first);
+            stack.push_back(n.first + 1);
+            continue;
+        }
+        for (uint32_t t = n.first; t < n.first + n.count; ++t) {
+            glm::vec3 a, b, c;
+            triangle(t, a, b, c);
+            if (overlaps(glm::min(a, glm::min(b, c)), glm::max(a, glm::max(b, c))))
+                triangles.push_back(t);
+        }
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "MeshLoader.h"
+
+// Bounding volume hierarchy over the level-0 triangles of a mesh, for ray
+// picking and box queries on the CPU.
+//
+// Built top-down with binned SAH splits. The upper levels are split on the
+// calling thread (binning large nodes in parallel), then the subtrees below
+// are built in parallel and stitched into one array. Nodes are 32 bytes
+// with both children stored next to each other; leaf triangles are stored
+// contiguously in leaf order, as vertex indices into a private copy of the
+// positions, so the source mesh can be freed after build().
+
+struct BvhNode {
+    float    boundsMin[3];
+    uint32_t first;       // leaf: first triangle; inner: left child (right = first + 1)
+    float    boundsMax[3];
+    uint32_t count;       // triangles in a leaf, 0 for inner nodes
+};
+static_assert(sizeof(BvhNode) == 32, "BvhNode should stay half a cache line");
+
+struct RayHit {
+    float     t        = 0.0f;   // along the (unnormalized) ray direction
+    glm::vec3 point{ 0.0f };
+    uint32_t  triangle = 0;      // position in the BVH's triangle order
+};
+
+struct BvhStats {
+    size_t triangles    = 0;
+    size_t nodes        = 0;
+    size_t bytes        = 0;
+    double milliseconds = 0.0;
+};
+
+class TriangleBvh {
+public:
+    // Indexes the triangles of submeshes (indices + baseVertex into vertices).
+    BvhStats build(const Vertex* vertices, size_t vertexCount,
+                   const uint32_t* indices, const std::vector<SubMesh>& submeshes);
+    void     clear();
+    bool     empty() const { return m_nodes.empty(); }
+
+    // Closest hit with t in (0, tMax]; positions are in mesh units.
+    bool intersectRay(const glm::vec3& origin, const glm::vec3& direction,
+                      float tMax, RayHit& hit) const;
+
+    // Appends every triangle whose bounds overlap the box.
+    void queryBox(const glm::vec3& boxMin, const glm::vec3& boxMax,
+                  std::vector<uint32_t>& triangles) const;
+
+    // Corners of a triangle returned by the queries above.
+    void triangle(uint32_t t, glm::vec3& a, glm::vec3& b, glm::vec3& c) const;
+
+private:
+    std::vector<BvhNode>   m_nodes;
+    std::vector<uint32_t>  m_triangles;   // 3 vertex indices per triangle, leaf order
+    std::vector<glm::vec3> m_positions;
+};
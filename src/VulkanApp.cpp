@@ -1,5 +1,6 @@
 #include "VulkanApp.h"
 
+#include <array>
 #include <stdexcept>
 #include <iostream>
 #include <cstring>
@@ -7,7 +8,11 @@
 #include <set>
 #include <limits>
 #include <algorithm>
+#include <cmath>
 #include"config.h"
+#include "MemoryUsage.h"
+#include "Parallel.h"
+#include "StartupTimeline.h"
 
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
@@ -16,16 +21,59 @@ static const std::vector<const char*> DEVICE_EXTENSIONS = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME
 };
 
-VulkanApp::VulkanApp(const std::vector<VulkanVertex>& vertices,
-                     const std::vector<uint32_t>& indices)
-    : m_vertices(vertices),
-      m_indices(indices)
+static constexpr float CAMERA_FOV_DEGREES = 60.0f;
+
+VulkanApp::VulkanApp(MeshData&& mesh, const glm::mat4& model)
+{
+    adoptMesh(std::move(mesh), model);
+    m_compactVertices = Config::COMPACT_VERTICES;
+}
+
+VulkanApp::VulkanApp(std::future<ImportedMesh> pending)
+    : m_pendingMesh(std::move(pending))
+{
+    m_compactVertices = Config::COMPACT_VERTICES;
+}
+
+void VulkanApp::adoptMesh(MeshData&& mesh, const glm::mat4& model)
+{
+    m_mesh       = std::move(mesh);
+    m_model      = model;
+    m_submeshes  = std::move(m_mesh.submeshes);
+    m_clusters   = std::move(m_mesh.clusters);
+    m_lods       = std::move(m_mesh.lods);
+    m_lodRanges  = std::move(m_mesh.lodRanges);
+    m_indexCount = static_cast<uint32_t>(m_mesh.indices.size());
+}
+
+VulkanApp::VulkanApp(MeshCacheFile&& cache)
+    : m_cache(std::move(cache))
 {
-    m_indexCount = static_cast<uint32_t>(m_indices.size());
+    m_indexCount      = static_cast<uint32_t>(m_cache.indexCount());
+    m_compactVertices = Config::COMPACT_VERTICES;
+    m_submeshes.assign(m_cache.submeshes(), m_cache.submeshes() + m_cache.submeshCount());
+    m_clusters.assign(m_cache.clusters(), m_cache.clusters() + m_cache.clusterCount());
+    m_lods.assign(m_cache.lods(), m_cache.lods() + m_cache.lodCount());
+    m_lodRanges.assign(m_cache.lodRanges(), m_cache.lodRanges() + m_cache.lodRangeCount());
+
+    // positions were cached in file units; the settings hash guarantees it
+    if (Config::NORMALIZE_IN_MODEL_MATRIX)
+        m_model = normalizationMatrix(m_cache.bounds());
+}
+
+VulkanApp::VulkanApp(std::unique_ptr<MeshStream> stream)
+    : m_stream(std::move(stream))
+{
+    // frame the sampled bounds until the exact ones are known
+    m_model       = normalizationMatrix(m_stream->previewBounds());
+    m_indexCount  = 0;
+    m_streamStart = std::chrono::steady_clock::now();
 }
 
 void VulkanApp::run() {
+    StartupPhase window("window");
     initWindow();
+    window.end();
     initVulkan();
     mainLoop();
     cleanup();
@@ -54,38 +102,105 @@ void VulkanApp::initWindow() {
         }
     );
 
+    glfwSetKeyCallback(m_window,
+        [](GLFWwindow* window, int key, int /*scancode*/, int action, int /*mods*/)
+        {
+            auto app = reinterpret_cast<VulkanApp*>(glfwGetWindowUserPointer(window));
+            if (app) app->onKey(key, action);
+        }
+    );
+
+    // exposed, uncovered or resized: the last image may be gone
+    glfwSetWindowRefreshCallback(m_window,
+        [](GLFWwindow* window)
+        {
+            auto app = reinterpret_cast<VulkanApp*>(glfwGetWindowUserPointer(window));
+            if (app) app->m_redrawRequested = true;
+        }
+    );
+
 }
 
 // main loop / cleanup --------------------------------------
 
+// With Config::ON_DEMAND_RENDERING a frame is drawn only when the view
+// state changed; the loop keeps polling while frames keep changing (drags,
+// held keys) and sleeps in glfwWaitEvents once one pass changes nothing, so
+// input still reaches the screen on the next frame. Streaming loads draw
+// every frame until they finish.
 void VulkanApp::mainLoop() {
+    bool changing = true;
     while (!glfwWindowShouldClose(m_window)) {
-        glfwPollEvents();
+        if (Config::ON_DEMAND_RENDERING && !changing && !m_stream) glfwWaitEvents();
+        else glfwPollEvents();
+
         updateCameraFromInput();
+        uploadStreamedBatches();
+
+        const ViewState state = currentViewState();
+        changing = !Config::ON_DEMAND_RENDERING || m_stream || m_redrawRequested ||
+                   !m_acquireBarriers.empty() || !(state == m_drawnState);
+
+        // nothing to present into while minimized
+        if (!changing || state.width == 0 || state.height == 0) {
+            changing = false;
+            continue;
+        }
+
         drawFrame();
+        m_drawnState      = currentViewState();   // the frame may publish streamed indices
+        m_redrawRequested = false;
     }
 
     vkDeviceWaitIdle(m_device);
 }
 
 void VulkanApp::cleanup() {
+    // window closed before the stream finished
+    if (m_stream) m_stream->stop();
+    m_stagingRing.destroy();
+    if (m_uploadTimeline != VK_NULL_HANDLE) vkDestroySemaphore(m_device, m_uploadTimeline, nullptr);
+
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
         vkDestroySemaphore(m_device, m_renderFinishedSemaphores[i], nullptr);
         vkDestroySemaphore(m_device, m_imageAvailableSemaphores[i], nullptr);
         vkDestroyFence(m_device, m_inFlightFences[i], nullptr);
     }
 
-    vkDestroyBuffer(m_device, m_indexBuffer, nullptr);
-    vkFreeMemory(m_device, m_indexBufferMemory, nullptr);
-    vkDestroyBuffer(m_device, m_vertexBuffer, nullptr);
-    vkFreeMemory(m_device, m_vertexBufferMemory, nullptr);
+    if (m_indirectBuffer != VK_NULL_HANDLE) {
+        destroyBuffer(m_indirectBuffer, m_indirectBufferMemory);
+    }
+    for (size_t i = 0; i < m_frameDrawBuffers.size(); i++) {
+        destroyBuffer(m_frameDrawBuffers[i], m_frameDrawMemory[i]);
+    }
+    for (size_t i = 0; i < m_frameUniformBuffers.size(); i++) {
+        destroyBuffer(m_frameUniformBuffers[i], m_frameUniformMemory[i]);
+    }
+    vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
+    if (m_framesDrawn > 0) {
+        std::cout << "Static draws recorded " << m_staticDrawRecords << " times in "
+                  << m_framesDrawn << " frames"
+                  << (Config::ON_DEMAND_RENDERING ? " (drawn on demand)" : "") << "\n";
+    }
+    if (m_cullFrames > 0) {
+        std::cout << "Cluster culling: " << double(m_clustersVisible) / m_cullFrames
+                  << " of " << m_clusters.size() << " clusters drawn per frame on average\n";
+    }
+    destroyBuffer(m_indexBuffer, m_indexBufferMemory);
+    destroyBuffer(m_vertexBuffer, m_vertexBufferMemory);
 
     for (auto fb : m_swapchainFramebuffers) {
         vkDestroyFramebuffer(m_device, fb, nullptr);
     }
 
-    vkDestroyPipeline(m_device, m_graphicsPipeline, nullptr);
+    for (const auto& variant : m_pipelines) {
+        vkDestroyPipeline(m_device, variant.second, nullptr);
+    }
+    m_pipelines.clear();
+    m_pipelineCache.save();
+    m_pipelineCache.destroy();
     vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr);
+    vkDestroyDescriptorSetLayout(m_device, m_descriptorSetLayout, nullptr);
     vkDestroyRenderPass(m_device, m_renderPass, nullptr);
 
     for (auto iv : m_swapchainImageViews) {
@@ -93,7 +208,11 @@ void VulkanApp::cleanup() {
     }
 
     vkDestroySwapchainKHR(m_device, m_swapchain, nullptr);
+    for (auto pool : m_framePools) {
+        vkDestroyCommandPool(m_device, pool, nullptr);
+    }
     vkDestroyCommandPool(m_device, m_commandPool, nullptr);
+    m_allocator.destroy();
     vkDestroyDevice(m_device, nullptr);
 
     vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
@@ -114,6 +233,94 @@ void VulkanApp::onScroll(double /*xoffset*/, double yoffset) {
     if (m_distance > 10.0f) m_distance = 10.0f;
 }
 
+// C toggles backface culling, 1-3 pick the X-ray preset; both only swap
+// which prebuilt pipeline the next frame binds.
+void VulkanApp::onKey(int key, int action) {
+    if (action != GLFW_PRESS) return;
+
+    const int presetCount = static_cast<int>(std::size(Config::XRAY_PRESETS));
+    if (key == GLFW_KEY_C) {
+        selectPipeline(!m_backfaceCulling, m_xrayPreset);
+    } else if (key >= GLFW_KEY_1 && key < GLFW_KEY_1 + presetCount) {
+        selectPipeline(m_backfaceCulling, static_cast<uint32_t>(key - GLFW_KEY_1));
+    }
+}
+
+VulkanApp::ViewState VulkanApp::currentViewState() const {
+    ViewState v;
+    v.yaw        = m_yaw;
+    v.pitch      = m_pitch;
+    v.distance   = m_distance;
+    v.pivot      = m_pivot;
+    v.orbiting   = m_mousePressed;
+    glfwGetFramebufferSize(m_window, &v.width, &v.height);
+    v.pipeline   = m_graphicsPipeline;
+    v.indexCount = m_indexCount;
+    v.model      = m_model;
+    return v;
+}
+
+glm::vec3 VulkanApp::cameraPosition() const {
+    float cp = cosf(m_pitch);
+    float sp = sinf(m_pitch);
+    float cy = cosf(m_yaw);
+    float sy = sinf(m_yaw);
+
+    return m_pivot + glm::vec3(
+        m_distance * cp * sy,
+        m_distance * sp,
+        m_distance * cp * cy
+    );
+}
+
+glm::mat4 VulkanApp::viewMatrix() const {
+    return glm::lookAt(
+        cameraPosition(),
+        m_pivot,
+        glm::vec3(0.0f, 1.0f, 0.0f)
+    );
+}
+
+glm::mat4 VulkanApp::projectionMatrix() const {
+    glm::mat4 proj = glm::perspective(
+        glm::radians(CAMERA_FOV_DEGREES),
+        float(m_swapchainExtent.width) / float(m_swapchainExtent.height),
+        0.01f,
+        10.0f
+    );
+    proj[1][1] *= -1.0f; // Vulkan NDC flip
+    return proj;
+}
+
+// Moves the orbit pivot to the surface under the cursor, or back to the
+// mesh center when the cursor is over the background.
+void VulkanApp::pickPivot(double cursorX, double cursorY) {
+    if (m_bvh.empty()) return;
+
+    int width, height;
+    glfwGetWindowSize(m_window, &width, &height);
+    if (width <= 0 || height <= 0) return;
+
+    // cursor ray in mesh units: from the eye through the far plane point
+    const glm::mat4 toMesh  = glm::inverse(projectionMatrix() * viewMatrix() * m_clusterModel);
+    const float     ndcX    = float(2.0 * cursorX / width - 1.0);
+    const float     ndcY    = float(2.0 * cursorY / height - 1.0);
+    const glm::vec4 farH    = toMesh * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+    const glm::vec4 eyeH    = glm::inverse(m_clusterModel) * glm::vec4(cameraPosition(), 1.0f);
+    const glm::vec3 eye     = glm::vec3(eyeH.x, eyeH.y, eyeH.z) / eyeH.w;
+    const glm::vec3 farPt   = glm::vec3(farH.x, farH.y, farH.z) / farH.w;
+
+    RayHit hit;
+    if (m_bvh.intersectRay(eye, farPt - eye, std::numeric_limits<float>::max(), hit)) {
+        const glm::vec4 p = m_clusterModel * glm::vec4(hit.point, 1.0f);
+        m_pivot = glm::vec3(p.x, p.y, p.z);
+        std::cout << "Pivot: " << m_pivot.x << ", " << m_pivot.y << ", " << m_pivot.z << "\n";
+    } else {
+        m_pivot = glm::vec3(0.0f);
+        std::cout << "Pivot: mesh center\n";
+    }
+}
+
 void VulkanApp::updateCameraFromInput() {
     double x, y;
     glfwGetCursorPos(m_window, &x, &y);
@@ -146,6 +353,11 @@ void VulkanApp::updateCameraFromInput() {
         m_mousePressed = false;
     }
 
+    // --- RIGHT CLICK: SNAP PIVOT TO THE SURFACE ---
+    int right = glfwGetMouseButton(m_window, GLFW_MOUSE_BUTTON_RIGHT);
+    if (right == GLFW_PRESS && !m_rightPressed) pickPivot(x, y);
+    m_rightPressed = right == GLFW_PRESS;
+
     // extra keyboard zoom (optional)
     if (glfwGetKey(m_window, GLFW_KEY_W) == GLFW_PRESS) {
         m_distance -= 0.05f;
@@ -163,20 +375,58 @@ void VulkanApp::updateCameraFromInput() {
 // initVulkan ------------------------------------------------
 
 void VulkanApp::initVulkan() {
+    StartupPhase device("instance / device");
     createInstance();
     createSurface();
     pickPhysicalDevice();
     createLogicalDevice();
+    m_allocator.init(m_physicalDevice, m_device, VkDeviceSize(Config::GPU_MEMORY_BLOCK_MB) << 20);
+    device.end();
+
+    StartupPhase swapchain("swapchain");
     createSwapchain();
     createImageViews();
     createRenderPass();
+    swapchain.end();
+
+    StartupPhase pipeline("pipeline");
     createGraphicsPipeline();
     createFramebuffers();
     createCommandPool();
+    pipeline.end();
+
+    // everything above is independent of the mesh
+    if (m_pendingMesh.valid()) {
+        StartupPhase wait("wait for mesh");
+        ImportedMesh imported = m_pendingMesh.get();
+        adoptMesh(std::move(imported.mesh), imported.model);
+    }
+
+    StartupPhase upload("buffers");
     createVertexBuffer();
     createIndexBuffer();
+    createIndirectBuffer();
+    m_stagingRing.submit();
+    upload.end();
+
+    StartupPhase bvh("picking BVH");
+    buildPickingBvh();
+    bvh.end();
+
+    // the GPU buffers are the only copy from here on
+    m_cache.close();
+    m_mesh = MeshData{};
+    reportMemoryUsage("after GPU upload");
+    m_allocator.report("after GPU upload");
+    if (!m_stream) {
+        // streaming keeps the ring for its batches
+        releaseStagingRing("initial upload");
+    }
+    createFrameUniforms();
     createCommandBuffers();
     createSyncObjects();
+
+    printStartupTimeline();
 }
 
 // instance / surface / device ------------------------------
@@ -219,6 +469,16 @@ VulkanApp::QueueFamilyIndices VulkanApp::findQueueFamilies(VkPhysicalDevice devi
     std::vector<VkQueueFamilyProperties> props(count);
     vkGetPhysicalDeviceQueueFamilyProperties(device, &count, props.data());
 
+    // a family that can only copy maps to the DMA engines, which run next
+    // to rendering instead of queueing behind it
+    for (uint32_t f = 0; f < count; ++f) {
+        const VkQueueFlags flags = props[f].queueFlags;
+        if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+            indices.transferFamily = f;
+            break;
+        }
+    }
+
     int i = 0;
     for (const auto& q : props) {
         if (q.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
@@ -327,10 +587,28 @@ void VulkanApp::pickPhysicalDevice() {
 void VulkanApp::createLogicalDevice() {
     QueueFamilyIndices indices = findQueueFamilies(m_physicalDevice);
 
+    VkPhysicalDeviceProperties props{};
+    vkGetPhysicalDeviceProperties(m_physicalDevice, &props);
+
+    // timeline semaphores (core in 1.2) carry the transfer -> graphics handover
+    VkPhysicalDeviceVulkan12Features supported12{};
+    supported12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    VkPhysicalDeviceFeatures2 supported2{};
+    supported2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    if (props.apiVersion >= VK_API_VERSION_1_2) supported2.pNext = &supported12;
+    vkGetPhysicalDeviceFeatures2(m_physicalDevice, &supported2);
+    const VkPhysicalDeviceFeatures& supported = supported2.features;
+
+    m_graphicsFamily = indices.graphicsFamily.value();
+    const bool transferQueue = Config::USE_TRANSFER_QUEUE && indices.transferFamily.has_value() &&
+                               supported12.timelineSemaphore == VK_TRUE;
+    m_transferFamily = transferQueue ? indices.transferFamily.value() : m_graphicsFamily;
+
     std::vector<VkDeviceQueueCreateInfo> queueCIs;
     std::set<uint32_t> uniqueFamilies = {
         indices.graphicsFamily.value(),
-        indices.presentFamily.value()
+        indices.presentFamily.value(),
+        m_transferFamily
     };
 
     float queuePriority = 1.0f;
@@ -343,14 +621,34 @@ void VulkanApp::createLogicalDevice() {
         queueCIs.push_back(qci);
     }
 
+    // all submeshes go out in one indirect call when the device allows it;
+    // otherwise drawFrame() issues one indirect draw per command
+    m_multiDrawIndirect    = supported.multiDrawIndirect == VK_TRUE;
+    m_maxDrawIndirectCount = m_multiDrawIndirect ? std::max(1u, props.limits.maxDrawIndirectCount) : 1u;
+    // culled draws then take their count from the GPU buffer, so the
+    // recorded draw call never changes
+    m_drawIndirectCount    = m_multiDrawIndirect && supported12.drawIndirectCount == VK_TRUE;
+
     VkPhysicalDeviceFeatures features{};
     features.samplerAnisotropy = VK_FALSE;
+    features.multiDrawIndirect = m_multiDrawIndirect ? VK_TRUE : VK_FALSE;
+
+    VkPhysicalDeviceVulkan12Features features12{};
+    features12.sType             = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    features12.timelineSemaphore = transferQueue ? VK_TRUE : VK_FALSE;
+    features12.drawIndirectCount = m_drawIndirectCount ? VK_TRUE : VK_FALSE;
+
+    VkPhysicalDeviceFeatures2 features2{};
+    features2.sType    = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features2.pNext    = (transferQueue || m_drawIndirectCount) ? &features12 : nullptr;
+    features2.features = features;
 
     VkDeviceCreateInfo dci{};
     dci.sType                   = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    dci.pNext                   = &features2;
     dci.queueCreateInfoCount    = static_cast<uint32_t>(queueCIs.size());
     dci.pQueueCreateInfos       = queueCIs.data();
-    dci.pEnabledFeatures        = &features;
+    dci.pEnabledFeatures        = nullptr;
     dci.enabledExtensionCount   = static_cast<uint32_t>(DEVICE_EXTENSIONS.size());
     dci.ppEnabledExtensionNames = DEVICE_EXTENSIONS.data();
     dci.enabledLayerCount       = 0;
@@ -361,6 +659,15 @@ void VulkanApp::createLogicalDevice() {
 
     vkGetDeviceQueue(m_device, indices.graphicsFamily.value(), 0, &m_graphicsQueue);
     vkGetDeviceQueue(m_device, indices.presentFamily.value(), 0, &m_presentQueue);
+    vkGetDeviceQueue(m_device, m_transferFamily, 0, &m_transferQueue);
+
+    if (transferQueue) {
+        std::cout << "Uploads: dedicated transfer queue (family " << m_transferFamily << ")\n";
+    } else {
+        std::cout << "Uploads: graphics queue ("
+                  << (indices.transferFamily ? "no timeline semaphores" : "no transfer-only family")
+                  << ")\n";
+    }
 }
 
 // swapchain / image views ----------------------------------
@@ -521,17 +828,33 @@ VkShaderModule VulkanApp::createShaderModule(const std::vector<char>& code) {
 }
 
 void VulkanApp::createGraphicsPipeline() {
+    m_pipelineCache.init(m_physicalDevice, m_device, Config::PIPELINE_CACHE_PATH);
+
     auto vertCode = readFile("shaders/basic.vert.spv");
     auto fragCode = readFile("shaders/basic.frag.spv");
 
     VkShaderModule vertModule = createShaderModule(vertCode);
     VkShaderModule fragModule = createShaderModule(fragCode);
 
+    // constant_id 0 in basic.vert selects the CompactVertex decode
+    VkBool32 compact = m_compactVertices ? VK_TRUE : VK_FALSE;
+    VkSpecializationMapEntry specEntry{};
+    specEntry.constantID = 0;
+    specEntry.offset     = 0;
+    specEntry.size       = sizeof(VkBool32);
+
+    VkSpecializationInfo specInfo{};
+    specInfo.mapEntryCount = 1;
+    specInfo.pMapEntries   = &specEntry;
+    specInfo.dataSize      = sizeof(compact);
+    specInfo.pData         = &compact;
+
     VkPipelineShaderStageCreateInfo vertStage{};
     vertStage.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     vertStage.stage  = VK_SHADER_STAGE_VERTEX_BIT;
     vertStage.module = vertModule;
     vertStage.pName  = "main";
+    vertStage.pSpecializationInfo = &specInfo;
 
     VkPipelineShaderStageCreateInfo fragStage{};
     fragStage.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -539,10 +862,35 @@ void VulkanApp::createGraphicsPipeline() {
     fragStage.module = fragModule;
     fragStage.pName  = "main";
 
-    VkPipelineShaderStageCreateInfo stages[] = { vertStage, fragStage };
+    // constant_ids 1-3 in basic.frag: one set of X-ray values per preset
+    const uint32_t presetCount = static_cast<uint32_t>(std::size(Config::XRAY_PRESETS));
+    VkSpecializationMapEntry xrayEntries[3];
+    for (uint32_t i = 0; i < 3; ++i) {
+        xrayEntries[i].constantID = 1 + i;
+        xrayEntries[i].offset     = i * static_cast<uint32_t>(sizeof(float));
+        xrayEntries[i].size       = sizeof(float);
+    }
+
+    std::vector<std::array<float, 3>>                           xrayValues(presetCount);
+    std::vector<VkSpecializationInfo>                           xraySpecs(presetCount);
+    std::vector<std::array<VkPipelineShaderStageCreateInfo, 2>> presetStages(presetCount);
+    for (uint32_t p = 0; p < presetCount; ++p) {
+        const Config::XRayPreset& preset = Config::XRAY_PRESETS[p];
+        xrayValues[p] = { preset.edgeFalloff, preset.intensity, preset.ambient };
 
-    auto bindingDesc    = VulkanVertex::getBindingDescription();
-    auto attributeDescs = VulkanVertex::getAttributeDescriptions();
+        xraySpecs[p].mapEntryCount = 3;
+        xraySpecs[p].pMapEntries   = xrayEntries;
+        xraySpecs[p].dataSize      = sizeof(xrayValues[p]);
+        xraySpecs[p].pData         = xrayValues[p].data();
+
+        presetStages[p] = { vertStage, fragStage };
+        presetStages[p][1].pSpecializationInfo = &xraySpecs[p];
+    }
+
+    auto bindingDesc    = m_compactVertices ? CompactVertex::getBindingDescription()
+                                            : VulkanVertex::getBindingDescription();
+    auto attributeDescs = m_compactVertices ? CompactVertex::getAttributeDescriptions()
+                                            : VulkanVertex::getAttributeDescriptions();
 
     VkPipelineVertexInputStateCreateInfo vi{};
     vi.sType                           = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
@@ -581,14 +929,14 @@ void VulkanApp::createGraphicsPipeline() {
     rs.rasterizerDiscardEnable = VK_FALSE;
     rs.polygonMode             = VK_POLYGON_MODE_FILL;
     rs.lineWidth               = 1.0f;
-    if (Config::ENABLE_BACKFACE_CULLING)
-        rs.cullMode = VK_CULL_MODE_BACK_BIT;
-    else
-        rs.cullMode = VK_CULL_MODE_NONE;
-
+    rs.cullMode                = VK_CULL_MODE_NONE;
     rs.frontFace               = VK_FRONT_FACE_COUNTER_CLOCKWISE;
     rs.depthBiasEnable         = VK_FALSE;
 
+    // index 1 culls back faces
+    VkPipelineRasterizationStateCreateInfo cullStates[2] = { rs, rs };
+    cullStates[1].cullMode = VK_CULL_MODE_BACK_BIT;
+
     VkPipelineMultisampleStateCreateInfo ms{};
     ms.sType                = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
     ms.sampleShadingEnable  = VK_FALSE;
@@ -613,17 +961,27 @@ void VulkanApp::createGraphicsPipeline() {
     cb.attachmentCount = 1;
     cb.pAttachments    = &cbAttach;
 
-    VkPushConstantRange push{};
-    push.offset     = 0;
-    push.size       = sizeof(PushConsts);
-    push.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    VkDescriptorSetLayoutBinding transforms{};
+    transforms.binding         = 0;
+    transforms.descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    transforms.descriptorCount = 1;
+    transforms.stageFlags      = VK_SHADER_STAGE_VERTEX_BIT;
+
+    VkDescriptorSetLayoutCreateInfo dslci{};
+    dslci.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    dslci.bindingCount = 1;
+    dslci.pBindings    = &transforms;
+
+    if (vkCreateDescriptorSetLayout(m_device, &dslci, nullptr, &m_descriptorSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create descriptor set layout");
+    }
 
     VkPipelineLayoutCreateInfo plci{};
     plci.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    plci.setLayoutCount         = 0;
-    plci.pSetLayouts            = nullptr;
-    plci.pushConstantRangeCount = 1;
-    plci.pPushConstantRanges    = &push;
+    plci.setLayoutCount         = 1;
+    plci.pSetLayouts            = &m_descriptorSetLayout;
+    plci.pushConstantRangeCount = 0;
+    plci.pPushConstantRanges    = nullptr;
 
     if (vkCreatePipelineLayout(m_device, &plci, nullptr, &m_pipelineLayout) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create pipeline layout");
@@ -632,11 +990,9 @@ void VulkanApp::createGraphicsPipeline() {
     VkGraphicsPipelineCreateInfo gp{};
     gp.sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
     gp.stageCount          = 2;
-    gp.pStages             = stages;
     gp.pVertexInputState   = &vi;
     gp.pInputAssemblyState = &ia;
     gp.pViewportState      = &vp;
-    gp.pRasterizationState = &rs;
     gp.pMultisampleState   = &ms;
     gp.pDepthStencilState  = nullptr;
     gp.pColorBlendState    = &cb;
@@ -646,12 +1002,48 @@ void VulkanApp::createGraphicsPipeline() {
     gp.subpass             = 0;
     gp.basePipelineHandle  = VK_NULL_HANDLE;
 
-    if (vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1, &gp, nullptr, &m_graphicsPipeline) != VK_SUCCESS) {
+    // every variant in one call, so the driver can compile them together
+    std::vector<VkGraphicsPipelineCreateInfo> infos;
+    std::vector<uint64_t>                     keys;
+    for (uint32_t cull = 0; cull < 2; ++cull) {
+        for (uint32_t p = 0; p < presetCount; ++p) {
+            gp.pStages             = presetStages[p].data();
+            gp.pRasterizationState = &cullStates[cull];
+            infos.push_back(gp);
+            keys.push_back(pipelineKey(cull == 1, p));
+        }
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<VkPipeline> pipelines(infos.size(), VK_NULL_HANDLE);
+    if (vkCreateGraphicsPipelines(m_device, m_pipelineCache.handle(), static_cast<uint32_t>(infos.size()),
+                                  infos.data(), nullptr, pipelines.data()) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create graphics pipeline");
     }
+    double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    std::cout << "Pipelines: " << pipelines.size() << " variants in " << buildMs << " ms\n";
+
+    for (size_t i = 0; i < pipelines.size(); ++i) m_pipelines[keys[i]] = pipelines[i];
 
     vkDestroyShaderModule(m_device, fragModule, nullptr);
     vkDestroyShaderModule(m_device, vertModule, nullptr);
+
+    selectPipeline(Config::ENABLE_BACKFACE_CULLING, std::min(Config::XRAY_PRESET, presetCount - 1));
+}
+
+uint64_t VulkanApp::pipelineKey(bool backfaceCulling, uint32_t xrayPreset) {
+    return (uint64_t(backfaceCulling) << 32) | xrayPreset;
+}
+
+void VulkanApp::selectPipeline(bool backfaceCulling, uint32_t xrayPreset) {
+    auto it = m_pipelines.find(pipelineKey(backfaceCulling, xrayPreset));
+    if (it == m_pipelines.end()) return;
+
+    m_graphicsPipeline = it->second;
+    m_backfaceCulling  = backfaceCulling;
+    m_xrayPreset       = xrayPreset;
+    std::cout << "X-ray preset: " << Config::XRAY_PRESETS[xrayPreset].name
+              << ", backface culling " << (backfaceCulling ? "on" : "off") << "\n";
 }
 
 void VulkanApp::createFramebuffers() {
@@ -690,25 +1082,13 @@ void VulkanApp::createCommandPool() {
     }
 }
 
-uint32_t VulkanApp::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
-    VkPhysicalDeviceMemoryProperties memProps;
-    vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &memProps);
-
-    for (uint32_t i = 0; i < memProps.memoryTypeCount; i++) {
-        if ((typeFilter & (1 << i)) &&
-            (memProps.memoryTypes[i].propertyFlags & properties) == properties) {
-            return i;
-        }
-    }
-
-    throw std::runtime_error("Failed to find suitable memory type");
-}
-
 void VulkanApp::createBuffer(VkDeviceSize size,
                              VkBufferUsageFlags usage,
                              VkMemoryPropertyFlags properties,
                              VkBuffer& buffer,
-                             VkDeviceMemory& bufferMemory) {
+                             GpuAllocation& bufferMemory,
+                             AllocationStrategy strategy,
+                             VkMemoryPropertyFlags preferred) {
     VkBufferCreateInfo ci{};
     ci.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
     ci.size        = size;
@@ -722,138 +1102,633 @@ void VulkanApp::createBuffer(VkDeviceSize size,
     VkMemoryRequirements memReq;
     vkGetBufferMemoryRequirements(m_device, buffer, &memReq);
 
-    VkMemoryAllocateInfo alloc{};
-    alloc.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    alloc.allocationSize  = memReq.size;
-    alloc.memoryTypeIndex = findMemoryType(memReq.memoryTypeBits, properties);
+    // preferred only while its heap has room to spare
+    if (preferred != 0 && m_allocator.hasRoom(memReq.memoryTypeBits, preferred, memReq.size))
+        properties = preferred;
+
+    bufferMemory = m_allocator.allocate(memReq, properties, strategy);
+    vkBindBufferMemory(m_device, buffer, bufferMemory.memory, bufferMemory.offset);
+}
+
+void VulkanApp::destroyBuffer(VkBuffer& buffer, GpuAllocation& bufferMemory) {
+    vkDestroyBuffer(m_device, buffer, nullptr);
+    m_allocator.free(bufferMemory);
+    buffer = VK_NULL_HANDLE;
+}
 
-    if (vkAllocateMemory(m_device, &alloc, nullptr, &bufferMemory) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to allocate buffer memory");
+// Vertex / index / indirect data. Where device-local memory is also host
+// visible (integrated GPUs, software rasterizers, resizable BAR) and its
+// heap has room, the buffer lands there and uploadToBuffer() writes it in
+// place; otherwise it is plain device-local memory filled through the ring.
+void VulkanApp::createGeometryBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
+                                     VkBuffer& buffer, GpuAllocation& bufferMemory) {
+    const VkMemoryPropertyFlags direct = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT |
+                                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                         VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    createBuffer(size, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                 buffer, bufferMemory, AllocationStrategy::FreeList,
+                 Config::DIRECT_UPLOAD ? direct : 0);
+}
+
+// Writes count elements at offset, in place when the buffer is mapped
+// (host writes to coherent memory are visible to the next queue submit),
+// through the staging ring otherwise. The ring is only created on the first
+// upload that needs it.
+void VulkanApp::uploadToBuffer(VkBuffer buffer, const GpuAllocation& bufferMemory, VkDeviceSize offset,
+                               size_t elementSize, size_t count, const StagingRing::FillFn& fill) {
+    if (count == 0) return;
+
+    if (bufferMemory.mapped) {
+        fill(static_cast<uint8_t*>(bufferMemory.mapped) + offset, 0, count);
+        m_directUploadBytes += VkDeviceSize(elementSize) * count;
+        return;
     }
 
-    vkBindBufferMemory(m_device, buffer, bufferMemory, 0);
+    if (!m_stagingRing.isOpen()) createStagingRing();
+    m_stagingRing.upload(buffer, offset, elementSize, count, fill);
 }
 
-VkCommandBuffer VulkanApp::beginSingleTimeCommands() {
-    VkCommandBufferAllocateInfo ai{};
-    ai.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    ai.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    ai.commandPool        = m_commandPool;
-    ai.commandBufferCount = 1;
+// On the graphics queue the draws that read the buffers are ordered after
+// the ring's copies by submission order and its barriers; on the transfer
+// queue they are handed over through m_uploadTimeline (see acquireUploads).
+void VulkanApp::createStagingRing() {
+    if (m_transferFamily != m_graphicsFamily && m_uploadTimeline == VK_NULL_HANDLE) {
+        VkSemaphoreTypeCreateInfo type{};
+        type.sType         = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        type.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        type.initialValue  = 0;
+
+        VkSemaphoreCreateInfo ci{};
+        ci.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        ci.pNext = &type;
+        if (vkCreateSemaphore(m_device, &ci, nullptr, &m_uploadTimeline) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create upload timeline semaphore");
+        }
+    }
 
-    VkCommandBuffer cmd;
-    vkAllocateCommandBuffers(m_device, &ai, &cmd);
+    m_stagingRing.init(m_device, m_allocator, m_transferQueue, m_transferFamily,
+                       VkDeviceSize(Config::STAGING_RING_MB) << 20,
+                       m_graphicsFamily, m_uploadTimeline);
+}
 
-    VkCommandBufferBeginInfo bi{};
-    bi.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    bi.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+// Waits for the last copies (only the tail of an upload is still in
+// flight here), keeps their acquire barriers for the next frame and frees
+// the ring.
+void VulkanApp::releaseStagingRing(const char* stage) {
+    if (m_directUploadBytes > 0) {
+        std::cout << "Direct upload (" << stage << "): " << m_directUploadBytes / (1024.0 * 1024.0)
+                  << " MB written in place into host-visible device-local memory\n";
+        m_directUploadBytes = 0;
+    }
+    if (!m_stagingRing.isOpen()) return;
 
-    vkBeginCommandBuffer(cmd, &bi);
-    return cmd;
+    m_stagingRing.finish();
+    m_acquireValue = std::max(m_acquireValue, m_stagingRing.acquire(m_acquireBarriers));
+    reportStagingStats(stage);
+    m_stagingRing.destroy();
 }
 
-void VulkanApp::endSingleTimeCommands(VkCommandBuffer cmd) {
-    vkEndCommandBuffer(cmd);
+// Records the acquire half of every finished transfer-queue copy and
+// publishes the streamed batches they complete. Returns the timeline value
+// the frame has to wait on, or 0. That value has already been reached, so
+// the wait never holds the frame back.
+uint64_t VulkanApp::acquireUploads(VkCommandBuffer cmd) {
+    // without a ring every streamed batch was written in place
+    uint64_t done = std::numeric_limits<uint64_t>::max();
+    if (m_stagingRing.isOpen()) {
+        done           = m_stagingRing.acquire(m_acquireBarriers);
+        m_acquireValue = std::max(m_acquireValue, done);
+    }
+    while (!m_streamPublish.empty() && m_streamPublish.front().first <= done) {
+        m_indexCount = m_streamPublish.front().second;
+        m_streamPublish.pop_front();
+
+        if (!m_firstBatchReported) {
+            m_firstBatchReported = true;
+            double ms = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - m_streamStart).count();
+            std::cout << "First streamed batch on screen after " << ms << " ms\n";
+        }
+    }
 
-    VkSubmitInfo si{};
-    si.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    si.commandBufferCount = 1;
-    si.pCommandBuffers    = &cmd;
+    if (m_acquireBarriers.empty()) return 0;
 
-    vkQueueSubmit(m_graphicsQueue, 1, &si, VK_NULL_HANDLE);
-    vkQueueWaitIdle(m_graphicsQueue);
+    const VkPipelineStageFlags stages = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+                                        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
+    vkCmdPipelineBarrier(cmd, stages, stages, 0, 0, nullptr,
+                         static_cast<uint32_t>(m_acquireBarriers.size()), m_acquireBarriers.data(),
+                         0, nullptr);
+    m_acquireBarriers.clear();
+    return m_acquireValue;
+}
 
-    vkFreeCommandBuffers(m_device, m_commandPool, 1, &cmd);
+void VulkanApp::reportStagingStats(const char* stage) const {
+    const StagingStats& s = m_stagingRing.stats();
+    std::cout << "Staging ring (" << stage << "): " << s.bytes / (1024.0 * 1024.0) << " MB in "
+              << s.submits << " submits through " << Config::STAGING_RING_MB << " MB, CPU waited "
+              << s.waitMilliseconds << " ms on the GPU\n";
 }
 
 // vertex / index buffers -----------------------------------
 
 void VulkanApp::createVertexBuffer() {
-    VkDeviceSize bufferSize = sizeof(VulkanVertex) * m_vertices.size();
-
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingMemory;
-    createBuffer(
-        bufferSize,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        stagingBuffer, stagingMemory
-    );
+    if (m_stream) {
+        // filled later by uploadStreamedBatches()
+        createGeometryBuffer(
+            sizeof(VulkanVertex) * m_stream->vertexCount(),
+            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+            m_vertexBuffer, m_vertexBufferMemory
+        );
+        return;
+    }
 
-    void* data;
-    vkMapMemory(m_device, stagingMemory, 0, bufferSize, 0, &data);
-    std::memcpy(data, m_vertices.data(), static_cast<size_t>(bufferSize));
-    vkUnmapMemory(m_device, stagingMemory);
+    // a cache hit copies straight from the file mapping into the buffer (or
+    // staging memory); otherwise the loader's vertex array already has the GPU layout
+    const Vertex* src   = m_cache.isOpen() ? reinterpret_cast<const Vertex*>(m_cache.vertices())
+                                           : m_mesh.vertices.data();
+    size_t        count = m_cache.isOpen() ? m_cache.vertexCount() : m_mesh.vertices.size();
+    const size_t  stride     = m_compactVertices ? sizeof(CompactVertex) : sizeof(VulkanVertex);
+    VkDeviceSize  bufferSize = stride * count;
 
-    createBuffer(
+    createGeometryBuffer(
         bufferSize,
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
         m_vertexBuffer, m_vertexBufferMemory
     );
 
-    VkCommandBuffer cmd = beginSingleTimeCommands();
-    VkBufferCopy copy{};
-    copy.srcOffset = 0;
-    copy.dstOffset = 0;
-    copy.size      = bufferSize;
-    vkCmdCopyBuffer(cmd, stagingBuffer, m_vertexBuffer, 1, &copy);
-    endSingleTimeCommands(cmd);
+    m_clusterModel = m_model;
+
+    // written in place, or slot by slot through the staging ring
+    if (m_compactVertices) {
+        const VertexQuantization q = makeVertexQuantization(computeBounds(src, count));
+        QuantizationError e;
+        uploadToBuffer(m_vertexBuffer, m_vertexBufferMemory, 0, stride, count,
+                       [&](void* dst, size_t first, size_t n) {
+            const QuantizationError part =
+                encodeCompactVertices(src + first, n, q, static_cast<CompactVertex*>(dst));
+            e.maxPositionError = std::max(e.maxPositionError, part.maxPositionError);
+            e.maxNormalDegrees = std::max(e.maxNormalDegrees, part.maxNormalDegrees);
+        });
+        reportQuantizationError(e);
+        m_model = m_model * dequantizationMatrix(q);
+    } else {
+        uploadToBuffer(m_vertexBuffer, m_vertexBufferMemory, 0, stride, count,
+                       [&](void* dst, size_t first, size_t n) {
+            std::memcpy(dst, src + first, n * stride);
+        });
+    }
+}
 
-    vkDestroyBuffer(m_device, stagingBuffer, nullptr);
-    vkFreeMemory(m_device, stagingMemory, nullptr);
+// Converts the worst position error into pixels for the nearest point of
+// the unit sphere at the current camera distance.
+void VulkanApp::reportQuantizationError(const QuantizationError& e) const {
+    const glm::vec4 axis  = m_model[0];
+    const float unitScale = glm::length(glm::vec3(axis.x, axis.y, axis.z));   // file units -> unit sphere
+    const float unitError = e.maxPositionError * unitScale;
+    const float depth     = std::max(m_distance - 1.0f, 0.01f);
+    const float pixels    = unitError * static_cast<float>(m_swapchainExtent.height) /
+                            (2.0f * std::tan(glm::radians(CAMERA_FOV_DEGREES) * 0.5f) * depth);
+
+    std::cout << "Compact vertices: " << sizeof(CompactVertex) << " B/vertex (float: "
+              << sizeof(VulkanVertex) << " B)\n";
+    std::cout << "  max position error: " << e.maxPositionError << " (" << unitError
+              << " of the unit sphere, " << pixels << " px at distance " << m_distance
+              << (pixels < 1.0f ? ", below one pixel" : ", VISIBLE") << ")\n";
+    std::cout << "  max normal error:   " << e.maxNormalDegrees << " deg\n";
 }
 
 void VulkanApp::createIndexBuffer() {
-    VkDeviceSize bufferSize = sizeof(uint32_t) * m_indices.size();
+    if (m_stream) {
+        createGeometryBuffer(
+            sizeof(uint32_t) * m_stream->indexCount(),
+            VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+            m_indexBuffer, m_indexBufferMemory
+        );
+        return;
+    }
 
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingMemory;
-    createBuffer(
+    const uint32_t* src   = m_cache.isOpen() ? m_cache.indices()    : m_mesh.indices.data();
+    size_t          count = m_cache.isOpen() ? m_cache.indexCount() : m_mesh.indices.size();
+
+    // 16-bit whenever every index value fits: small meshes, or meshes split
+    // into index chunks (indices relative to each draw's vertexOffset)
+    std::vector<uint32_t> rangeMax(parallelRangeCount(count, 1u << 16), 0);
+    parallelRanges(count, 1u << 16, [&](size_t begin, size_t end, size_t r) {
+        uint32_t m = 0;
+        for (size_t i = begin; i < end; ++i) m = std::max(m, src[i]);
+        rangeMax[r] = m;
+    });
+    const uint32_t maxIndex = rangeMax.empty() ? 0 : *std::max_element(rangeMax.begin(), rangeMax.end());
+    m_indexType = (maxIndex <= 0xFFFF) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+
+    const size_t indexSize  = (m_indexType == VK_INDEX_TYPE_UINT16) ? sizeof(uint16_t) : sizeof(uint32_t);
+    VkDeviceSize bufferSize = indexSize * count;
+    std::cout << "Index buffer: " << (indexSize * 8) << "-bit, "
+              << bufferSize / (1024.0 * 1024.0) << " MB\n";
+
+    createGeometryBuffer(
         bufferSize,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        stagingBuffer, stagingMemory
+        VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+        m_indexBuffer, m_indexBufferMemory
     );
 
-    void* data;
-    vkMapMemory(m_device, stagingMemory, 0, bufferSize, 0, &data);
-    std::memcpy(data, m_indices.data(), static_cast<size_t>(bufferSize));
-    vkUnmapMemory(m_device, stagingMemory);
+    if (m_indexType == VK_INDEX_TYPE_UINT16) {
+        uploadToBuffer(m_indexBuffer, m_indexBufferMemory, 0, indexSize, count,
+                       [&](void* data, size_t first, size_t n) {
+            uint16_t* dst = static_cast<uint16_t*>(data);
+            parallelRanges(n, 1u << 16, [&](size_t begin, size_t end, size_t) {
+                for (size_t i = begin; i < end; ++i) dst[i] = static_cast<uint16_t>(src[first + i]);
+            });
+        });
+    } else {
+        uploadToBuffer(m_indexBuffer, m_indexBufferMemory, 0, indexSize, count,
+                       [&](void* data, size_t first, size_t n) {
+            std::memcpy(data, src + first, n * indexSize);
+        });
+    }
+}
+
+void VulkanApp::createIndirectBuffer() {
+    // streaming draws its growing prefix directly
+    if (m_stream) return;
+    if (!m_clusters.empty() || !m_lods.empty()) {
+        createFrameDrawBuffers();
+        return;
+    }
+
+    std::vector<VkDrawIndexedIndirectCommand> commands;
+    commands.reserve(m_submeshes.size());
+    for (const SubMesh& sub : m_submeshes) {
+        if (sub.indexCount == 0) continue;
+        VkDrawIndexedIndirectCommand c{};
+        c.indexCount    = sub.indexCount;
+        c.instanceCount = 1;
+        c.firstIndex    = sub.firstIndex;
+        c.vertexOffset  = static_cast<int32_t>(sub.baseVertex);   // 0 for global indices
+        c.firstInstance = 0;
+        commands.push_back(c);
+    }
+    if (commands.empty()) return;
 
-    createBuffer(
+    m_drawCount = static_cast<uint32_t>(commands.size());
+    VkDeviceSize bufferSize = sizeof(VkDrawIndexedIndirectCommand) * commands.size();
+
+    createGeometryBuffer(
         bufferSize,
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        m_indexBuffer, m_indexBufferMemory
+        VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+        m_indirectBuffer, m_indirectBufferMemory
     );
 
-    VkCommandBuffer cmd = beginSingleTimeCommands();
-    VkBufferCopy copy{};
-    copy.srcOffset = 0;
-    copy.dstOffset = 0;
-    copy.size      = bufferSize;
-    vkCmdCopyBuffer(cmd, stagingBuffer, m_indexBuffer, 1, &copy);
-    endSingleTimeCommands(cmd);
+    uploadToBuffer(m_indirectBuffer, m_indirectBufferMemory, 0,
+                   sizeof(VkDrawIndexedIndirectCommand), commands.size(),
+                   [&](void* dst, size_t first, size_t n) {
+        std::memcpy(dst, commands.data() + first, n * sizeof(VkDrawIndexedIndirectCommand));
+    });
 
-    vkDestroyBuffer(m_device, stagingBuffer, nullptr);
-    vkFreeMemory(m_device, stagingMemory, nullptr);
+    std::cout << "Draw ranges: " << m_drawCount
+              << (m_multiDrawIndirect ? " (multi-draw indirect)" : " (one indirect draw each)") << "\n";
+}
+
+// The BVH keeps its own copy of the positions, so it is built before the
+// mesh (or cache mapping) is released.
+void VulkanApp::buildPickingBvh() {
+    if (!Config::BUILD_PICKING_BVH || m_stream) return;
+
+    const Vertex*   vertices = m_cache.isOpen() ? reinterpret_cast<const Vertex*>(m_cache.vertices())
+                                                : m_mesh.vertices.data();
+    const size_t    count    = m_cache.isOpen() ? m_cache.vertexCount() : m_mesh.vertices.size();
+    const uint32_t* indices  = m_cache.isOpen() ? m_cache.indices() : m_mesh.indices.data();
+
+    BvhStats s = m_bvh.build(vertices, count, indices, m_submeshes);
+    std::cout << "Picking BVH: " << s.nodes << " nodes over " << s.triangles << " triangles ("
+              << s.bytes / (1024.0 * 1024.0) << " MB) in " << s.milliseconds << " ms\n";
+}
+
+// Room for one command per cluster (or per submesh of a LOD level) in every
+// frame in flight; persistently mapped, since the commands change with the
+// camera.
+void VulkanApp::createFrameDrawBuffers() {
+    const size_t       maxDraws   = std::max(m_clusters.size(), m_submeshes.size());
+    const VkDeviceSize bufferSize = sizeof(VkDrawIndexedIndirectCommand) * maxDraws + sizeof(uint32_t);
+
+    // the count must stay within the device limit
+    m_frameDrawCapacity = static_cast<uint32_t>(maxDraws);
+    m_drawIndirectCount = m_drawIndirectCount && m_frameDrawCapacity <= m_maxDrawIndirectCount;
+
+    m_frameDrawBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    m_frameDrawMemory.resize(MAX_FRAMES_IN_FLIGHT);
+    m_frameDrawCommands.resize(MAX_FRAMES_IN_FLIGHT);
+    m_frameDrawWritten.assign(MAX_FRAMES_IN_FLIGHT, 0);
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        createBuffer(
+            bufferSize,
+            VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            m_frameDrawBuffers[i], m_frameDrawMemory[i]
+        );
+        m_frameDrawCommands[i] = static_cast<VkDrawIndexedIndirectCommand*>(m_frameDrawMemory[i].mapped);
+        // unused commands draw nothing (instanceCount 0)
+        std::memset(m_frameDrawMemory[i].mapped, 0, bufferSize);
+    }
+
+    std::cout << "Draw ranges: up to " << maxDraws << " per frame, "
+              << m_clusters.size() << " culling clusters, " << m_lods.size() + 1 << " LOD levels"
+              << (m_drawIndirectCount ? " (indirect count)"
+                  : m_multiDrawIndirect ? " (multi-draw indirect)" : " (one indirect draw each)") << "\n";
+}
+
+// Culls the clusters for this frame and writes one command per run of
+// visible clusters (neighbours in the index buffer merge into one draw).
+uint32_t VulkanApp::writeVisibleClusters(const glm::mat4& proj, const glm::mat4& view,
+                                         VkDrawIndexedIndirectCommand* out) {
+    const glm::mat4      mv      = view * m_clusterModel;
+    const ClusterFrustum frustum = makeClusterFrustum(proj * mv, mv, m_backfaceCulling);
+
+    uint32_t count   = 0;
+    uint32_t visible = 0;
+    for (const MeshCluster& c : m_clusters) {
+        if (!isClusterVisible(c, frustum)) continue;
+        ++visible;
+
+        if (count > 0) {
+            VkDrawIndexedIndirectCommand& last = out[count - 1];
+            if (last.firstIndex + last.indexCount == c.firstIndex &&
+                last.vertexOffset == static_cast<int32_t>(c.baseVertex)) {
+                last.indexCount += c.indexCount;
+                continue;
+            }
+        }
+        VkDrawIndexedIndirectCommand& cmd = out[count++];
+        cmd.indexCount    = c.indexCount;
+        cmd.instanceCount = 1;
+        cmd.firstIndex    = c.firstIndex;
+        cmd.vertexOffset  = static_cast<int32_t>(c.baseVertex);
+        cmd.firstInstance = 0;
+    }
+
+    m_cullFrames++;
+    m_clustersVisible += visible;
+    return count;
+}
+
+// Coarsest level whose error, seen from the camera at the nearest point of
+// the mesh, stays within the pixel budget; the budget is larger while the
+// user orbits, and full detail comes back as soon as the button is up.
+uint32_t VulkanApp::selectLodLevel(const glm::vec3& camPos) const {
+    if (m_lods.empty()) return 0;
+
+    const float budget = m_mousePressed ? Config::LOD_ORBIT_PIXEL_ERROR : Config::LOD_PIXEL_ERROR;
+
+    // the model matrix scales uniformly and fits the mesh into the unit
+    // sphere at the origin
+    const float scale    = glm::length(glm::vec3(m_clusterModel[0][0], m_clusterModel[0][1], m_clusterModel[0][2]));
+    const float distance = std::max(glm::length(camPos) - 1.0f, 0.01f);
+    const float pixelsPerUnit = float(m_swapchainExtent.height) /
+        (2.0f * std::tan(0.5f * glm::radians(CAMERA_FOV_DEGREES)) * distance);
+
+    uint32_t level = 0;
+    for (size_t i = 0; i < m_lods.size(); ++i)
+        if (m_lods[i].error * scale * pixelsPerUnit <= budget) level = static_cast<uint32_t>(i + 1);
+    return level;
+}
+
+// One command per submesh range of the level (0 = the full mesh).
+uint32_t VulkanApp::writeLodRanges(uint32_t level, VkDrawIndexedIndirectCommand* out) const {
+    const SubMesh* ranges = level == 0 ? m_submeshes.data()
+                                       : m_lodRanges.data() + m_lods[level - 1].firstRange;
+    uint32_t count = 0;
+    for (size_t i = 0; i < m_submeshes.size(); ++i) {
+        if (ranges[i].indexCount == 0) continue;
+        VkDrawIndexedIndirectCommand& cmd = out[count++];
+        cmd.indexCount    = ranges[i].indexCount;
+        cmd.instanceCount = 1;
+        cmd.firstIndex    = ranges[i].firstIndex;
+        cmd.vertexOffset  = static_cast<int32_t>(ranges[i].baseVertex);
+        cmd.firstInstance = 0;
+    }
+    return count;
+}
+
+// streaming upload -----------------------------------------
+
+void VulkanApp::uploadStreamedBatches() {
+    if (!m_stream) return;
+
+    const VkDeviceSize budget   = VkDeviceSize(Config::STREAM_UPLOAD_BUDGET_MB) << 20;
+    VkDeviceSize       used     = 0;
+    size_t             drawnIndex = m_indexCount;
+
+    // take whatever has landed, up to the per-frame budget (but at least one
+    // batch); the rest waits for the next frame
+    while (m_hasPendingBatch || m_stream->pop(m_pendingBatch)) {
+        const MeshBatch& b = m_pendingBatch;
+        const VkDeviceSize bytes = sizeof(VulkanVertex) * b.vertices.size() +
+                                   sizeof(uint32_t) * b.indices.size();
+
+        if (used > 0 && used + bytes > budget) {
+            m_hasPendingBatch = true;
+            break;
+        }
+        m_hasPendingBatch = false;
+        used += bytes;
+
+        uploadToBuffer(m_vertexBuffer, m_vertexBufferMemory, sizeof(VulkanVertex) * b.firstVertex,
+                       sizeof(VulkanVertex), b.vertices.size(),
+                       [&](void* dst, size_t first, size_t n) {
+            std::memcpy(dst, b.vertices.data() + first, n * sizeof(VulkanVertex));
+        });
+        uploadToBuffer(m_indexBuffer, m_indexBufferMemory, sizeof(uint32_t) * b.firstIndex,
+                       sizeof(uint32_t), b.indices.size(),
+                       [&](void* dst, size_t first, size_t n) {
+            std::memcpy(dst, b.indices.data() + first, n * sizeof(uint32_t));
+        });
+        if (!b.indices.empty())
+            drawnIndex = std::max(drawnIndex, b.firstIndex + b.indices.size());
+    }
+
+    if (used == 0) {
+        // done once the last copies have landed
+        if (!m_hasPendingBatch && m_stream->finished() && m_streamPublish.empty()) finishStreaming();
+        return;
+    }
+
+    // the first frame recorded after this submit's copies complete draws
+    // the new prefix
+    m_streamPublish.emplace_back(m_stagingRing.submit(), static_cast<uint32_t>(drawnIndex));
+}
+
+void VulkanApp::finishStreaming() {
+    m_model = normalizationMatrix(m_stream->bounds());
+
+    double ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - m_streamStart).count();
+    std::cout << "Streaming finished: " << m_stream->vertexCount() << " vertices, "
+              << m_indexCount / 3 << " triangles in " << ms << " ms\n";
+    std::cout << "  radius: " << m_stream->bounds().radius << "\n";
+
+    releaseStagingRing("streaming");
+
+    m_stream.reset();
+    m_pendingBatch = MeshBatch{};
 }
 
 // command buffers (allocate only) --------------------------
 
 void VulkanApp::createCommandBuffers() {
-    m_commandBuffers.resize(m_swapchainFramebuffers.size());
+    // one transient pool per frame in flight, holding that frame's primary
+    VkCommandPoolCreateInfo pci{};
+    pci.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pci.flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    pci.queueFamilyIndex = m_graphicsFamily;
+
+    m_framePools.resize(MAX_FRAMES_IN_FLIGHT);
+    m_commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        if (vkCreateCommandPool(m_device, &pci, nullptr, &m_framePools[i]) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create frame command pool");
+        }
+
+        VkCommandBufferAllocateInfo ai{};
+        ai.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        ai.commandPool        = m_framePools[i];
+        ai.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        ai.commandBufferCount = 1;
+        if (vkAllocateCommandBuffers(m_device, &ai, &m_commandBuffers[i]) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to allocate command buffers");
+        }
+    }
+
+    // the static draws, recorded on first use
+    m_staticDraws.resize(MAX_FRAMES_IN_FLIGHT);
+    m_staticDrawStates.assign(MAX_FRAMES_IN_FLIGHT, StaticDrawState{});
 
     VkCommandBufferAllocateInfo ai{};
     ai.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     ai.commandPool        = m_commandPool;
-    ai.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    ai.commandBufferCount = static_cast<uint32_t>(m_commandBuffers.size());
+    ai.level              = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+    ai.commandBufferCount = static_cast<uint32_t>(m_staticDraws.size());
+    if (vkAllocateCommandBuffers(m_device, &ai, m_staticDraws.data()) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate static draw command buffers");
+    }
+}
+
+// One FrameTransforms uniform buffer and descriptor set per frame in
+// flight; the CPU rewrites the frame's buffer after waiting on its fence.
+void VulkanApp::createFrameUniforms() {
+    m_frameUniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    m_frameUniformMemory.resize(MAX_FRAMES_IN_FLIGHT);
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        createBuffer(
+            sizeof(FrameTransforms),
+            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            m_frameUniformBuffers[i], m_frameUniformMemory[i]
+        );
+    }
 
-    if (vkAllocateCommandBuffers(m_device, &ai, m_commandBuffers.data()) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to allocate command buffers");
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type            = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    poolSize.descriptorCount = MAX_FRAMES_IN_FLIGHT;
+
+    VkDescriptorPoolCreateInfo dpci{};
+    dpci.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    dpci.maxSets       = MAX_FRAMES_IN_FLIGHT;
+    dpci.poolSizeCount = 1;
+    dpci.pPoolSizes    = &poolSize;
+    if (vkCreateDescriptorPool(m_device, &dpci, nullptr, &m_descriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create descriptor pool");
     }
+
+    std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, m_descriptorSetLayout);
+    VkDescriptorSetAllocateInfo ai{};
+    ai.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    ai.descriptorPool     = m_descriptorPool;
+    ai.descriptorSetCount = MAX_FRAMES_IN_FLIGHT;
+    ai.pSetLayouts        = layouts.data();
+
+    m_frameDescriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
+    if (vkAllocateDescriptorSets(m_device, &ai, m_frameDescriptorSets.data()) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate descriptor sets");
+    }
+
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        VkDescriptorBufferInfo info{};
+        info.buffer = m_frameUniformBuffers[i];
+        info.offset = 0;
+        info.range  = sizeof(FrameTransforms);
+
+        VkWriteDescriptorSet write{};
+        write.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet          = m_frameDescriptorSets[i];
+        write.dstBinding      = 0;
+        write.descriptorCount = 1;
+        write.descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        write.pBufferInfo     = &info;
+        vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+    }
+}
+
+// Everything inside the render pass: pipeline, transforms, buffers and the
+// draws. Per-frame data (transforms, culled draw commands and their count)
+// is read from this frame's buffers, so the recording stays valid until the
+// pipeline or the streamed index count changes. Without indirect count,
+// culled draws cover the whole command array; commands past this frame's
+// count are zeroed and draw nothing.
+void VulkanApp::recordStaticDraws(size_t frame) {
+    VkCommandBuffer cmd = m_staticDraws[frame];
+    vkResetCommandBuffer(cmd, 0);
+
+    VkCommandBufferInheritanceInfo inherit{};
+    inherit.sType       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inherit.renderPass  = m_renderPass;
+    inherit.subpass     = 0;
+    inherit.framebuffer = VK_NULL_HANDLE;   // any swapchain framebuffer
+
+    VkCommandBufferBeginInfo bi{};
+    bi.sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    bi.flags            = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    bi.pInheritanceInfo = &inherit;
+    if (vkBeginCommandBuffer(cmd, &bi) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to begin recording static draws");
+    }
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1,
+                            &m_frameDescriptorSets[frame], 0, nullptr);
+
+    VkBuffer vertexBuffers[] = { m_vertexBuffer };
+    VkDeviceSize offsets[]   = { 0 };
+    vkCmdBindVertexBuffers(cmd, 0, 1, vertexBuffers, offsets);
+    vkCmdBindIndexBuffer(cmd, m_indexBuffer, 0, m_indexType);
+
+    const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+    if (!m_frameDrawBuffers.empty()) {
+        VkBuffer draws = m_frameDrawBuffers[frame];
+        if (m_drawIndirectCount) {
+            vkCmdDrawIndexedIndirectCount(cmd, draws, 0, draws, VkDeviceSize(stride) * m_frameDrawCapacity,
+                                          m_frameDrawCapacity, stride);
+        } else {
+            for (uint32_t first = 0; first < m_frameDrawCapacity; first += m_maxDrawIndirectCount) {
+                uint32_t count = std::min(m_maxDrawIndirectCount, m_frameDrawCapacity - first);
+                vkCmdDrawIndexedIndirect(cmd, draws, VkDeviceSize(first) * stride, count, stride);
+            }
+        }
+    } else if (m_indirectBuffer != VK_NULL_HANDLE) {
+        // every submesh in as few calls as the device limit allows
+        for (uint32_t first = 0; first < m_drawCount; first += m_maxDrawIndirectCount) {
+            uint32_t count = std::min(m_maxDrawIndirectCount, m_drawCount - first);
+            vkCmdDrawIndexedIndirect(cmd, m_indirectBuffer, VkDeviceSize(first) * stride, count, stride);
+        }
+    } else {
+        vkCmdDrawIndexed(cmd, m_indexCount, 1, 0, 0, 0);
+    }
+
+    if (vkEndCommandBuffer(cmd) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to record static draws");
+    }
+
+    m_staticDrawStates[frame] = StaticDrawState{ m_graphicsPipeline, m_indexCount };
+    m_staticDrawRecords++;
 }
 
 // sync objects ---------------------------------------------
@@ -879,18 +1754,22 @@ void VulkanApp::createSyncObjects() {
     }
 }
 
-// drawFrame: re-record per frame + orbit camera ------------
+// drawFrame: short primary around the reused static draws --
 
+// The primary only acquires uploads, writes this frame's transforms and
+// culled draws, and executes m_staticDraws[frame]; that secondary is
+// re-recorded only when its StaticDrawState changes.
 void VulkanApp::drawFrame() {
-    vkWaitForFences(m_device, 1, &m_inFlightFences[m_currentFrame], VK_TRUE, UINT64_MAX);
-    vkResetFences(m_device, 1, &m_inFlightFences[m_currentFrame]);
+    const size_t frame = m_currentFrame;
+    vkWaitForFences(m_device, 1, &m_inFlightFences[frame], VK_TRUE, UINT64_MAX);
+    vkResetFences(m_device, 1, &m_inFlightFences[frame]);
 
     uint32_t imageIndex;
     VkResult res = vkAcquireNextImageKHR(
         m_device,
         m_swapchain,
         UINT64_MAX,
-        m_imageAvailableSemaphores[m_currentFrame],
+        m_imageAvailableSemaphores[frame],
         VK_NULL_HANDLE,
         &imageIndex
     );
@@ -898,16 +1777,52 @@ void VulkanApp::drawFrame() {
         throw std::runtime_error("Failed to acquire swapchain image");
     }
 
-    VkCommandBuffer cmd = m_commandBuffers[imageIndex];
-    vkResetCommandBuffer(cmd, 0);
+    // the fence above covers everything recorded from this frame's pool
+    vkResetCommandPool(m_device, m_framePools[frame], 0);
+    VkCommandBuffer cmd = m_commandBuffers[frame];
 
     VkCommandBufferBeginInfo bi{};
     bi.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    bi.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
     if (vkBeginCommandBuffer(cmd, &bi) != VK_SUCCESS) {
         throw std::runtime_error("Failed to begin recording command buffer");
     }
 
+    // before the draws below read any newly uploaded range
+    const uint64_t uploadValue = acquireUploads(cmd);
+
+    // orbit camera
+    glm::vec3 camPos = cameraPosition();
+    glm::mat4 model  = m_model;
+    glm::mat4 view   = viewMatrix();
+    glm::mat4 proj   = projectionMatrix();
+
+    FrameTransforms* transforms = static_cast<FrameTransforms*>(m_frameUniformMemory[frame].mapped);
+    transforms->mvp = proj * view * model;  // Projection * View * Model
+    transforms->mv  =        view * model;  // View * Model (eye-space)
+
+    if (!m_frameDrawBuffers.empty()) {
+        // the fence wait above makes this frame's buffer free to rewrite;
+        // clusters only cover level 0
+        VkDrawIndexedIndirectCommand* commands = m_frameDrawCommands[frame];
+        const uint32_t level     = selectLodLevel(camPos);
+        const uint32_t drawCount = (level == 0 && !m_clusters.empty())
+                                       ? writeVisibleClusters(proj, view, commands)
+                                       : writeLodRanges(level, commands);
+        if (m_drawIndirectCount) {
+            *reinterpret_cast<uint32_t*>(commands + m_frameDrawCapacity) = drawCount;
+        } else {
+            for (uint32_t i = drawCount; i < m_frameDrawWritten[frame]; ++i)
+                commands[i] = VkDrawIndexedIndirectCommand{};
+            m_frameDrawWritten[frame] = drawCount;
+        }
+    }
+
+    if (!(m_staticDrawStates[frame] == StaticDrawState{ m_graphicsPipeline, m_indexCount })) {
+        recordStaticDraws(frame);
+    }
+
     VkRenderPassBeginInfo rp{};
     rp.sType             = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
     rp.renderPass        = m_renderPass;
@@ -919,69 +1834,34 @@ void VulkanApp::drawFrame() {
     rp.clearValueCount = 1;
     rp.pClearValues    = &clearColor;
 
-    vkCmdBeginRenderPass(cmd, &rp, VK_SUBPASS_CONTENTS_INLINE);
-    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
-
-    // orbit camera
-    float cp = cosf(m_pitch);
-    float sp = sinf(m_pitch);
-    float cy = cosf(m_yaw);
-    float sy = sinf(m_yaw);
-
-    glm::vec3 camPos(
-        m_distance * cp * sy,
-        m_distance * sp,
-        m_distance * cp * cy
-    );
-
-    glm::mat4 model = glm::mat4(1.0f);
-    glm::mat4 view  = glm::lookAt(
-        camPos,
-        glm::vec3(0.0f, 0.0f, 0.0f),
-        glm::vec3(0.0f, 1.0f, 0.0f)
-    );
-
-    glm::mat4 proj = glm::perspective(
-        glm::radians(60.0f),
-        float(m_swapchainExtent.width) / float(m_swapchainExtent.height),
-        0.01f,
-        10.0f
-    );
-    proj[1][1] *= -1.0f; // Vulkan NDC flip
-
-    PushConsts pc;
-    pc.mvp = proj * view * model;  // Projection * View * Model
-    pc.mv  =        view * model;  // View * Model (eye-space)
-
-    vkCmdPushConstants(
-        cmd,
-        m_pipelineLayout,
-        VK_SHADER_STAGE_VERTEX_BIT,
-        0,
-        sizeof(PushConsts),
-        &pc
-    );
-
-    VkBuffer vertexBuffers[] = { m_vertexBuffer };
-    VkDeviceSize offsets[]   = { 0 };
-    vkCmdBindVertexBuffers(cmd, 0, 1, vertexBuffers, offsets);
-    vkCmdBindIndexBuffer(cmd, m_indexBuffer, 0, VK_INDEX_TYPE_UINT32);
-
-    vkCmdDrawIndexed(cmd, m_indexCount, 1, 0, 0, 0);
-
+    vkCmdBeginRenderPass(cmd, &rp, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+    vkCmdExecuteCommands(cmd, 1, &m_staticDraws[frame]);
     vkCmdEndRenderPass(cmd);
 
     if (vkEndCommandBuffer(cmd) != VK_SUCCESS) {
         throw std::runtime_error("Failed to record command buffer");
     }
 
-    VkSemaphore waitSemaphores[]     = { m_imageAvailableSemaphores[m_currentFrame] };
-    VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+    VkSemaphore waitSemaphores[]     = { m_imageAvailableSemaphores[m_currentFrame], m_uploadTimeline };
+    VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                                          VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+                                          VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT };
     VkSemaphore signalSemaphores[]   = { m_renderFinishedSemaphores[m_currentFrame] };
 
+    // binary semaphores ignore their values
+    const uint64_t waitValues[]   = { 0, uploadValue };
+    const uint64_t signalValues[] = { 0 };
+    VkTimelineSemaphoreSubmitInfo ts{};
+    ts.sType                     = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    ts.waitSemaphoreValueCount   = 2;
+    ts.pWaitSemaphoreValues      = waitValues;
+    ts.signalSemaphoreValueCount = 1;
+    ts.pSignalSemaphoreValues    = signalValues;
+
     VkSubmitInfo si{};
     si.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    si.waitSemaphoreCount   = 1;
+    si.pNext                = uploadValue ? &ts : nullptr;
+    si.waitSemaphoreCount   = uploadValue ? 2 : 1;
     si.pWaitSemaphores      = waitSemaphores;
     si.pWaitDstStageMask    = waitStages;
     si.commandBufferCount   = 1;
@@ -989,7 +1869,7 @@ void VulkanApp::drawFrame() {
     si.signalSemaphoreCount = 1;
     si.pSignalSemaphores    = signalSemaphores;
 
-    if (vkQueueSubmit(m_graphicsQueue, 1, &si, m_inFlightFences[m_currentFrame]) != VK_SUCCESS) {
+    if (vkQueueSubmit(m_graphicsQueue, 1, &si, m_inFlightFences[frame]) != VK_SUCCESS) {
         throw std::runtime_error("Failed to submit draw command buffer");
     }
 
@@ -1004,5 +1884,6 @@ void VulkanApp::drawFrame() {
 
     vkQueuePresentKHR(m_presentQueue, &pi);
 
+    m_framesDrawn++;
     m_currentFrame = (m_currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
 }
\ No newline at end of file
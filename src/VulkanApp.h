@@ -2,33 +2,85 @@
 
 #include <vector>
 #include <optional>
+#include <memory>
+#include <chrono>
+#include <future>
+#include <deque>
+#include <unordered_map>
+#include <utility>
 
 #include <vulkan/vulkan.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "VulkanVertex.h"
+#include "CompactVertex.h"
+#include "GpuAllocator.h"
+#include "MeshCache.h"
+#include "MeshClusters.h"
+#include "MeshStream.h"
+#include "PipelineCache.h"
+#include "StagingRing.h"
+#include "TriangleBvh.h"
 
 struct GLFWwindow;
 
+// Result of the import pipeline in main(): the mesh and its model matrix.
+struct ImportedMesh {
+    MeshData  mesh;
+    glm::mat4 model = glm::mat4(1.0f);
+};
+
 class VulkanApp {
 public:
-    VulkanApp(const std::vector<VulkanVertex>& vertices,
-              const std::vector<uint32_t>& indices);
+    // Takes the mesh over without copying; its vertex array already has the
+    // GPU layout and is freed once the GPU buffers are filled. model places
+    // the mesh in the scene (e.g. normalizationMatrix()).
+    explicit VulkanApp(MeshData&& mesh, const glm::mat4& model = glm::mat4(1.0f));
+
+    // Uploads straight from a mapped mesh cache; no CPU-side copy is made
+    // and the mapping is released once the GPU buffers are filled.
+    explicit VulkanApp(MeshCacheFile&& cache);
+
+    // Progressive load: the GPU buffers are sized from the stream up front
+    // and filled batch by batch while frames are already being drawn.
+    explicit VulkanApp(std::unique_ptr<MeshStream> stream);
+
+    // Mesh still being imported on another thread: the window, device,
+    // swapchain and pipeline are created meanwhile, and initVulkan() waits
+    // for the mesh only when it gets to the buffers.
+    explicit VulkanApp(std::future<ImportedMesh> pending);
 
     void run();
     void onScroll(double xoffset, double yoffset);
+    void onKey(int key, int action);
 
-    struct PushConsts {
+    // set 0, binding 0 in basic.vert; one uniform buffer per frame in
+    // flight, so the recorded draws stay the same while the camera moves
+    struct FrameTransforms {
         glm::mat4 mvp;
         glm::mat4 mv;
     };
 
 private:
     // mesh data
-    std::vector<VulkanVertex> m_vertices;
-    std::vector<uint32_t>     m_indices;
+    MeshData                  m_mesh;      // released after upload
+    std::future<ImportedMesh> m_pendingMesh;
+    MeshCacheFile             m_cache;
+    std::vector<SubMesh>      m_submeshes;
     uint32_t                  m_indexCount = 0;
+    glm::mat4                 m_model      = glm::mat4(1.0f);
+    bool                      m_compactVertices = false;   // CompactVertex stream
+    VkIndexType               m_indexType  = VK_INDEX_TYPE_UINT32;
+
+    // streaming upload state
+    std::unique_ptr<MeshStream> m_stream;
+    MeshBatch                   m_pendingBatch;
+    bool                        m_hasPendingBatch = false;
+    std::chrono::steady_clock::time_point m_streamStart;
+    bool                        m_firstBatchReported  = false;
+    // (upload value, index count) of submitted batches not yet drawable
+    std::deque<std::pair<uint64_t, uint32_t>> m_streamPublish;
 
     // window
     GLFWwindow*   m_window = nullptr;
@@ -42,6 +94,24 @@ private:
     VkDevice         m_device         = VK_NULL_HANDLE;
     VkQueue          m_graphicsQueue  = VK_NULL_HANDLE;
     VkQueue          m_presentQueue   = VK_NULL_HANDLE;
+    uint32_t         m_graphicsFamily = 0;
+
+    // every buffer's memory comes from here; uploads go through the ring,
+    // on a transfer-only queue when the device has one (m_transferFamily
+    // differs from m_graphicsFamily). Finished copies are handed to the
+    // graphics queue with acquire barriers recorded at the start of a frame
+    // and a wait on m_uploadTimeline for a value that has already been
+    // reached, so draws never wait on a copy still in flight.
+    GpuAllocator     m_allocator;
+    StagingRing      m_stagingRing;
+    VkQueue          m_transferQueue  = VK_NULL_HANDLE;
+    uint32_t         m_transferFamily = 0;
+    VkSemaphore      m_uploadTimeline = VK_NULL_HANDLE;
+    std::vector<VkBufferMemoryBarrier> m_acquireBarriers;   // for the next frame
+    uint64_t         m_acquireValue   = 0;
+    // bytes written straight into host-visible device-local memory
+    // (UMA, resizable BAR), which skip the ring altogether
+    VkDeviceSize     m_directUploadBytes = 0;
 
     // swapchain
     VkSwapchainKHR              m_swapchain = VK_NULL_HANDLE;
@@ -54,11 +124,41 @@ private:
     // pipeline / renderpass
     VkRenderPass     m_renderPass       = VK_NULL_HANDLE;
     VkPipelineLayout m_pipelineLayout   = VK_NULL_HANDLE;
-    VkPipeline       m_graphicsPipeline = VK_NULL_HANDLE;
+    VkPipeline       m_graphicsPipeline = VK_NULL_HANDLE;   // current variant
+
+    // one pipeline per (cull mode, X-ray preset), all built at startup
+    // through m_pipelineCache, so switching is a lookup
+    PipelineCache                            m_pipelineCache;
+    std::unordered_map<uint64_t, VkPipeline> m_pipelines;
+    bool                                     m_backfaceCulling = false;
+    uint32_t                                 m_xrayPreset      = 0;
 
-    // commands
+    // commands: per frame in flight, a pool reset wholesale once the
+    // frame's fence has signalled, holding the primary that only begins the
+    // render pass and executes m_staticDraws. The secondaries come from
+    // m_commandPool and are re-recorded only when StaticDrawState changes,
+    // so the per-frame recording cost does not grow with the scene.
+    struct StaticDrawState {
+        VkPipeline pipeline   = VK_NULL_HANDLE;
+        uint32_t   indexCount = 0;   // non-indirect (streaming) draws only
+        bool operator==(const StaticDrawState& o) const {
+            return pipeline == o.pipeline && indexCount == o.indexCount;
+        }
+    };
     VkCommandPool                m_commandPool = VK_NULL_HANDLE;
-    std::vector<VkCommandBuffer> m_commandBuffers;
+    std::vector<VkCommandPool>   m_framePools;
+    std::vector<VkCommandBuffer> m_commandBuffers;     // primary, per frame in flight
+    std::vector<VkCommandBuffer> m_staticDraws;        // secondary, per frame in flight
+    std::vector<StaticDrawState> m_staticDrawStates;   // what each secondary was recorded with
+    uint64_t                     m_framesDrawn        = 0;
+    uint64_t                     m_staticDrawRecords  = 0;
+
+    // per-frame transforms
+    VkDescriptorSetLayout        m_descriptorSetLayout = VK_NULL_HANDLE;
+    VkDescriptorPool             m_descriptorPool      = VK_NULL_HANDLE;
+    std::vector<VkDescriptorSet> m_frameDescriptorSets;
+    std::vector<VkBuffer>        m_frameUniformBuffers;
+    std::vector<GpuAllocation>   m_frameUniformMemory;
 
     // sync
     static const int MAX_FRAMES_IN_FLIGHT = 2;
@@ -69,27 +169,84 @@ private:
 
     // vertex / index buffers
     VkBuffer       m_vertexBuffer       = VK_NULL_HANDLE;
-    VkDeviceMemory m_vertexBufferMemory = VK_NULL_HANDLE;
+    GpuAllocation  m_vertexBufferMemory;
     VkBuffer       m_indexBuffer        = VK_NULL_HANDLE;
-    VkDeviceMemory m_indexBufferMemory  = VK_NULL_HANDLE;
+    GpuAllocation  m_indexBufferMemory;
+
+    // one VkDrawIndexedIndirectCommand per submesh
+    VkBuffer       m_indirectBuffer       = VK_NULL_HANDLE;
+    GpuAllocation  m_indirectBufferMemory;
+    uint32_t       m_drawCount            = 0;
+    bool           m_multiDrawIndirect    = false;
+    bool           m_drawIndirectCount    = false;   // count read from the frame draw buffer
+    uint32_t       m_maxDrawIndirectCount = 1;
 
-    // simple orbit camera state
-    float  m_yaw      = 0.0f;
-    float  m_pitch    = 0.4f;
-    float  m_distance = 3.0f;
+    // culling clusters and LOD levels: when present, drawFrame() writes the
+    // commands for the chosen level (or the visible clusters of level 0)
+    // into a host-visible buffer per frame in flight instead. Cluster bounds
+    // and LOD errors are in mesh units, so they use m_clusterModel (the
+    // model matrix without the compact-vertex dequantization).
+    std::vector<MeshCluster>                   m_clusters;
+    std::vector<MeshLod>                       m_lods;
+    std::vector<SubMesh>                       m_lodRanges;
+    glm::mat4                                  m_clusterModel = glm::mat4(1.0f);
+    std::vector<VkBuffer>                      m_frameDrawBuffers;
+    std::vector<GpuAllocation>                 m_frameDrawMemory;
+    std::vector<VkDrawIndexedIndirectCommand*> m_frameDrawCommands;   // count follows the commands
+    uint32_t                                   m_frameDrawCapacity = 0;
+    std::vector<uint32_t>                      m_frameDrawWritten;    // without the count: commands to clear
+    uint64_t                                   m_cullFrames      = 0;
+    uint64_t                                   m_clustersVisible = 0;
+
+    // simple orbit camera state; right click moves m_pivot onto the
+    // surface under the cursor, found through m_bvh (built in mesh units)
+    float     m_yaw      = 0.0f;
+    float     m_pitch    = 0.4f;
+    float     m_distance = 3.0f;
+    glm::vec3 m_pivot    = glm::vec3(0.0f);
+    TriangleBvh m_bvh;
 
     bool   m_mousePressed = false;
+    bool   m_rightPressed = false;
     double m_lastMouseX   = 0.0;
     double m_lastMouseY   = 0.0;
 
+    // on-demand rendering: everything a frame's image depends on. The main
+    // loop draws only when this differs from the last frame drawn (or the
+    // window asked for a refresh) and otherwise sleeps in glfwWaitEvents.
+    struct ViewState {
+        float      yaw = 0.0f, pitch = 0.0f, distance = 0.0f;
+        glm::vec3  pivot     = glm::vec3(0.0f);
+        bool       orbiting  = false;   // picks the coarser LOD budget
+        int        width     = 0;       // framebuffer size
+        int        height    = 0;
+        VkPipeline pipeline  = VK_NULL_HANDLE;
+        uint32_t   indexCount = 0;
+        glm::mat4  model     = glm::mat4(1.0f);
+        bool operator==(const ViewState& o) const {
+            return yaw == o.yaw && pitch == o.pitch && distance == o.distance &&
+                   pivot == o.pivot && orbiting == o.orbiting &&
+                   width == o.width && height == o.height && pipeline == o.pipeline &&
+                   indexCount == o.indexCount && model == o.model;
+        }
+    };
+    ViewState m_drawnState;
+    bool      m_redrawRequested = true;   // window damaged or not drawn yet
+
     // high-level flow
     void initWindow();
     void initVulkan();
+    void adoptMesh(MeshData&& mesh, const glm::mat4& model);
     void mainLoop();
     void cleanup();
 
     // camera
-    void updateCameraFromInput();
+    void      updateCameraFromInput();
+    ViewState currentViewState() const;
+    void      pickPivot(double cursorX, double cursorY);
+    glm::vec3 cameraPosition() const;
+    glm::mat4 viewMatrix() const;
+    glm::mat4 projectionMatrix() const;
 
     // vulkan setup
     void createInstance();
@@ -100,11 +257,25 @@ private:
     void createImageViews();
     void createRenderPass();
     void createGraphicsPipeline();
+    static uint64_t pipelineKey(bool backfaceCulling, uint32_t xrayPreset);
+    void selectPipeline(bool backfaceCulling, uint32_t xrayPreset);
     void createFramebuffers();
     void createCommandPool();
     void createVertexBuffer();
     void createIndexBuffer();
+    void reportQuantizationError(const QuantizationError& e) const;
+    void createIndirectBuffer();
+    void createFrameDrawBuffers();
+    void buildPickingBvh();
+    uint32_t writeVisibleClusters(const glm::mat4& proj, const glm::mat4& view,
+                                  VkDrawIndexedIndirectCommand* out);
+    uint32_t selectLodLevel(const glm::vec3& camPos) const;
+    uint32_t writeLodRanges(uint32_t level, VkDrawIndexedIndirectCommand* out) const;
+    void uploadStreamedBatches();
+    void finishStreaming();
     void createCommandBuffers();
+    void createFrameUniforms();
+    void recordStaticDraws(size_t frame);
     void createSyncObjects();
 
     void drawFrame();
@@ -116,6 +287,7 @@ private:
     struct QueueFamilyIndices {
         std::optional<uint32_t> graphicsFamily;
         std::optional<uint32_t> presentFamily;
+        std::optional<uint32_t> transferFamily;   // transfer-only, if any
         bool isComplete() const {
             return graphicsFamily.has_value() && presentFamily.has_value();
         }
@@ -134,12 +306,20 @@ private:
     VkPresentModeKHR        chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& modes);
     VkExtent2D              chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities);
 
-    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
     void createBuffer(VkDeviceSize size,
                       VkBufferUsageFlags usage,
                       VkMemoryPropertyFlags properties,
                       VkBuffer& buffer,
-                      VkDeviceMemory& bufferMemory);
-    VkCommandBuffer beginSingleTimeCommands();
-    void            endSingleTimeCommands(VkCommandBuffer cmd);
+                      GpuAllocation& bufferMemory,
+                      AllocationStrategy strategy = AllocationStrategy::FreeList,
+                      VkMemoryPropertyFlags preferred = 0);
+    void destroyBuffer(VkBuffer& buffer, GpuAllocation& bufferMemory);
+    void createGeometryBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
+                              VkBuffer& buffer, GpuAllocation& bufferMemory);
+    void uploadToBuffer(VkBuffer buffer, const GpuAllocation& bufferMemory, VkDeviceSize offset,
+                        size_t elementSize, size_t count, const StagingRing::FillFn& fill);
+    void createStagingRing();
+    void releaseStagingRing(const char* stage);
+    void reportStagingStats(const char* stage) const;
+    uint64_t acquireUploads(VkCommandBuffer cmd);
 };
@@ -2,6 +2,7 @@
 
 #include <vulkan/vulkan.h>
 #include <array>
+#include <cstddef>
 #include "MeshLoader.h"
 
 struct VulkanVertex {
@@ -32,3 +33,9 @@ struct VulkanVertex {
         return attrs;
     }
 };
+
+// MeshData::vertices is uploaded (and cached) as is, without conversion
+static_assert(sizeof(VulkanVertex) == sizeof(Vertex) &&
+              offsetof(VulkanVertex, pos) == offsetof(Vertex, pos) &&
+              offsetof(VulkanVertex, normal) == offsetof(Vertex, normal),
+              "Vertex and VulkanVertex must share one memory layout");
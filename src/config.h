@@ -5,10 +5,132 @@ namespace Config
     inline constexpr const char* MESH_PATH =
         "D:/Shader Optimization/assets/meshes/Armadillo.ply";
 
+    // PLY / STL / OBJ are decoded by the built-in mmap readers
+    // (ASCII PLY and OBJ in parallel); everything else, and OBJ files with
+    // their own normals or several parts, goes through Assimp.
+    inline constexpr bool USE_NATIVE_READERS = true;
+
+    // Parallel vertex weld + cleanup after import (replaces Assimp's
+    // JoinIdenticalVertices). Epsilon is relative to the bounding box
+    // diagonal; 0 welds only bit-identical positions.
+    inline constexpr bool  WELD_VERTICES = true;
+    inline constexpr float WELD_EPSILON  = 1e-6f;
+
+    // Smooth normals for files without per-vertex normals (STL, OBJ
+    // without vn, PLY without nx/ny/nz), generated after the weld. Edges sharper than the
+    // crease angle stay hard; 180 smooths everything.
+    inline constexpr float NORMAL_CREASE_ANGLE    = 60.0f;
+    inline constexpr bool  NORMAL_ANGLE_WEIGHTED  = true;   // false = area-weighted
+
+    // Fit the mesh into the unit sphere through the model matrix instead of
+    // rewriting every vertex position at load time.
+    inline constexpr bool NORMALIZE_IN_MODEL_MATRIX = true;
+
+    // Reorder triangles for the post-transform vertex cache (Tipsify) and
+    // vertices into first-use order. One-time load cost, kept in the cache.
+    inline constexpr bool OPTIMIZE_VERTEX_CACHE = true;
+
+    // Meshes over 64k vertices are split into chunks of at most 65536
+    // vertices (boundary vertices duplicated) so the index buffer can use
+    // 16-bit indices. Smaller meshes always get 16-bit indices.
+    inline constexpr bool SPLIT_INDEX_CHUNKS = true;
+
+    // 12-byte quantized vertices (16-bit positions, octahedral normals)
+    // instead of 24-byte floats; the error is printed at startup.
+    // Streaming loads always use floats.
+    inline constexpr bool COMPACT_VERTICES = false;
+
+    // Cut the mesh into clusters of 64-128 triangles with a bounding sphere
+    // and normal cone; each frame only the clusters inside the view frustum
+    // (and, with backface culling on, not facing away) are drawn.
+    inline constexpr bool CLUSTER_CULLING = true;
+
+    // Level-of-detail chain by quadric edge collapse, each level about half
+    // the triangles of the one before (LOD_LEVELS counts the full mesh;
+    // 1 = off). The coarsest level whose error stays under LOD_PIXEL_ERROR
+    // on screen is drawn, or under LOD_ORBIT_PIXEL_ERROR while orbiting.
+    inline constexpr unsigned LOD_LEVELS            = 5;
+    inline constexpr float    LOD_PIXEL_ERROR       = 1.0f;
+    inline constexpr float    LOD_ORBIT_PIXEL_ERROR = 8.0f;
+
+    // Triangle BVH for cursor picking (right click snaps the orbit pivot to
+    // the surface). Keeps a copy of the positions in system memory.
+    inline constexpr bool BUILD_PICKING_BVH = true;
+
+    // Processed meshes are cached on disk, keyed by source contents and
+    // import settings. Empty dir = next to the source file.
+    inline constexpr bool USE_MESH_CACHE = true;
+    inline constexpr const char* MESH_CACHE_DIR = "";
+
+    // On a cache miss, import the mesh on a worker thread while the window,
+    // device, swapchain and pipeline are created; the buffers wait for it.
+    // A timeline of the startup phases is printed either way.
+    inline constexpr bool OVERLAP_IMPORT_WITH_INIT = true;
+
+    // On a cache miss, binary PLY (with normals) and binary STL are read on a
+    // background thread and drawn while they load; the cache is not written
+    // in this mode. Other files fall back to the regular blocking import.
+    // Streamed STL keeps flat facet normals (no weld, no smooth normals),
+    // so it shades faceted where the regular import is smooth.
+    inline constexpr bool STREAMING_LOAD = false;
+    inline constexpr unsigned STREAM_UPLOAD_BUDGET_MB = 64;   // uploaded per frame
+
     inline constexpr bool WRITE_PLY_COPY = false;
     inline constexpr const char* PLY_OUT_PATH = "";
+    inline constexpr bool PLY_COPY_BINARY = true;   // false = ASCII copy
+
+    // Save the imported mesh (welded, with normals, vertex cache order) as a
+    // compressed .xrmesh container, which loads back without any processing.
+    // Empty path = next to the source file. Positions are quantized to
+    // COMPRESSED_POSITION_BITS per axis (8-24) inside the bounding cube.
+    inline constexpr bool WRITE_COMPRESSED_COPY = false;
+    inline constexpr const char* COMPRESSED_OUT_PATH = "";
+    inline constexpr unsigned COMPRESSED_POSITION_BITS = 16;
+
+    // Buffers are sub-allocated from device memory blocks of this size (at
+    // most 1/8 of a heap); larger buffers get their own allocation.
+    inline constexpr unsigned GPU_MEMORY_BLOCK_MB = 64;
+
+    // Uploads are staged through a ring of this size, in four slots: the
+    // CPU fills one slot while the GPU copies out of the previous ones.
+    inline constexpr unsigned STAGING_RING_MB = 64;
+
+    // Copy on a transfer-only queue when the device has one (and timeline
+    // semaphores), so large uploads run beside rendering instead of in
+    // front of it. Falls back to the graphics queue otherwise.
+    inline constexpr bool USE_TRANSFER_QUEUE = true;
+
+    // Where device-local memory is also host visible (integrated GPUs,
+    // resizable BAR) and its heap has room, write vertices and indices
+    // straight into it instead of staging and copying.
+    inline constexpr bool DIRECT_UPLOAD = true;
+
+    // Draw only when the camera, window or scene changed and sleep in
+    // glfwWaitEvents otherwise, so an idle viewer uses no CPU or GPU time.
+    // false = redraw continuously.
+    inline constexpr bool ON_DEMAND_RENDERING = true;
     // --------------------------------
     // Shader controls
     // --------------------------------
-    inline bool ENABLE_BACKFACE_CULLING = false;  // off by default
+    inline bool ENABLE_BACKFACE_CULLING = false;  // off by default; C toggles it
+
+    // X-ray looks, fed to basic.frag as specialization constants. Keys 1-3
+    // pick a preset at runtime. Every preset / cull mode pair is built at
+    // startup, so switching never compiles a pipeline.
+    struct XRayPreset {
+        const char* name;
+        float       edgeFalloff;
+        float       intensity;
+        float       ambient;
+    };
+    inline constexpr XRayPreset XRAY_PRESETS[] = {
+        { "MeshLab",    1.0f, 0.5f, 0.01f },   // xray.gdp defaults
+        { "thin edges", 0.5f, 0.6f, 0.00f },
+        { "dense",      2.0f, 0.7f, 0.05f },
+    };
+    inline constexpr unsigned XRAY_PRESET = 0;
+
+    // Driver pipeline cache kept between runs, relative to the working
+    // directory like the shaders; empty = in memory only.
+    inline constexpr const char* PIPELINE_CACHE_PATH = "pipeline.cache";
 }
@@ -1,74 +1,208 @@
 #include <iostream>
 #include <vector>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
 
-#include "Config.h"
+#include "config.h"
+#include "MemoryUsage.h"
+#include "IndexChunks.h"
+#include "MeshClusters.h"
+#include "MeshCache.h"
 #include "MeshLoader.h"
+#include "MeshLod.h"
+#include "MeshReorder.h"
+#include "MeshStream.h"
 #include "MeshUtils.h"
+#include "StartupTimeline.h"
 #include "VulkanVertex.h"
 #include "VulkanApp.h"
 
+// Import and preprocessing on a cache miss: everything up to the arrays
+// VulkanApp uploads. Runs on a worker thread when it overlaps Vulkan setup;
+// thread only labels the startup timeline.
+static ImportedMesh importMesh(const std::string& cachePath, const MeshCacheKey& cacheKey,
+                               const char* thread)
+{
+    StartupPhase loadPhase("import", thread);
+    MeshData mesh = loadMesh(
+        Config::MESH_PATH,
+        Config::WRITE_PLY_COPY,
+        std::string(Config::PLY_OUT_PATH)
+    );
+    loadPhase.end();
+
+    std::cout << "Final vertex count:   " << mesh.vertices.size()    << "\n";
+    std::cout << "Final triangle count: " << mesh.indices.size() / 3 << "\n";
+    std::cout << "Submesh count:        " << mesh.submeshes.size()   << "\n";
+
+    MeshBounds bounds = computeBounds(mesh);
+    std::cout << "Bounds:\n";
+    std::cout << "  min: " << bounds.min.x << ", " << bounds.min.y << ", " << bounds.min.z << "\n";
+    std::cout << "  max: " << bounds.max.x << ", " << bounds.max.y << ", " << bounds.max.z << "\n";
+    std::cout << "  center: " << bounds.center.x << ", " << bounds.center.y << ", " << bounds.center.z << "\n";
+    std::cout << "  radius: " << bounds.radius << "\n";
+
+    glm::mat4 model(1.0f);
+    if (Config::NORMALIZE_IN_MODEL_MATRIX) {
+        // vertices stay in file units; the model matrix does the fit
+        model = normalizationMatrix(bounds);
+        std::cout << "Normalization folded into the model matrix\n";
+    } else {
+        normalizeToUnitSphere(mesh, bounds);
+        std::cout << "Bounds after normalization:\n";
+        std::cout << "  min: " << bounds.min.x << ", " << bounds.min.y << ", " << bounds.min.z << "\n";
+        std::cout << "  max: " << bounds.max.x << ", " << bounds.max.y << ", " << bounds.max.z << "\n";
+        std::cout << "  radius: " << bounds.radius << "\n";
+    }
+
+    // reorder first: the chunks then follow the cache-friendly order
+    if (Config::OPTIMIZE_VERTEX_CACHE) {
+        StartupPhase phase("vertex cache", thread);
+        ReorderStats r = optimizeVertexCache(mesh);
+        std::cout << "Vertex cache reorder (" << VERTEX_CACHE_SIZE << "-entry FIFO) in "
+                  << r.milliseconds << " ms\n";
+        std::cout << "  ACMR: " << r.acmrBefore << " -> " << r.acmrAfter << "\n";
+        std::cout << "  ATVR: " << r.atvrBefore << " -> " << r.atvrAfter << "\n";
+    }
+
+    // after the reorder (neighbouring vertices give small deltas) and
+    // before the chunk split, which would duplicate boundary vertices
+    if (Config::WRITE_COMPRESSED_COPY) {
+        StartupPhase phase("compressed copy", thread);
+        std::string out = Config::COMPRESSED_OUT_PATH;
+        if (out.empty()) {
+            const std::string src = Config::MESH_PATH;
+            const size_t dotPos = src.find_last_of('.');
+            out = (dotPos == std::string::npos ? src : src.substr(0, dotPos)) + ".xrmesh";
+        }
+        if (out == Config::MESH_PATH) {
+            std::cout << "Source is already the compressed copy, not rewriting it\n";
+        } else {
+            MeshCodecStats c = writeMeshCompressed(mesh, out, Config::COMPRESSED_POSITION_BITS);
+            std::cout << "Compressed copy: " << out << "\n";
+            std::cout << "  " << c.rawBytes / (1024.0 * 1024.0) << " MB -> "
+                      << c.compressedBytes / (1024.0 * 1024.0) << " MB ("
+                      << (c.compressedBytes ? double(c.rawBytes) / c.compressedBytes : 0.0)
+                      << "x, " << c.blocks << " blocks) in " << c.milliseconds << " ms\n";
+        }
+    }
+
+    if (Config::SPLIT_INDEX_CHUNKS && mesh.vertices.size() > MAX_CHUNK_VERTICES) {
+        StartupPhase phase("index chunks", thread);
+        IndexChunkStats c = splitIntoIndexChunks(mesh);
+        std::cout << "16-bit index chunks: " << c.chunks << ", vertices "
+                  << c.verticesBefore << " -> " << c.verticesAfter << " in "
+                  << c.milliseconds << " ms\n";
+    }
+
+    if (Config::CLUSTER_CULLING) {
+        StartupPhase phase("clusters", thread);
+        ClusterStats c = buildClusters(mesh);
+        std::cout << "Culling clusters: " << c.clusters << " (avg " << c.avgTriangles
+                  << " triangles, " << c.withCone << " with a normal cone) in "
+                  << c.milliseconds << " ms\n";
+    }
+
+    if (Config::LOD_LEVELS > 1) {
+        StartupPhase phase("LOD chain", thread);
+        LodStats l = buildLodChain(mesh, Config::LOD_LEVELS);
+        std::cout << "LOD levels: " << l.levels << " in " << l.milliseconds << " ms\n";
+        for (size_t i = 0; i < mesh.lods.size(); ++i)
+            std::cout << "  " << i + 1 << ": " << mesh.lods[i].triangles
+                      << " triangles, error " << mesh.lods[i].error << "\n";
+    }
+
+    // MeshData::vertices already has the VulkanVertex layout, so the
+    // arrays go to the cache and to VulkanApp as they are, without copies
+    std::cout << "\nGPU buffers:\n";
+    std::cout << "  vertices: " << mesh.vertices.size() << " ("
+              << mesh.vertices.size() * sizeof(VulkanVertex) / (1024.0 * 1024.0) << " MB)\n";
+    std::cout << "  indices:  " << mesh.indices.size() << " ("
+              << mesh.indices.size() / 3 << " triangles, "
+              << mesh.indices.size() * sizeof(uint32_t) / (1024.0 * 1024.0) << " MB)\n";
+
+    if (!mesh.vertices.empty()) {
+        const Vertex& v0 = mesh.vertices[0];
+        std::cout << "Example vertex[0]: pos = ("
+                  << v0.pos.x << ", " << v0.pos.y << ", " << v0.pos.z
+                  << "), normal = ("
+                  << v0.normal.x << ", " << v0.normal.y << ", " << v0.normal.z
+                  << ")\n";
+    }
+    reportMemoryUsage("before upload");
+
+    if (Config::USE_MESH_CACHE) {
+        StartupPhase phase("cache write", thread);
+        writeMeshCache(cachePath, cacheKey, mesh, bounds);
+    }
+
+    return { std::move(mesh), model };
+}
+
 int main() {
     try {
         std::cout << "Mesh path from Config: " << Config::MESH_PATH << "\n";
-        MeshData mesh = loadMesh(
-            Config::MESH_PATH,
-            Config::WRITE_PLY_COPY,
-            std::string(Config::PLY_OUT_PATH)
-        );
 
-        std::cout << "Final vertex count:   " << mesh.vertices.size()    << "\n";
-        std::cout << "Final triangle count: " << mesh.indices.size() / 3 << "\n";
+        MeshCacheKey cacheKey;
+        std::string  cachePath;
 
-        MeshBounds bBefore = computeBounds(mesh);
-        std::cout << "Bounds before normalization:\n";
-        std::cout << "  min: " << bBefore.min.x << ", " << bBefore.min.y << ", " << bBefore.min.z << "\n";
-        std::cout << "  max: " << bBefore.max.x << ", " << bBefore.max.y << ", " << bBefore.max.z << "\n";
-        std::cout << "  center: " << bBefore.center.x << ", " << bBefore.center.y << ", " << bBefore.center.z << "\n";
-        std::cout << "  radius: " << bBefore.radius << "\n";
+        if (Config::USE_MESH_CACHE) {
+            auto t0 = std::chrono::steady_clock::now();
+            StartupPhase lookup("cache lookup");
+            cachePath = meshCachePath(Config::MESH_PATH);
+            cacheKey  = makeMeshCacheKey(Config::MESH_PATH);
 
-        MeshBounds bAfter;
-        normalizeToUnitSphere(mesh, bAfter);
+            MeshCacheFile cache;
+            const bool hit = cache.open(cachePath, cacheKey);
+            lookup.end();
+            if (hit) {
+                double ms = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - t0).count();
+                std::cout << "Mesh cache hit: " << cachePath << " (" << ms << " ms)\n";
+                std::cout << "  vertices:  " << cache.vertexCount()    << "\n";
+                std::cout << "  triangles: " << cache.indexCount() / 3 << "\n";
+                std::cout << "  submeshes: " << cache.submeshCount()   << "\n";
+                std::cout << "  radius:    " << cache.bounds().radius  << "\n";
 
-        std::cout << "Bounds after normalization:\n";
-        std::cout << "  min: " << bAfter.min.x << ", " << bAfter.min.y << ", " << bAfter.min.z << "\n";
-        std::cout << "  max: " << bAfter.max.x << ", " << bAfter.max.y << ", " << bAfter.max.z << "\n";
-        std::cout << "  center: " << bAfter.center.x << ", " << bAfter.center.y << ", " << bAfter.center.z << "\n";
-        std::cout << "  radius: " << bAfter.radius << "\n";
-
-        std::vector<VulkanVertex> gpuVertices;
-        gpuVertices.reserve(mesh.vertices.size());
-
-        for (const auto &v : mesh.vertices) {
-            VulkanVertex gv{};
-            gv.pos[0]    = v.pos.x;
-            gv.pos[1]    = v.pos.y;
-            gv.pos[2]    = v.pos.z;
-            gv.normal[0] = v.normal.x;
-            gv.normal[1] = v.normal.y;
-            gv.normal[2] = v.normal.z;
-            gpuVertices.push_back(gv);
+                std::cout << "\nLaunching VulkanApp...\n";
+                VulkanApp app(std::move(cache));
+                app.run();
+                return 0;
+            }
+            std::cout << "Mesh cache miss, importing " << Config::MESH_PATH << "\n";
         }
 
-        std::vector<uint32_t> &gpuIndices = mesh.indices;
-
-        std::cout << "\nConverted to VulkanVertex layout:\n";
-        std::cout << "  gpuVertices.size(): " << gpuVertices.size() << "\n";
-        std::cout << "  gpuIndices.size():  " << gpuIndices.size()  << " ("
-                  << gpuIndices.size() / 3 << " triangles)\n";
+        if (Config::STREAMING_LOAD) {
+            auto stream = std::make_unique<MeshStream>();
+            if (stream->open(Config::MESH_PATH)) {
+                std::cout << "Streaming " << stream->vertexCount() << " vertices, "
+                          << stream->indexCount() / 3 << " triangles\n";
+                stream->start();
 
-        if (!gpuVertices.empty()) {
-            const auto &v0 = gpuVertices[0];
-            std::cout << "Example vertex[0]: pos = ("
-                      << v0.pos[0] << ", " << v0.pos[1] << ", " << v0.pos[2]
-                      << "), normal = ("
-                      << v0.normal[0] << ", " << v0.normal[1] << ", " << v0.normal[2]
-                      << ")\n";
+                std::cout << "\nLaunching VulkanApp...\n";
+                VulkanApp app(std::move(stream));
+                app.run();
+                return 0;
+            }
+            std::cout << "File layout cannot be streamed, using the regular import\n";
         }
 
-        std::cout << "\nLaunching VulkanApp...\n";
+        if (Config::OVERLAP_IMPORT_WITH_INIT) {
+            // window, device, swapchain and pipeline do not need the mesh;
+            // VulkanApp waits for the import right before creating buffers
+            std::cout << "\nLaunching VulkanApp while the mesh imports...\n";
+            VulkanApp app(std::async(std::launch::async, importMesh,
+                                     cachePath, cacheKey, "import"));
+            app.run();
+        } else {
+            ImportedMesh imported = importMesh(cachePath, cacheKey, "main");
 
-        VulkanApp app(gpuVertices, gpuIndices);
-        app.run();
+            std::cout << "\nLaunching VulkanApp...\n";
+            VulkanApp app(std::move(imported.mesh), imported.model);
+            app.run();
+        }
     }
     catch (const std::exception &e) {
         std::cerr << "Error: " << e.what() << "\n";